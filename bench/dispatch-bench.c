@@ -0,0 +1,206 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+/**
+	How long the main loop is blocked by one textDocument/references reply.
+
+	inline: parsed and dumped in the read callback on the main thread, as before
+	the I/O thread.
+	threaded: parsed by a worker and handed over through the MPSC queue, the main
+	thread only runs the action.
+
+	The action walks the locations the way the references popup does.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../gedit-lspjump-mpsc.h"
+
+#define ROUNDS 5
+
+typedef struct BenchMessage
+{
+	LspJumpMpscNode node;
+	json_t *json;
+}BenchMessage;
+
+typedef struct BenchState
+{
+	LspJumpMpscQueue queue;
+	gint wake_pending;
+	GMainLoop *loop;
+	const GString *body;
+	int remaining;
+	gint64 max_stall_us;
+	size_t checksum;
+}BenchState;
+
+static GString *make_body(long locations)
+{
+	GString *body=g_string_new("{\"id\":7,\"jsonrpc\":\"2.0\",\"result\":[");
+
+	for(long i=0;i<locations;i++)
+	{
+		g_string_append_printf(body,"%s{\"uri\":\"file:///home/user/project/src/module%ld.c\",\"range\":{\"start\":{\"line\":%ld,\"character\":4},\"end\":{\"line\":%ld,\"character\":20}}}",
+		                       i?",":"",i%97,i,i);
+	}
+
+	g_string_append(body,"]}");
+
+	return body;
+}
+
+static size_t run_action(json_t *root)
+{
+	json_t *results=json_object_get(root,"result");
+	size_t index;
+	json_t *item;
+	size_t sum=0;
+
+	json_array_foreach(results,index,item)
+	{
+		json_t *start=json_object_get(json_object_get(item,"range"),"start");
+
+		sum+=strlen(json_string_value(json_object_get(item,"uri")));
+		sum+=json_integer_value(json_object_get(start,"line"));
+	}
+
+	return sum;
+}
+
+static json_t *parse_and_dump(const GString *body)
+{
+	json_error_t error;
+	json_t *json=json_loadb(body->str,body->len,0,&error);
+	char *formatted=json_dumps(json,JSON_INDENT(2));
+
+	free(formatted);
+
+	return json;
+}
+
+static gint64 run_inline(const GString *body, size_t *checksum)
+{
+	gint64 max_stall=0;
+
+	for(int i=0;i<ROUNDS;i++)
+	{
+		gint64 start=g_get_monotonic_time();
+		json_t *json=parse_and_dump(body);
+
+		*checksum+=run_action(json);
+		json_decref(json);
+
+		max_stall=MAX(max_stall,g_get_monotonic_time()-start);
+	}
+
+	return max_stall;
+}
+
+static gboolean deliver(gpointer data)
+{
+	BenchState *state=data;
+	BenchMessage *message;
+
+	g_atomic_int_set(&state->wake_pending,0);
+
+	while((message=(BenchMessage *)lspjump_mpsc_queue_pop(&state->queue)))
+	{
+		gint64 start=g_get_monotonic_time();
+
+		state->checksum+=run_action(message->json);
+		json_decref(message->json);
+		free(message);
+
+		state->max_stall_us=MAX(state->max_stall_us,g_get_monotonic_time()-start);
+
+		if(--state->remaining==0)
+		{
+			g_main_loop_quit(state->loop);
+		}
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer worker(gpointer data)
+{
+	BenchState *state=data;
+
+	for(int i=0;i<ROUNDS;i++)
+	{
+		BenchMessage *message=calloc(1,sizeof(BenchMessage));
+		message->json=parse_and_dump(state->body);
+
+		lspjump_mpsc_queue_push(&state->queue,&message->node);
+
+		if(g_atomic_int_compare_and_exchange(&state->wake_pending,0,1))
+		{
+			g_idle_add(deliver,state);
+		}
+	}
+
+	return NULL;
+}
+
+static gint64 run_threaded(const GString *body, size_t *checksum)
+{
+	BenchState state={.body=body,.remaining=ROUNDS};
+
+	lspjump_mpsc_queue_init(&state.queue);
+	state.loop=g_main_loop_new(NULL,FALSE);
+
+	GThread *thread=g_thread_new("bench-io",worker,&state);
+	g_main_loop_run(state.loop);
+	g_thread_join(thread);
+
+	g_main_loop_unref(state.loop);
+	*checksum+=state.checksum;
+
+	return state.max_stall_us;
+}
+
+int main(int argc, char **argv)
+{
+	long counts[]={100,1000,10000,50000,100000};
+
+	printf("%12s %12s %18s %18s\n","locations","bytes","inline stall us","threaded stall us");
+
+	for(size_t i=0;i<G_N_ELEMENTS(counts);i++)
+	{
+		g_autoptr(GString) body=make_body(counts[i]);
+		size_t inline_sum=0, threaded_sum=0;
+
+		gint64 inline_us=run_inline(body,&inline_sum);
+		gint64 threaded_us=run_threaded(body,&threaded_sum);
+
+		if(inline_sum!=threaded_sum)
+		{
+			fprintf(stderr,"Mismatch: %zu != %zu\n",inline_sum,threaded_sum);
+			return 1;
+		}
+
+		printf("%12ld %12zu %18" G_GINT64_FORMAT " %18" G_GINT64_FORMAT "\n",counts[i],body->len,inline_us,threaded_us);
+	}
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+/**
+	Feeds textDocument/references sized replies through the frame parser in 4 KB
+	reads, the same way read_stdout gets them from the pipe, and prints the cost per
+	byte. The old GString/strstr/g_strndup loop is kept here for comparison.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../gedit-lspjump-frame.h"
+
+#define CHUNK_SIZE 4096
+
+static GString *make_reply(long locations)
+{
+	GString *body=g_string_new("{\"id\":7,\"jsonrpc\":\"2.0\",\"result\":[");
+
+	for(long i=0;i<locations;i++)
+	{
+		g_string_append_printf(body,"%s{\"uri\":\"file:///home/user/project/src/module%ld.c\",\"range\":{\"start\":{\"line\":%ld,\"character\":4},\"end\":{\"line\":%ld,\"character\":20}}}",
+		                       i?",":"",i%97,i,i);
+	}
+
+	g_string_append(body,"]}");
+
+	GString *message=g_string_new(NULL);
+	g_string_append_printf(message,"Content-Type: application/vscode-jsonrpc; charset=utf-8\r\nContent-Length: %zu\r\n\r\n",body->len);
+	g_string_append_len(message,body->str,body->len);
+	g_string_free(body,TRUE);
+
+	return message;
+}
+
+static size_t run_parser(const GString *message)
+{
+	LspJumpFrameParser *parser=lspjump_frame_parser_new();
+	size_t total=0;
+
+	for(size_t pos=0;pos<message->len;pos+=CHUNK_SIZE)
+	{
+		size_t len=MIN(CHUNK_SIZE,message->len-pos);
+		size_t avail;
+		char *buffer=lspjump_frame_parser_reserve(parser,len,&avail);
+
+		if(buffer==NULL)
+		{
+			break;
+		}
+
+		memcpy(buffer,message->str+pos,len);
+		lspjump_frame_parser_commit(parser,len);
+
+		const char *body;
+		size_t body_len;
+
+		while(lspjump_frame_parser_next(parser,&body,&body_len))
+		{
+			total+=body_len;
+		}
+	}
+
+	lspjump_frame_parser_free(parser);
+
+	return total;
+}
+
+static size_t run_legacy(const GString *message)
+{
+	GString *read_buffer=g_string_new(NULL);
+	size_t total=0;
+
+	for(size_t pos=0;pos<message->len;pos+=CHUNK_SIZE)
+	{
+		g_string_append_len(read_buffer,message->str+pos,MIN(CHUNK_SIZE,message->len-pos));
+
+		while(1)
+		{
+			char *header_end=strstr(read_buffer->str,"\r\n\r\n");
+			if(!header_end)
+				break;
+
+			size_t header_len=header_end-read_buffer->str+4;
+			char *content_length_str=g_strstr_len(read_buffer->str,header_len,"Content-Length:");
+
+			if(!content_length_str)
+				break;
+
+			int content_length=0;
+			sscanf(content_length_str,"Content-Length: %d",&content_length);
+
+			if(read_buffer->len<header_len+content_length)
+				break;
+
+			char *json_chunk=g_strndup(read_buffer->str+header_len,content_length);
+			total+=strlen(json_chunk);
+			g_free(json_chunk);
+
+			g_string_erase(read_buffer,0,header_len+content_length);
+		}
+	}
+
+	g_string_free(read_buffer,TRUE);
+
+	return total;
+}
+
+int main(int argc, char **argv)
+{
+	long counts[]={100,1000,10000,50000,100000,200000};
+
+	printf("%12s %12s %16s %16s\n","locations","bytes","parser ns/byte","legacy ns/byte");
+
+	for(size_t i=0;i<G_N_ELEMENTS(counts);i++)
+	{
+		g_autoptr(GString) message=make_reply(counts[i]);
+
+		gint64 start=g_get_monotonic_time();
+		size_t parsed=run_parser(message);
+		gint64 parser_us=g_get_monotonic_time()-start;
+
+		start=g_get_monotonic_time();
+		size_t legacy_parsed=run_legacy(message);
+		gint64 legacy_us=g_get_monotonic_time()-start;
+
+		if(parsed!=legacy_parsed)
+		{
+			fprintf(stderr,"Mismatch: %zu != %zu\n",parsed,legacy_parsed);
+			return 1;
+		}
+
+		printf("%12ld %12zu %16.3f %16.3f\n",counts[i],message->len,
+		       parser_us*1000.0/message->len,legacy_us*1000.0/message->len);
+	}
+
+	return 0;
+}
@@ -0,0 +1,379 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+/**
+	Plays the language server of a recorded session (LSPJUMP_RECORD), so the
+	session can be run again without the real server. Configure it as the server
+	binary of a profile:
+
+		<lsp_bin>/path/to/bench/lsp-replay</lsp_bin>
+		<lsp_bin_args>/tmp/session.rec.1 --fast</lsp_bin_args>
+
+	Every live message from the client is matched with the next recorded client
+	message with the same method, recorded messages that were skipped over are
+	not waited for. A recorded reply is sent with the id of the live request it
+	answers, as long after that request as it came in the recording, or right
+	away with --fast. Server notifications keep their distance to the client
+	message before them. Requests that were never recorded get a null result.
+
+	When the client sends exit, the timing is printed on stderr.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "../gedit-lspjump-frame.h"
+#include "../gedit-lspjump-record.h"
+
+typedef struct ReplayClientMessage
+{
+	LspJumpRecordEntry *entry;
+	const char *method; // interned
+	json_int_t id; // -1 for notifications
+	
+	gint64 live_us; // when the live counterpart came, 0 while waiting, -1 if skipped
+	json_int_t live_id;
+}ReplayClientMessage;
+
+typedef struct ReplayServerMessage
+{
+	LspJumpRecordEntry *entry;
+	json_t *json;
+	int anchor; // client message it follows, -1 for the start of the session
+	gint64 delay_us; // after the anchor
+	gboolean is_reply;
+}ReplayServerMessage;
+
+typedef struct Replay
+{
+	GArray *clients; // ReplayClientMessage
+	GArray *servers; // ReplayServerMessage
+	guint cursor; // first client message that may still be matched
+	guint next; // next server message to send
+	gboolean fast;
+	gint64 start_us;
+	
+	guint64 sent;
+	guint64 dropped;
+	guint64 unmatched;
+	gint64 late_max_us;
+	gint64 late_total_us;
+}Replay;
+
+static void send_body(const char *body, size_t len)
+{
+	printf("Content-Length: %zu\r\n\r\n",len);
+	fwrite(body,1,len,stdout);
+	fflush(stdout);
+}
+
+static void send_json(json_t *json)
+{
+	char *body=json_dumps(json,JSON_COMPACT);
+	
+	send_body(body,strlen(body));
+	free(body);
+}
+
+static void load(Replay *replay, GPtrArray *entries)
+{
+	GHashTable *request_index=g_hash_table_new(g_direct_hash,g_direct_equal); // recorded id -> client index+1
+	
+	replay->clients=g_array_new(FALSE,TRUE,sizeof(ReplayClientMessage));
+	replay->servers=g_array_new(FALSE,TRUE,sizeof(ReplayServerMessage));
+	
+	for(guint i=0;i<entries->len;i++)
+	{
+		LspJumpRecordEntry *entry=g_ptr_array_index(entries,i);
+		json_t *json=json_loadb(entry->body,entry->len,0,NULL);
+		
+		if(!json)
+		{
+			fprintf(stderr,"lsp-replay: entry %u is not JSON, skipped\n",i);
+			continue;
+		}
+		
+		json_t *id=json_object_get(json,"id");
+		const char *method=json_string_value(json_object_get(json,"method"));
+		
+		if(entry->direction==LSPJUMP_RECORD_TO_SERVER)
+		{
+			ReplayClientMessage client={
+				.entry=entry,
+				.method=g_intern_string(method?method:""),
+				.id=json_is_integer(id)?json_integer_value(id):-1
+			};
+			
+			g_array_append_val(replay->clients,client);
+			
+			if(method && client.id>=0)
+			{
+				g_hash_table_insert(request_index,GINT_TO_POINTER((int)client.id),GUINT_TO_POINTER(replay->clients->len));
+			}
+			
+			json_decref(json);
+		}
+		else
+		{
+			ReplayServerMessage server={.entry=entry,.json=json,.anchor=(int)replay->clients->len-1};
+			
+			// A reply follows the request it answers, not whatever was sent last
+			if(!method && json_is_integer(id))
+			{
+				guint index=GPOINTER_TO_UINT(g_hash_table_lookup(request_index,GINT_TO_POINTER((int)json_integer_value(id))));
+				
+				server.is_reply=TRUE;
+				
+				if(index>0)
+				{
+					server.anchor=index-1;
+				}
+			}
+			
+			gint64 anchor_us=server.anchor>=0?g_array_index(replay->clients,ReplayClientMessage,server.anchor).entry->time_us:0;
+			server.delay_us=MAX(entry->time_us-anchor_us,0);
+			
+			g_array_append_val(replay->servers,server);
+		}
+	}
+	
+	g_hash_table_destroy(request_index);
+}
+
+/**
+	@return
+		FALSE once the client has sent exit
+*/
+static gboolean handle_live(Replay *replay, const char *body, size_t len)
+{
+	json_t *json=json_loadb(body,len,0,NULL);
+	
+	if(!json)
+	{
+		return TRUE;
+	}
+	
+	const char *method=json_string_value(json_object_get(json,"method"));
+	json_t *id=json_object_get(json,"id");
+	
+	// Replies from the client are of no interest
+	if(!method)
+	{
+		json_decref(json);
+		return TRUE;
+	}
+	
+	if(strcmp(method,"exit")==0)
+	{
+		json_decref(json);
+		return FALSE;
+	}
+	
+	const char *interned=g_intern_string(method);
+	gint64 now=g_get_monotonic_time();
+	
+	for(guint i=replay->cursor;i<replay->clients->len;i++)
+	{
+		ReplayClientMessage *client=&g_array_index(replay->clients,ReplayClientMessage,i);
+		
+		if(client->method==interned)
+		{
+			for(guint skipped=replay->cursor;skipped<i;skipped++)
+			{
+				g_array_index(replay->clients,ReplayClientMessage,skipped).live_us=-1;
+			}
+			
+			client->live_us=now;
+			client->live_id=json_is_integer(id)?json_integer_value(id):-1;
+			replay->cursor=i+1;
+			
+			json_decref(json);
+			return TRUE;
+		}
+	}
+	
+	replay->unmatched++;
+	
+	if(json_is_integer(id))
+	{
+		json_t *reply=json_pack("{s:s, s:O, s:n}","jsonrpc","2.0","id",id,"result");
+		send_json(reply);
+		json_decref(reply);
+	}
+	
+	json_decref(json);
+	return TRUE;
+}
+
+/**
+	Send every server message that is due
+
+	@return
+		milliseconds until the next one is due, -1 to wait for the client
+*/
+static int send_due(Replay *replay)
+{
+	while(replay->next<replay->servers->len)
+	{
+		ReplayServerMessage *server=&g_array_index(replay->servers,ReplayServerMessage,replay->next);
+		ReplayClientMessage *anchor=server->anchor>=0?&g_array_index(replay->clients,ReplayClientMessage,server->anchor):NULL;
+		gint64 now=g_get_monotonic_time();
+		gint64 due=now;
+		
+		if(anchor && anchor->live_us==0)
+		{
+			return -1;
+		}
+		
+		if(anchor && anchor->live_us<0)
+		{
+			// The client did not ask this time
+			if(server->is_reply)
+			{
+				replay->dropped++;
+				replay->next++;
+				continue;
+			}
+		}
+		else if(!replay->fast)
+		{
+			due=(anchor?anchor->live_us:replay->start_us)+server->delay_us;
+		}
+		
+		if(due>now)
+		{
+			return (due-now+999)/1000;
+		}
+		
+		if(server->is_reply && anchor)
+		{
+			json_object_set_new(server->json,"id",json_integer(anchor->live_id));
+			send_json(server->json);
+		}
+		else
+		{
+			send_body(server->entry->body,server->entry->len);
+		}
+		
+		replay->sent++;
+		replay->late_total_us+=now-due;
+		replay->late_max_us=MAX(replay->late_max_us,now-due);
+		replay->next++;
+	}
+	
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path=NULL;
+	Replay replay={0};
+	
+	for(int i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"--fast")==0)
+		{
+			replay.fast=TRUE;
+		}
+		else
+		{
+			path=argv[i];
+		}
+	}
+	
+	if(!path)
+	{
+		fprintf(stderr,"Usage: %s RECORDING [--fast]\n",argv[0]);
+		return 1;
+	}
+	
+	g_autoptr(GError) error=NULL;
+	GPtrArray *entries=lspjump_record_load(path,&error);
+	
+	if(!entries)
+	{
+		fprintf(stderr,"lsp-replay: %s\n",error->message);
+		return 1;
+	}
+	
+	load(&replay,entries);
+	
+	LspJumpFrameParser *parser=lspjump_frame_parser_new();
+	gboolean running=TRUE;
+	
+	replay.start_us=g_get_monotonic_time();
+	
+	while(running)
+	{
+		struct pollfd fds={.fd=STDIN_FILENO,.events=POLLIN};
+		int timeout=send_due(&replay);
+		
+		if(poll(&fds,1,timeout)<0 && errno!=EINTR)
+		{
+			break;
+		}
+		
+		if(fds.revents & (POLLIN|POLLHUP))
+		{
+			size_t avail;
+			char *buffer=lspjump_frame_parser_reserve(parser,4096,&avail);
+			ssize_t got=buffer?read(STDIN_FILENO,buffer,avail):-1;
+			
+			if(got<=0)
+			{
+				break;
+			}
+			
+			lspjump_frame_parser_commit(parser,got);
+			
+			const char *body;
+			size_t body_len;
+			
+			while(running && lspjump_frame_parser_next(parser,&body,&body_len))
+			{
+				running=handle_live(&replay,body,body_len);
+			}
+		}
+	}
+	
+	gint64 spent=g_get_monotonic_time()-replay.start_us;
+	gint64 recorded=entries->len?((LspJumpRecordEntry *)g_ptr_array_index(entries,entries->len-1))->time_us:0;
+	
+	fprintf(stderr,"lsp-replay: %" G_GUINT64_FORMAT " of %u server messages sent, %" G_GUINT64_FORMAT " dropped, %" G_GUINT64_FORMAT " live requests not recorded\n",
+	        replay.sent,replay.servers->len,replay.dropped,replay.unmatched);
+	fprintf(stderr,"lsp-replay: %.3f s replayed, %.3f s recorded, late by %.3f ms at most, %.3f ms on average\n",
+	        spent/1e6,recorded/1e6,replay.late_max_us/1e3,replay.sent?replay.late_total_us/1e3/replay.sent:0.0);
+	
+	for(guint i=0;i<replay.servers->len;i++)
+	{
+		json_decref(g_array_index(replay.servers,ReplayServerMessage,i).json);
+	}
+	
+	g_array_free(replay.servers,TRUE);
+	g_array_free(replay.clients,TRUE);
+	g_ptr_array_free(entries,TRUE);
+	lspjump_frame_parser_free(parser);
+	
+	return 0;
+}
@@ -0,0 +1,285 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+/**
+	A language server that only pretends, for benchmarks without clangd.
+
+		--latency-ms N    answer requests N ms after they came (0)
+		--jitter-ms N     plus up to N ms more, replies may overtake each other
+		--references N    locations in a references reply (100)
+		--hover-bytes N   size of the hover text (256)
+		--error-rate P    answer a fraction P of the requests with an error (0)
+		--crash-after N   exit without a word after N requests (never)
+		--sync K          textDocumentSync kind to announce (2, incremental)
+
+	definition, hover and references get made up answers, other requests get null.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "../gedit-lspjump-frame.h"
+
+typedef struct MockOptions
+{
+	int latency_ms;
+	int jitter_ms;
+	int references;
+	int hover_bytes;
+	double error_rate;
+	long crash_after;
+	int sync;
+}MockOptions;
+
+typedef struct MockReply
+{
+	gint64 due_us;
+	char *body;
+}MockReply;
+
+static MockOptions OPTIONS={.references=100,.hover_bytes=256,.crash_after=-1,.sync=2};
+static GQueue REPLIES=G_QUEUE_INIT; // MockReply, by due time
+static long REQUESTS=0;
+
+static void send_body(const char *body)
+{
+	printf("Content-Length: %zu\r\n\r\n%s",strlen(body),body);
+	fflush(stdout);
+}
+
+static gint compare_due(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const MockReply *first=a, *second=b;
+
+	return (first->due_us>second->due_us)-(first->due_us<second->due_us);
+}
+
+static void queue_reply(json_t *id, json_t *result, gboolean immediate)
+{
+	json_t *reply=json_pack("{s:s, s:O}","jsonrpc","2.0","id",id);
+
+	if(!immediate && OPTIONS.error_rate>0 && g_random_double()<OPTIONS.error_rate)
+	{
+		json_object_set_new(reply,"error",json_pack("{s:i, s:s}","code",-32603,"message","injected error"));
+		json_decref(result);
+	}
+	else
+	{
+		json_object_set_new(reply,"result",result?result:json_null());
+	}
+
+	MockReply *queued=calloc(1,sizeof(MockReply));
+	queued->body=json_dumps(reply,JSON_COMPACT);
+	queued->due_us=g_get_monotonic_time();
+	json_decref(reply);
+
+	if(!immediate)
+	{
+		queued->due_us+=(gint64)OPTIONS.latency_ms*1000;
+
+		if(OPTIONS.jitter_ms>0)
+		{
+			queued->due_us+=g_random_int_range(0,OPTIONS.jitter_ms*1000);
+		}
+	}
+
+	g_queue_insert_sorted(&REPLIES,queued,compare_due,NULL);
+}
+
+static json_t *make_location(int index)
+{
+	g_autofree char *uri=g_strdup_printf("file:///home/user/project/src/module%d.c",index%97);
+
+	return json_pack("{s:s, s:{s:{s:i, s:i}, s:{s:i, s:i}}}",
+		"uri",uri,
+		"range",
+		"start","line",index,"character",4,
+		"end","line",index,"character",20
+	);
+}
+
+static json_t *make_result(const char *const method)
+{
+	if(strcmp(method,"initialize")==0)
+	{
+		return json_pack("{s:{s:i, s:b, s:b, s:b}}",
+			"capabilities",
+			"textDocumentSync",OPTIONS.sync,
+			"hoverProvider",1,
+			"definitionProvider",1,
+			"referencesProvider",1
+		);
+	}
+
+	if(strcmp(method,"textDocument/definition")==0)
+	{
+		return json_pack("[o]",make_location(1));
+	}
+
+	if(strcmp(method,"textDocument/references")==0)
+	{
+		json_t *locations=json_array();
+
+		for(int i=0;i<OPTIONS.references;i++)
+		{
+			json_array_append_new(locations,make_location(i));
+		}
+
+		return locations;
+	}
+
+	if(strcmp(method,"textDocument/hover")==0)
+	{
+		g_autofree char *text=g_strnfill(OPTIONS.hover_bytes,'x');
+
+		return json_pack("{s:{s:s, s:s}}","contents","kind","markdown","value",text);
+	}
+
+	return NULL;
+}
+
+/**
+	@return
+		FALSE when the server should stop
+*/
+static gboolean handle_message(const char *body, size_t len)
+{
+	json_t *json=json_loadb(body,len,0,NULL);
+
+	if(!json)
+	{
+		return TRUE;
+	}
+
+	const char *method=json_string_value(json_object_get(json,"method"));
+	json_t *id=json_object_get(json,"id");
+	gboolean running=TRUE;
+
+	if(method && strcmp(method,"exit")==0)
+	{
+		running=FALSE;
+	}
+	else if(method && id)
+	{
+		REQUESTS++;
+
+		if(OPTIONS.crash_after>=0 && REQUESTS>OPTIONS.crash_after)
+		{
+			fprintf(stderr,"mock-server: crashing after %ld requests\n",OPTIONS.crash_after);
+			_exit(3);
+		}
+
+		// The handshake is never delayed or failed
+		gboolean immediate=strcmp(method,"initialize")==0 || strcmp(method,"shutdown")==0;
+
+		queue_reply(id,make_result(method),immediate);
+	}
+
+	json_decref(json);
+
+	return running;
+}
+
+static int send_due(void)
+{
+	gint64 now=g_get_monotonic_time();
+
+	while(!g_queue_is_empty(&REPLIES))
+	{
+		MockReply *reply=g_queue_peek_head(&REPLIES);
+
+		if(reply->due_us>now)
+		{
+			return (reply->due_us-now+999)/1000;
+		}
+
+		send_body(reply->body);
+		g_queue_pop_head(&REPLIES);
+		free(reply->body);
+		free(reply);
+	}
+
+	return -1;
+}
+
+static void parse_options(int argc, char **argv)
+{
+	for(int i=1;i+1<argc;i+=2)
+	{
+		const char *value=argv[i+1];
+
+		if(strcmp(argv[i],"--latency-ms")==0) OPTIONS.latency_ms=atoi(value);
+		else if(strcmp(argv[i],"--jitter-ms")==0) OPTIONS.jitter_ms=atoi(value);
+		else if(strcmp(argv[i],"--references")==0) OPTIONS.references=atoi(value);
+		else if(strcmp(argv[i],"--hover-bytes")==0) OPTIONS.hover_bytes=atoi(value);
+		else if(strcmp(argv[i],"--error-rate")==0) OPTIONS.error_rate=g_ascii_strtod(value,NULL);
+		else if(strcmp(argv[i],"--crash-after")==0) OPTIONS.crash_after=atol(value);
+		else if(strcmp(argv[i],"--sync")==0) OPTIONS.sync=atoi(value);
+		else fprintf(stderr,"mock-server: unknown option %s\n",argv[i]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	parse_options(argc,argv);
+
+	LspJumpFrameParser *parser=lspjump_frame_parser_new();
+	gboolean running=TRUE;
+
+	while(running)
+	{
+		struct pollfd fds={.fd=STDIN_FILENO,.events=POLLIN};
+
+		if(poll(&fds,1,send_due())<0 && errno!=EINTR)
+		{
+			break;
+		}
+
+		if(fds.revents & (POLLIN|POLLHUP))
+		{
+			size_t avail;
+			char *buffer=lspjump_frame_parser_reserve(parser,4096,&avail);
+			ssize_t got=buffer?read(STDIN_FILENO,buffer,avail):-1;
+
+			if(got<=0)
+			{
+				break;
+			}
+
+			lspjump_frame_parser_commit(parser,got);
+
+			const char *body;
+			size_t body_len;
+
+			while(running && lspjump_frame_parser_next(parser,&body,&body_len))
+			{
+				running=handle_message(body,body_len);
+			}
+		}
+	}
+
+	lspjump_frame_parser_free(parser);
+
+	return 0;
+}
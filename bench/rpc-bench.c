@@ -0,0 +1,339 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+/**
+	End to end latency of gedit-lspjump-rpc.c against bench/mock-server, without
+	gedit: requests go through the outgoing queue, the pipe, the mock, the I/O
+	thread and back to an action on the main loop.
+
+		rpc-bench [--requests N] [--depth D] [--server PATH] [-- mock-server options]
+
+	Every kind of request is sent N times with at most D of them waiting for a reply,
+	the latencies are from the call until the action runs. Replies are not cached.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../gedit-lspjump-rpc.h"
+#include "../gedit-lspjump-stats.h"
+
+#define WATCH_INTERVAL_MS 50
+
+typedef enum BenchKind
+{
+	BENCH_DEFINITION,
+	BENCH_HOVER,
+	BENCH_REFERENCES,
+	BENCH_KINDS
+}BenchKind;
+
+static const char *const KIND_NAMES[BENCH_KINDS]={"definition","hover","references"};
+
+typedef struct BenchState
+{
+	JsonRpcEndpoint *endpoint;
+	GMainLoop *loop;
+	BenchKind kind;
+	int requests;
+	int depth;
+
+	int sent;
+	int done; // answered, failed or dropped
+	int errors;
+	GArray *latencies; // gint64, microseconds
+	gint64 start_us;
+	size_t checksum;
+}BenchState;
+
+typedef struct BenchRequest
+{
+	BenchState *state;
+	gint64 sent_us;
+}BenchRequest;
+
+static void send_more(BenchState *state);
+
+static void finish_request(BenchRequest *request, gboolean ok)
+{
+	BenchState *state=request->state;
+	gint64 latency=g_get_monotonic_time()-request->sent_us;
+
+	free(request);
+
+	state->done++;
+
+	if(ok)
+	{
+		g_array_append_val(state->latencies,latency);
+	}
+	else
+	{
+		state->errors++;
+	}
+
+	send_more(state);
+}
+
+static void locations_cb(JsonRpcEndpoint *endpoint, LspJumpLocations *locations, void *user_data)
+{
+	if(locations)
+	{
+		// Walked the way the references popup does
+		for(guint i=0;i<locations->len;i++)
+		{
+			LspJumpLocation *location=&locations->items[i];
+
+			((BenchRequest *)user_data)->state->checksum+=strlen(location->uri)+location->line;
+		}
+	}
+
+	finish_request(user_data,locations!=NULL);
+}
+
+static void hover_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+{
+	json_t *value=json_object_get(json_object_get(json_object_get(root,"result"),"contents"),"value");
+
+	if(value)
+	{
+		((BenchRequest *)user_data)->state->checksum+=json_string_length(value);
+	}
+
+	finish_request(user_data,value!=NULL);
+}
+
+static void send_more(BenchState *state)
+{
+	while(state->sent<state->requests && state->sent-state->done<state->depth)
+	{
+		BenchRequest *request=calloc(1,sizeof(BenchRequest));
+		request->state=state;
+		request->sent_us=g_get_monotonic_time();
+
+		const char *uri="file:///tmp/rpc-bench/main.c";
+		long line=state->sent%1000;
+		int id;
+
+		state->sent++;
+
+		switch(state->kind)
+		{
+			case BENCH_DEFINITION:
+				id=lspjump_rpc_definition(state->endpoint,uri,1,NULL,line,4,locations_cb,request);
+				break;
+			case BENCH_HOVER:
+				id=lspjump_rpc_hover(state->endpoint,uri,1,NULL,line,4,hover_cb,request);
+				break;
+			default:
+				id=lspjump_rpc_reference(state->endpoint,uri,1,NULL,line,4,locations_cb,request);
+				break;
+		}
+
+		if(id<0)
+		{
+			free(request);
+			state->done++;
+			state->errors++;
+		}
+	}
+
+	if(state->done>=state->requests)
+	{
+		g_main_loop_quit(state->loop);
+	}
+}
+
+/**
+	Ends the run if the server crashed. Timed out and failed requests call their
+	actions like answered ones, and are counted in done by finish_request.
+*/
+static gboolean watch_endpoint(gpointer data)
+{
+	BenchState *state=data;
+
+	if(state->endpoint->closed)
+	{
+		g_printerr("rpc-bench: the server went away\n");
+		g_main_loop_quit(state->loop);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+	Until the server has answered initialize, or has exited once it is shut down
+*/
+static gboolean wait_for_server(gpointer data)
+{
+	BenchState *state=data;
+
+	if((state->endpoint->initialized && !state->endpoint->shutting_down) || state->endpoint->closed)
+	{
+		g_main_loop_quit(state->loop);
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+	Where the time went, from the histograms gedit-lspjump-rpc.c keeps per method
+*/
+static void print_stages(void)
+{
+	g_autoptr(GPtrArray) methods=lspjump_stats_get_methods();
+
+	for(guint i=0;i<methods->len;i++)
+	{
+		LspJumpMethodStats *stats=g_ptr_array_index(methods,i);
+
+		printf("%s\n",stats->method);
+
+		for(int stage=0;stage<LSPJUMP_STAGE_COUNT;stage++)
+		{
+			const LspJumpHistogram *histogram=&stats->stages[stage];
+
+			printf("    %-10s p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n",LSPJUMP_STAGE_NAMES[stage],
+			       lspjump_histogram_percentile(histogram,50)/1000.0,lspjump_histogram_percentile(histogram,99)/1000.0,histogram->max/1000.0);
+		}
+	}
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+	gint64 first=*(const gint64 *)a, second=*(const gint64 *)b;
+
+	return (first>second)-(first<second);
+}
+
+static void print_result(BenchState *state, gint64 elapsed_us)
+{
+	GArray *latencies=state->latencies;
+
+	qsort(latencies->data,latencies->len,sizeof(gint64),compare_latency);
+
+	if(latencies->len==0)
+	{
+		printf("%-12s no replies, %d errors\n",KIND_NAMES[state->kind],state->errors);
+		return;
+	}
+
+	gint64 *sorted=(gint64 *)latencies->data;
+	gint64 p50=sorted[(latencies->len-1)*50/100];
+	gint64 p99=sorted[(latencies->len-1)*99/100];
+	gint64 max=sorted[latencies->len-1];
+
+	printf("%-12s %6u ok %5d err  p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms  %9.0f req/s\n",
+	       KIND_NAMES[state->kind],latencies->len,state->errors,p50/1000.0,p99/1000.0,max/1000.0,
+	       state->done*1e6/MAX(elapsed_us,1));
+}
+
+int main(int argc, char **argv)
+{
+	BenchState state={.requests=10000,.depth=16};
+	g_autofree char *bench_dir=g_path_get_dirname(argv[0]);
+	g_autofree char *server=g_build_filename(bench_dir,"mock-server",NULL);
+	g_autoptr(GString) server_args=g_string_new(NULL);
+
+	for(int i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"--")==0)
+		{
+			for(i++;i<argc;i++)
+			{
+				g_string_append_printf(server_args,"%s%s",server_args->len?" ":"",argv[i]);
+			}
+		}
+		else if(i+1<argc && strcmp(argv[i],"--requests")==0)
+		{
+			state.requests=atoi(argv[++i]);
+		}
+		else if(i+1<argc && strcmp(argv[i],"--depth")==0)
+		{
+			state.depth=MAX(atoi(argv[++i]),1);
+		}
+		else if(i+1<argc && strcmp(argv[i],"--server")==0)
+		{
+			g_free(server);
+			server=g_strdup(argv[++i]);
+		}
+	}
+
+	state.loop=g_main_loop_new(NULL,FALSE);
+	state.endpoint=lspjump_rpc_endpoint_new("file:///tmp/rpc-bench",server,server_args->str,NULL);
+
+	if(state.endpoint==NULL)
+	{
+		g_printerr("rpc-bench: could not start %s\n",server);
+		return 1;
+	}
+
+	g_timeout_add(1,wait_for_server,&state);
+	g_main_loop_run(state.loop);
+
+	if(!state.endpoint->initialized)
+	{
+		g_printerr("rpc-bench: %s did not initialize\n",server);
+		return 1;
+	}
+
+	printf("%d requests per kind, depth %d, server %s %s\n",state.requests,state.depth,server,server_args->str);
+
+	guint watch=g_timeout_add(WATCH_INTERVAL_MS,watch_endpoint,&state);
+
+	for(BenchKind kind=0;kind<BENCH_KINDS && !state.endpoint->closed;kind++)
+	{
+		state.kind=kind;
+		state.sent=0;
+		state.done=0;
+		state.errors=0;
+		state.latencies=g_array_sized_new(FALSE,FALSE,sizeof(gint64),state.requests);
+		state.start_us=g_get_monotonic_time();
+
+		send_more(&state);
+
+		if(state.done<state.requests)
+		{
+			g_main_loop_run(state.loop);
+		}
+
+		print_result(&state,g_get_monotonic_time()-state.start_us);
+		g_array_free(state.latencies,TRUE);
+	}
+
+	g_source_remove(watch);
+	print_stages();
+
+	RpcStats stats;
+	lspjump_rpc_get_stats(state.endpoint,&stats);
+	printf("dropped %" G_GUINT64_FORMAT ", timed out %" G_GUINT64_FORMAT ", checksum %zu\n",stats.dropped,stats.timed_out,state.checksum);
+
+	// Lets the server exit cleanly, closed is set once the child has been reaped
+	lspjump_rpc_endpoint_shutdown(state.endpoint);
+	g_timeout_add(1,wait_for_server,&state);
+	g_main_loop_run(state.loop);
+
+	lspjump_rpc_endpoint_unref(state.endpoint);
+	g_main_loop_unref(state.loop);
+
+	return 0;
+}
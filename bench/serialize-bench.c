@@ -0,0 +1,231 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+/**
+	Cost of turning a whole document into a didOpen message.
+
+	jansson: the text is packed into a JSON tree, dumped, measured with strlen and
+	copied again behind the header with asprintf, as send_rpc_message used to.
+	stream: the text is escaped a few hundred lines at a time straight into the
+	message buffer, the way lspjump_rpc_did_open does it now.
+
+	Every run is done in a child process, so the peak RSS reported is only that of
+	the path measured. "base" is a child that only builds the document.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "../gedit-lspjump-jsonwrite.h"
+
+#define ROUNDS 5
+#define SEGMENT_LINES 512
+
+typedef enum BenchPath
+{
+	BENCH_BASE,
+	BENCH_JANSSON,
+	BENCH_STREAM
+}BenchPath;
+
+static char *make_document(size_t size)
+{
+	GString *text=g_string_sized_new(size+256);
+	long line=0;
+
+	while(text->len<size)
+	{
+		g_string_append_printf(text,"\tif(value_%ld!=NULL && strcmp(name,\"item %ld\")==0)\n\t{\n\t\tprintf(\"%%s\\t%%d\\n\",name,%ld);\n\t}\n",line,line,line);
+		line++;
+	}
+
+	return g_string_free(text,FALSE);
+}
+
+static size_t run_jansson(const char *text)
+{
+	json_t *params=json_pack("{s:{s:s, s:s, s:i, s:s}}",
+		"textDocument",
+		"uri", "file:///home/user/project/src/big.c",
+		"languageId", "c",
+		"version", 1,
+		"text", text
+	);
+	json_t *root=json_pack("{s:s, s:s}","jsonrpc","2.0","method","textDocument/didOpen");
+	json_object_set(root,"params",params);
+
+	char *json_str=json_dumps(root,JSON_COMPACT);
+	char *send_msg=NULL;
+	int len=asprintf(&send_msg,"Content-Length: %zu\r\n\r\n%s",strlen(json_str),json_str);
+
+	free(send_msg);
+	free(json_str);
+	json_decref(root);
+	json_decref(params);
+
+	return len;
+}
+
+static void write_text(GString *out, void *user_data)
+{
+	const char *start=user_data;
+
+	// Copied out in segments like gtk_text_buffer_get_text does for the real buffer
+	while(*start)
+	{
+		const char *end=start;
+
+		for(int i=0;i<SEGMENT_LINES && *end;i++)
+		{
+			const char *newline=strchr(end,'\n');
+			end=newline?newline+1:end+strlen(end);
+		}
+
+		g_autofree char *segment=g_strndup(start,end-start);
+		lspjump_json_write_escaped(out,segment,end-start);
+
+		start=end;
+	}
+}
+
+static size_t run_stream(const char *text, size_t size)
+{
+	GString *message=g_string_sized_new(size+size/16+256);
+
+	g_string_append(message,"{\"jsonrpc\":\"2.0\",\"method\":");
+	lspjump_json_write_string(message,"textDocument/didOpen");
+	g_string_append(message,",\"params\":{\"textDocument\":{\"uri\":");
+	lspjump_json_write_string(message,"file:///home/user/project/src/big.c");
+	g_string_append(message,",\"languageId\":");
+	lspjump_json_write_string(message,"c");
+	g_string_append_printf(message,",\"version\":%d,\"text\":\"",1);
+	write_text(message,(void *)text);
+	g_string_append(message,"\"}}}");
+
+	char header[48];
+	size_t len=snprintf(header,sizeof(header),"Content-Length: %zu\r\n\r\n",message->len)+message->len;
+
+	g_string_free(message,TRUE);
+
+	return len;
+}
+
+/**
+	@return
+		microseconds per message, written by the child to fd
+*/
+static void child_main(BenchPath path, size_t size, int fd)
+{
+	char *text=make_document(size);
+	size_t len=0;
+	gint64 start=g_get_monotonic_time();
+
+	for(int i=0;i<ROUNDS && path!=BENCH_BASE;i++)
+	{
+		len=path==BENCH_JANSSON?run_jansson(text):run_stream(text,size);
+	}
+
+	gint64 spent=(g_get_monotonic_time()-start)/ROUNDS;
+	gint64 result[2]={spent,(gint64)len};
+
+	if(write(fd,result,sizeof(result))!=sizeof(result))
+	{
+		_exit(1);
+	}
+
+	free(text);
+	_exit(0);
+}
+
+static int run_child(BenchPath path, size_t size, gint64 *us, long *max_rss_kb, size_t *len)
+{
+	int fds[2];
+
+	if(pipe(fds)!=0)
+	{
+		return 1;
+	}
+
+	pid_t pid=fork();
+
+	if(pid==0)
+	{
+		close(fds[0]);
+		child_main(path,size,fds[1]);
+	}
+
+	close(fds[1]);
+
+	gint64 result[2]={0,0};
+	ssize_t got=read(fds[0],result,sizeof(result));
+	close(fds[0]);
+
+	int status;
+	struct rusage usage;
+
+	if(pid<0 || wait4(pid,&status,0,&usage)<0 || got!=sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status)!=0)
+	{
+		return 1;
+	}
+
+	*us=result[0];
+	*len=result[1];
+	*max_rss_kb=usage.ru_maxrss;
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	size_t sizes[]={1<<20,5<<20,20<<20};
+
+	printf("%10s %14s %14s %14s %14s %14s\n","doc MB","base RSS KB","jansson us","jansson RSS KB","stream us","stream RSS KB");
+
+	for(size_t i=0;i<G_N_ELEMENTS(sizes);i++)
+	{
+		gint64 base_us, jansson_us, stream_us;
+		long base_rss, jansson_rss, stream_rss;
+		size_t base_len, jansson_len, stream_len;
+
+		if(run_child(BENCH_BASE,sizes[i],&base_us,&base_rss,&base_len) ||
+		   run_child(BENCH_JANSSON,sizes[i],&jansson_us,&jansson_rss,&jansson_len) ||
+		   run_child(BENCH_STREAM,sizes[i],&stream_us,&stream_rss,&stream_len))
+		{
+			fprintf(stderr,"A benchmark child failed\n");
+			return 1;
+		}
+
+		if(jansson_len!=stream_len)
+		{
+			fprintf(stderr,"Mismatch: %zu != %zu bytes\n",jansson_len,stream_len);
+			return 1;
+		}
+
+		printf("%10zu %14ld %14" G_GINT64_FORMAT " %14ld %14" G_GINT64_FORMAT " %14ld\n",
+		       sizes[i]>>20,base_rss,jansson_us,jansson_rss,stream_us,stream_rss);
+	}
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+# Copyright (c) 2025 Florian Evaldsson
+#
+# This software is provided 'as-is', without any express or implied
+# warranty. In no event will the authors be held liable for any damages
+# arising from the use of this software.
+#
+# Permission is granted to anyone to use this software for any purpose,
+# including commercial applications, and to alter it and redistribute it
+# freely, subject to the following restrictions:
+#
+# 1. The origin of this software must not be misrepresented; you must not
+#    claim that you wrote the original software. If you use this software
+#    in a product, an acknowledgment in the product documentation would be
+#    appreciated but is not required.
+# 2. Altered source versions must be plainly marked as such, and must not be
+#    misrepresented as being the original software.
+# 3. This notice may not be removed or altered from any source distribution.
+#
+# Time from starting gedit until its first window is on screen, with the plugin
+# enabled and disabled.
+#
+#	startup-bench.sh [RUNS] [FILE]
+#
+# Every run is a standalone gedit with its own settings, so no other gedit and
+# no saved session is involved. The plugin has to be installed where gedit
+# finds it, e.g. ~/.local/share/gedit/plugins. Needs X11 (or XWayland) and xdotool.
+
+RUNS=${1:-10}
+FILE=${2:-$(dirname "$0")/../gedit-lspjump.c}
+PLUGIN=lspjump2
+
+if ! command -v xdotool >/dev/null 2>&1
+then
+	echo "startup-bench needs xdotool" >&2
+	exit 1
+fi
+
+CONFIG_HOME=$(mktemp -d)
+trap 'rm -rf "$CONFIG_HOME"' EXIT
+
+# Milliseconds until the window of one gedit is mapped
+first_frame_ms()
+{
+	start=$(date +%s%N)
+	XDG_CONFIG_HOME=$CONFIG_HOME GSETTINGS_BACKEND=keyfile gedit --standalone "$FILE" >/dev/null 2>&1 &
+	pid=$!
+	xdotool search --sync --onlyvisible --pid "$pid" >/dev/null
+	end=$(date +%s%N)
+	kill "$pid"
+	wait "$pid" 2>/dev/null
+	echo $(( (end-start)/1000000 ))
+}
+
+# Runs gedit RUNS times and prints the median and the slowest run
+measure()
+{
+	mkdir -p "$CONFIG_HOME/glib-2.0/settings"
+	printf '[org/gnome/gedit/plugins]\nactive-plugins=%s\n' "$2" > "$CONFIG_HOME/glib-2.0/settings/keyfile"
+
+	# Warm the page cache, the first start is not what is measured
+	first_frame_ms >/dev/null
+
+	i=0
+	while [ "$i" -lt "$RUNS" ]
+	do
+		first_frame_ms
+		i=$((i+1))
+	done | sort -n | awk -v name="$1" '{ ms[NR]=$1 } END { printf "%-10s median %5d ms  max %5d ms  (%d runs)\n", name, ms[int((NR+1)/2)], ms[NR], NR }'
+}
+
+measure disabled "[]"
+measure enabled "['$PLUGIN']"
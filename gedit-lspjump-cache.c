@@ -0,0 +1,314 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-cache.h"
+
+typedef struct LspJumpCacheEntry
+{
+	char *key;
+	char *uri;
+	char *method;
+	LspJumpRange range;
+	int version;
+
+	json_t *reply; // one of reply and locations is set
+	LspJumpLocations *locations;
+	size_t size;
+
+	GList link; // position in the LRU queue, most recently used first
+}LspJumpCacheEntry;
+
+typedef struct LspJumpCache
+{
+	GHashTable *entries; // key -> LspJumpCacheEntry
+	GQueue lru;
+	LspJumpCacheStats stats;
+}LspJumpCache;
+
+static LspJumpCache GLOBAL_CACHE={.stats.budget=LSPJUMP_CACHE_DEFAULT_BUDGET};
+
+static void cache_entry_free(gpointer data)
+{
+	LspJumpCacheEntry *self=data;
+
+	g_queue_unlink(&GLOBAL_CACHE.lru,&self->link);
+	GLOBAL_CACHE.stats.bytes-=self->size;
+
+	json_decref(self->reply);
+	lspjump_locations_unref(self->locations);
+	g_free(self->key);
+	g_free(self->uri);
+	g_free(self->method);
+	free(self);
+}
+
+static GHashTable *get_entries(void)
+{
+	if(GLOBAL_CACHE.entries==NULL)
+	{
+		GLOBAL_CACHE.entries=g_hash_table_new_full(g_str_hash,g_str_equal,NULL,cache_entry_free);
+	}
+
+	return GLOBAL_CACHE.entries;
+}
+
+static char *make_key(const char *const uri, const char *const method, const LspJumpRange *range)
+{
+	return g_strdup_printf("%s\n%s\n%d:%d-%d",method,uri,range->line,range->start,range->end);
+}
+
+/**
+	Rough heap size of a reply, enough to keep the cache within its budget
+*/
+static size_t json_estimate_size(json_t *json)
+{
+	size_t size=sizeof(json_t)+16;
+
+	if(json_is_object(json))
+	{
+		const char *key;
+		json_t *value;
+
+		json_object_foreach(json,key,value)
+		{
+			size+=strlen(key)+32+json_estimate_size(value);
+		}
+	}
+	else if(json_is_array(json))
+	{
+		size_t index;
+		json_t *value;
+
+		json_array_foreach(json,index,value)
+		{
+			size+=sizeof(json_t *)+json_estimate_size(value);
+		}
+	}
+	else if(json_is_string(json))
+	{
+		size+=json_string_length(json)+1;
+	}
+
+	return size;
+}
+
+static void evict_to_budget(void)
+{
+	while(GLOBAL_CACHE.stats.bytes>GLOBAL_CACHE.stats.budget && GLOBAL_CACHE.lru.tail)
+	{
+		LspJumpCacheEntry *oldest=GLOBAL_CACHE.lru.tail->data;
+
+		g_hash_table_remove(get_entries(),oldest->key);
+		GLOBAL_CACHE.stats.evictions++;
+	}
+}
+
+void lspjump_cache_set_budget(size_t budget)
+{
+	GLOBAL_CACHE.stats.budget=budget;
+	evict_to_budget();
+}
+
+static LspJumpCacheEntry *lookup_entry(const char *const uri, int version, const char *const method, const LspJumpRange *range)
+{
+	g_autofree char *key=make_key(uri,method,range);
+	LspJumpCacheEntry *entry=g_hash_table_lookup(get_entries(),key);
+
+	if(entry && entry->version!=version)
+	{
+		g_hash_table_remove(get_entries(),key);
+		entry=NULL;
+	}
+
+	if(entry==NULL)
+	{
+		GLOBAL_CACHE.stats.misses++;
+		return NULL;
+	}
+
+	g_queue_unlink(&GLOBAL_CACHE.lru,&entry->link);
+	g_queue_push_head_link(&GLOBAL_CACHE.lru,&entry->link);
+	GLOBAL_CACHE.stats.hits++;
+
+	return entry;
+}
+
+static LspJumpCacheEntry *store_entry(const char *const uri, int version, const char *const method, const LspJumpRange *range)
+{
+	LspJumpCacheEntry *entry=calloc(1,sizeof(LspJumpCacheEntry));
+
+	entry->key=make_key(uri,method,range);
+	entry->uri=g_strdup(uri);
+	entry->method=g_strdup(method);
+	entry->range=*range;
+	entry->version=version;
+	entry->size=strlen(entry->key)*2+sizeof(LspJumpCacheEntry);
+	entry->link.data=entry;
+
+	// Replaces an older entry with the same key, which unlinks it
+	g_hash_table_replace(get_entries(),entry->key,entry);
+
+	g_queue_push_head_link(&GLOBAL_CACHE.lru,&entry->link);
+
+	return entry;
+}
+
+/**
+	@return
+		the cached reply, owned by the cache, or NULL on a miss
+*/
+json_t *lspjump_cache_lookup(const char *const uri, int version, const char *const method, const LspJumpRange *range)
+{
+	LspJumpCacheEntry *entry=lookup_entry(uri,version,method,range);
+
+	return entry?entry->reply:NULL;
+}
+
+void lspjump_cache_store(const char *const uri, int version, const char *const method, const LspJumpRange *range, json_t *reply)
+{
+	LspJumpCacheEntry *entry=store_entry(uri,version,method,range);
+
+	entry->reply=json_incref(reply);
+	entry->size+=json_estimate_size(reply);
+	GLOBAL_CACHE.stats.bytes+=entry->size;
+
+	evict_to_budget();
+}
+
+/**
+	@return
+		the cached locations, owned by the cache, or NULL on a miss
+*/
+LspJumpLocations *lspjump_cache_lookup_locations(const char *const uri, int version, const char *const method, const LspJumpRange *range)
+{
+	LspJumpCacheEntry *entry=lookup_entry(uri,version,method,range);
+
+	return entry?entry->locations:NULL;
+}
+
+void lspjump_cache_store_locations(const char *const uri, int version, const char *const method, const LspJumpRange *range, LspJumpLocations *locations)
+{
+	LspJumpCacheEntry *entry=store_entry(uri,version,method,range);
+
+	entry->locations=lspjump_locations_ref(locations);
+	entry->size+=lspjump_locations_size(locations);
+	GLOBAL_CACHE.stats.bytes+=entry->size;
+
+	evict_to_budget();
+}
+
+/**
+	Called for every edit, before it is applied.
+
+	Locations can point anywhere, including into the edited text, so any edit drops
+	them. Hover entries in the edited document survive edits outside their line and
+	move along with the lines, the rest of the document is still the same text.
+	Only entries of the current text can be moved, an older reply missed the line
+	shifts since and is dropped.
+
+	@param next_version
+		the version the document will have once the edit has been sent
+	@param first_line
+	@param last_line
+		the lines the edit touches, in the text before the edit
+	@param line_delta
+		how many lines the edit adds, negative if it removes lines
+*/
+void lspjump_cache_document_changed(const char *const uri, int next_version, int first_line, int last_line, int line_delta)
+{
+	GHashTable *entries=get_entries();
+	GHashTableIter iter;
+	gpointer key, value;
+	GSList *moved=NULL;
+
+	g_hash_table_iter_init(&iter,entries);
+
+	while(g_hash_table_iter_next(&iter,&key,&value))
+	{
+		LspJumpCacheEntry *entry=value;
+
+		if(g_strcmp0(entry->method,"textDocument/hover")!=0)
+		{
+			g_hash_table_iter_remove(&iter);
+			GLOBAL_CACHE.stats.invalidations++;
+			continue;
+		}
+
+		if(g_strcmp0(entry->uri,uri)!=0)
+		{
+			continue;
+		}
+
+		// Edits before a flush share next_version, entries already moved by one of them have it
+		gboolean current=entry->version==next_version-1 || entry->version==next_version;
+
+		if(!current || (entry->range.line>=first_line && entry->range.line<=last_line))
+		{
+			g_hash_table_iter_remove(&iter);
+			GLOBAL_CACHE.stats.invalidations++;
+		}
+		else
+		{
+			entry->version=next_version;
+
+			if(entry->range.line>last_line && line_delta!=0)
+			{
+				g_hash_table_iter_steal(&iter);
+				moved=g_slist_prepend(moved,entry);
+			}
+		}
+	}
+
+	for(GSList *item=moved;item;item=item->next)
+	{
+		LspJumpCacheEntry *entry=item->data;
+
+		entry->range.line+=line_delta;
+		g_free(entry->key);
+		entry->key=make_key(entry->uri,entry->method,&entry->range);
+
+		g_hash_table_replace(entries,entry->key,entry);
+	}
+
+	g_slist_free(moved);
+}
+
+void lspjump_cache_clear(void)
+{
+	g_hash_table_remove_all(get_entries());
+}
+
+void lspjump_cache_get_stats(LspJumpCacheStats *stats)
+{
+	*stats=GLOBAL_CACHE.stats;
+	stats->entries=g_hash_table_size(get_entries());
+}
+
+double lspjump_cache_hit_rate(void)
+{
+	guint64 total=GLOBAL_CACHE.stats.hits+GLOBAL_CACHE.stats.misses;
+
+	return total?(double)GLOBAL_CACHE.stats.hits/total:0.0;
+}
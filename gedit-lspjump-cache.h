@@ -0,0 +1,65 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <jansson.h>
+
+#include "gedit-lspjump-jsonpull.h"
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_CACHE_DEFAULT_BUDGET (8*1024*1024)
+
+/**
+	Range of the identifier a request was made on, within one line
+*/
+typedef struct LspJumpRange
+{
+	int line;
+	int start;
+	int end;
+}LspJumpRange;
+
+typedef struct LspJumpCacheStats
+{
+	guint64 hits;
+	guint64 misses;
+	guint64 evictions;
+	guint64 invalidations;
+	guint entries;
+	size_t bytes;
+	size_t budget;
+}LspJumpCacheStats;
+
+void lspjump_cache_set_budget(size_t budget);
+
+json_t *lspjump_cache_lookup(const char *const uri, int version, const char *const method, const LspJumpRange *range);
+void lspjump_cache_store(const char *const uri, int version, const char *const method, const LspJumpRange *range, json_t *reply);
+LspJumpLocations *lspjump_cache_lookup_locations(const char *const uri, int version, const char *const method, const LspJumpRange *range);
+void lspjump_cache_store_locations(const char *const uri, int version, const char *const method, const LspJumpRange *range, LspJumpLocations *locations);
+
+void lspjump_cache_document_changed(const char *const uri, int next_version, int first_line, int last_line, int line_delta);
+void lspjump_cache_clear(void);
+
+void lspjump_cache_get_stats(LspJumpCacheStats *stats);
+double lspjump_cache_hit_rate(void);
+
+G_END_DECLS
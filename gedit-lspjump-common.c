@@ -18,6 +18,9 @@ freely, subject to the following restrictions:
 3. This notice may not be removed or altered from any source distribution.
 */
 #include "gedit-lspjump-common.h"
+#include "gedit-lspjump-timeline.h"
+#include "gedit-lspjump-docsync.h"
+#include "gedit-lspjump-history.h"
 
 const char *get_programming_language(GeditWindow *window)
 {
@@ -42,8 +45,6 @@ const char *get_programming_language(GeditWindow *window)
 	//		(*line_language_start) = gtk_source_language_get_metadata(language, "line-language-start");
 	//
 	//		printf("LANG: %s [%s %s %s]\n", pango_language_to_string(lang), *block_language_start, *block_language_end, *line_language_start);
-			printf("LANG: %s\n", gtk_source_language_get_id(language));
-			
 			return gtk_source_language_get_id(language);
 		}
 	}
@@ -51,6 +52,44 @@ const char *get_programming_language(GeditWindow *window)
 	return NULL;
 }
 
+static gboolean is_identifier_char(gunichar c)
+{
+	return g_unichar_isalnum(c) || c=='_';
+}
+
+/**
+	Find the identifier around iter. GTK word boundaries split at '_', so the
+	characters are checked here instead.
+
+	@return
+		TRUE if iter is on an identifier, start and end are set to its bounds
+*/
+gboolean lspjump_get_identifier_bounds(const GtkTextIter *iter, GtkTextIter *start, GtkTextIter *end)
+{
+	*start=*iter;
+	*end=*iter;
+
+	while(!gtk_text_iter_starts_line(start))
+	{
+		GtkTextIter prev=*start;
+		gtk_text_iter_backward_char(&prev);
+
+		if(!is_identifier_char(gtk_text_iter_get_char(&prev)))
+		{
+			break;
+		}
+
+		*start=prev;
+	}
+
+	while(!gtk_text_iter_ends_line(end) && is_identifier_char(gtk_text_iter_get_char(end)))
+	{
+		gtk_text_iter_forward_char(end);
+	}
+
+	return !gtk_text_iter_equal(start,end);
+}
+
 GFile *lspjump_get_active_file_from_window(GeditWindow *window)
 {
 	GeditTab *active_tab = gedit_window_get_active_tab(window);
@@ -76,6 +115,16 @@ GFile *lspjump_get_active_file_from_window(GeditWindow *window)
 	return gtk_source_file_get_location(source_file);
 }
 
+char *get_full_text_from_document(GeditDocument *doc)
+{
+	GtkTextIter start, end;
+
+	gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(doc), &start);
+	gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(doc), &end);
+
+	return gtk_text_buffer_get_text(GTK_TEXT_BUFFER(doc), &start, &end, FALSE);
+}
+
 char *get_full_text_from_active_document(GeditWindow *window)
 {
 	GeditTab *tab = gedit_window_get_active_tab(window);
@@ -85,21 +134,23 @@ char *get_full_text_from_active_document(GeditWindow *window)
 		return NULL;
 	}
 
-	GeditDocument *doc = gedit_tab_get_document(tab);
-	GtkTextIter start, end;
-
-	gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(doc), &start);
-	gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(doc), &end);
-
-	gchar *text = gtk_text_buffer_get_text(GTK_TEXT_BUFFER(doc), &start, &end, FALSE);
+	gint64 timeline_start=LSPJUMP_TIMELINE_START();
+	char *text=get_full_text_from_document(gedit_tab_get_document(tab));
+	
+	LSPJUMP_TIMELINE_SPAN("ui","get_full_text_from_active_document",timeline_start,0,LSPJUMP_FLOW_NONE);
 
-//	g_print("Document text:\n%s\n", text);
-//	g_free(text);
 	return text;
 }
 
+static void on_tab_loaded(GeditDocument *doc, gpointer user_data)
+{
+	lspjump_timeline_async("ui","tab load",GPOINTER_TO_UINT(user_data),FALSE);
+	g_signal_handlers_disconnect_by_func(doc,on_tab_loaded,user_data);
+}
+
 int gedit_lspjump_goto_file_line_column(GeditWindow *window, GFile *gfile, long line, long character)
 {
+	gint64 timeline_start=LSPJUMP_TIMELINE_START();
 	GeditTab *tab=gedit_window_get_tab_from_location(window,gfile);
 	
 	if(tab)
@@ -126,6 +177,16 @@ int gedit_lspjump_goto_file_line_column(GeditWindow *window, GFile *gfile, long
 	{
 		GeditTab *tab=gedit_window_create_tab(window,TRUE);
 		
+		// Loading goes on in the main loop, the timeline shows it from here to "loaded"
+		if(LSPJUMP_TIMELINE_ON)
+		{
+			static guint load_id=0;
+			
+			load_id++;
+			lspjump_timeline_async("ui","tab load",load_id,TRUE);
+			g_signal_connect(gedit_tab_get_document(tab),"loaded",G_CALLBACK(on_tab_loaded),GUINT_TO_POINTER(load_id));
+		}
+		
 		gedit_tab_load_file(tab,gfile,NULL,line+1,character+1,FALSE);
 
 		if (!tab)
@@ -135,82 +196,91 @@ int gedit_lspjump_goto_file_line_column(GeditWindow *window, GFile *gfile, long
 			return -1;
 		}
 	}
-}
-
-void track_pos_free(gpointer data)
-{
-	TrackPos *const self=data;
-	g_object_unref(self->file);
-	free(self);
+	
+	LSPJUMP_TIMELINE_SPAN("ui","gedit_lspjump_goto_file_line_column",timeline_start,0,LSPJUMP_FLOW_NONE);
+	
+	return 0;
 }
 
 int gedit_lspjump_goto_file_line_column_and_track(GeditWindow *window, GFile *gfile, long line, long character)
 {
-	GeditDocument *document = gedit_window_get_active_document(window);
+	lspjump_history_track(window,gfile,line,character);
 
-	GFile *prev_file=lspjump_get_active_file_from_window(window);
-	
-	GeditTab *tab = gedit_window_get_active_tab(window);
-	if (!tab)
-	{
-		g_print("No active tab.\n");
-		return -1;
-	}
+	return gedit_lspjump_goto_file_line_column(window,gfile,line,character);
+}
 
-	GeditDocument *doc = gedit_tab_get_document(tab);
-	
-	GtkTextBuffer *buffer = GTK_TEXT_BUFFER(doc);
+typedef struct LspPositionFixup
+{
+	long line;
+	long character;
+	LspJumpPositionEncoding encoding;
+}LspPositionFixup;
 
-	// Get the current cursor position
+static gboolean fix_lsp_position(gpointer data)
+{
+	GeditDocument *doc=data;
+	LspPositionFixup *fixup=g_object_steal_data(G_OBJECT(doc),"lspjump-position-fixup");
+	GtkTextBuffer *buffer=GTK_TEXT_BUFFER(doc);
 	GtkTextIter iter;
-	gtk_text_buffer_get_iter_at_mark(buffer, &iter, gtk_text_buffer_get_insert(buffer));
 	
-	TrackPos *new_pos=calloc(1,sizeof(TrackPos));
-	new_pos->file=g_file_dup(prev_file);
-	new_pos->line=gtk_text_iter_get_line(&iter);
-	new_pos->character=gtk_text_iter_get_line_offset(&iter);
+	gtk_text_buffer_get_iter_at_mark(buffer,&iter,gtk_text_buffer_get_insert(buffer));
 	
-	TrackPos *forward_pos=calloc(1,sizeof(TrackPos));
-	forward_pos->file=g_file_dup(gfile);
-	forward_pos->line=line;
-	forward_pos->character=character;
+	// Unless the cursor has been moved since
+	if(fixup && gtk_text_iter_get_line(&iter)==fixup->line)
+	{
+		int offset=lspjump_document_sync_from_lsp_column(doc,fixup->line,fixup->character,fixup->encoding);
+		
+		gtk_text_buffer_get_iter_at_line_offset(buffer,&iter,fixup->line,offset);
+		gtk_text_buffer_place_cursor(buffer,&iter);
+	}
 	
-	g_queue_push_tail(GLOBAL_BACK_STACK,new_pos);
+	free(fixup);
+	g_object_unref(doc);
 	
-	g_queue_clear_full(GLOBAL_FORWARD_STACK,track_pos_free);
-	g_queue_push_tail(GLOBAL_FORWARD_STACK,forward_pos);
+	return G_SOURCE_REMOVE;
+}
 
-	gedit_lspjump_goto_file_line_column(window,gfile,line,character);
+static void on_fixup_loaded(GeditDocument *doc, gpointer user_data)
+{
+	g_signal_handlers_disconnect_by_func(doc,on_fixup_loaded,user_data);
+	
+	// After gedit has put the cursor where it was asked to
+	g_idle_add(fix_lsp_position,g_object_ref(doc));
 }
 
-int gedit_lspjump_do_undo(GeditWindow *window)
+/**
+	Go to a position a server sent, its character is counted in the encoding of
+	the server. A file that is not open yet is opened on the line and the column is
+	corrected once it has loaded.
+*/
+int gedit_lspjump_goto_lsp_position_and_track(GeditWindow *window, GFile *gfile, long line, long character, LspJumpPositionEncoding encoding)
 {
-	TrackPos *pos=g_queue_pop_tail(GLOBAL_BACK_STACK);
+	GeditTab *tab=gedit_window_get_tab_from_location(window,gfile);
 	
-	if(pos)
+	if(tab)
 	{
-		gedit_lspjump_goto_file_line_column(window,pos->file,pos->line,pos->character);
+		character=lspjump_document_sync_from_lsp_column(gedit_tab_get_document(tab),line,character,encoding);
 		
-//		g_object_unref(pos->file);
-//		free(pos);
-		g_queue_push_tail(GLOBAL_FORWARD_STACK,pos);
+		return gedit_lspjump_goto_file_line_column_and_track(window,gfile,line,character);
 	}
 	
-	return 0;
-}
-
-int gedit_lspjump_do_redo(GeditWindow *window)
-{
-	TrackPos *pos=g_queue_pop_tail(GLOBAL_FORWARD_STACK);
+	int ret=gedit_lspjump_goto_file_line_column_and_track(window,gfile,line,character);
+	
+	// Characters are the same in every encoding, or the file did not open
+	tab=gedit_window_get_active_tab(window);
 	
-	if(pos)
+	if(encoding!=LSPJUMP_POSITION_UTF32 && tab && ret==0)
 	{
-		gedit_lspjump_goto_file_line_column(window,pos->file,pos->line,pos->character);
+		GeditDocument *doc=gedit_tab_get_document(tab);
+		LspPositionFixup *fixup=calloc(1,sizeof(LspPositionFixup));
 		
-//		g_object_unref(pos->file);
-//		free(pos);
-		g_queue_push_tail(GLOBAL_BACK_STACK,pos);
+		fixup->line=line;
+		fixup->character=character;
+		fixup->encoding=encoding;
+		
+		g_object_set_data_full(G_OBJECT(doc),"lspjump-position-fixup",fixup,free);
+		g_signal_connect_after(doc,"loaded",G_CALLBACK(on_fixup_loaded),NULL);
 	}
 	
-	return 0;
+	return ret;
 }
@@ -24,28 +24,17 @@ freely, subject to the following restrictions:
 #include <gedit/gedit-window.h>
 #include <gedit/gedit-document.h>
 
-G_BEGIN_DECLS
-
-extern GQueue *GLOBAL_BACK_STACK;
-extern GQueue *GLOBAL_FORWARD_STACK;
+#include "gedit-lspjump-mirror.h"
 
-typedef struct TrackPos
-{
-	GFile *file;
-	long line;
-	long character;
-}TrackPos;
+G_BEGIN_DECLS
 
 const char *get_programming_language(GeditWindow *window);
 GFile *lspjump_get_active_file_from_window(GeditWindow *window);
+gboolean lspjump_get_identifier_bounds(const GtkTextIter *iter, GtkTextIter *start, GtkTextIter *end);
+char *get_full_text_from_document(GeditDocument *doc);
 char *get_full_text_from_active_document(GeditWindow *window);
 int gedit_lspjump_goto_file_line_column(GeditWindow *window, GFile *gfile, long line, long character);
 int gedit_lspjump_goto_file_line_column_and_track(GeditWindow *window, GFile *gfile, long line, long character);
-int gedit_lspjump_do_undo(GeditWindow *window);
-int gedit_lspjump_do_redo(GeditWindow *window);
-
-void track_pos_free(gpointer data);
-
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(json_t,json_decref)
+int gedit_lspjump_goto_lsp_position_and_track(GeditWindow *window, GFile *gfile, long line, long character, LspJumpPositionEncoding encoding);
 
 G_END_DECLS
@@ -29,11 +29,37 @@ freely, subject to the following restrictions:
 
 GPtrArray *GLOBAL_LSPJUMP_CONFIGURATIONS = NULL;
 
-static void parse_lspjump_file(const char *filepath);
-static void process_lspjump(xmlNode *node);
+static LspJumpConfigurationTable *GLOBAL_CONFIGURATION_TABLE=NULL;
+static GPtrArray *GLOBAL_CONFIGURATION_MONITORS=NULL; // GFileMonitor on every configuration directory
+static guint GLOBAL_CONFIGURATION_RELOAD_SOURCE=0;
 
-void lspjump_configuration_file_free(LspJumpConfigurationFile *self)
+LspJumpConfigurationFile *lspjump_configuration_file_new(GFile *file, xmlDoc *doc)
 {
+	LspJumpConfigurationFile *self=calloc(1,sizeof(LspJumpConfigurationFile));
+	self->ref_count=1;
+	self->file=g_object_ref(file);
+	self->doc=doc;
+	
+	return self;
+}
+
+LspJumpConfigurationFile *lspjump_configuration_file_ref(LspJumpConfigurationFile *self)
+{
+	g_atomic_int_inc(&self->ref_count);
+	return self;
+}
+
+/**
+	The settings window edits the document of a file, so it lives until the window
+	is done with it even if the file has been reloaded since
+*/
+void lspjump_configuration_file_unref(LspJumpConfigurationFile *self)
+{
+	if(self==NULL || !g_atomic_int_dec_and_test(&self->ref_count))
+	{
+		return;
+	}
+	
 	g_object_unref(self->file);
 	xmlFreeDoc(self->doc);
 	free(self);
@@ -58,7 +84,7 @@ char *get_so_directory()
 	return dir;
 }
 
-static void parse_lspjump_file(const char *filepath)
+static void parse_lspjump_file(GPtrArray *files, const char *filepath)
 {
 	xmlDoc *doc = xmlReadFile(filepath, NULL, 0);
 	if (!doc)
@@ -66,31 +92,40 @@ static void parse_lspjump_file(const char *filepath)
 		return;
 	}
 	
-	LspJumpConfigurationFile *cfile=calloc(1,sizeof(LspJumpConfigurationFile));
-	cfile->file=g_file_new_for_path(filepath);
-	cfile->doc=doc;
+	g_autoptr(GFile) file=g_file_new_for_path(filepath);
 	
-	g_ptr_array_add(GLOBAL_LSPJUMP_CONFIGURATIONS,cfile);
+	g_ptr_array_add(files,lspjump_configuration_file_new(file,doc));
 }
 
-void exit_configuration(int exit_status, void *arg)
-{
-	g_ptr_array_free(GLOBAL_LSPJUMP_CONFIGURATIONS,TRUE);
-}
-
-int load_configuration()
+/**
+	@return
+		the directories configuration files are read from, in order
+*/
+static GStrv get_configuration_dirs(void)
 {
-	GLOBAL_LSPJUMP_CONFIGURATIONS = g_ptr_array_new_with_free_func((GDestroyNotify)lspjump_configuration_file_free);
-	
-	on_exit(exit_configuration,NULL);
+	GPtrArray *dirs=g_ptr_array_new();
+	char *so_dir = get_so_directory();
 	
-	g_autofree char *home_config_dir = g_build_filename(g_get_home_dir(), ".config/gedit/lspjump/", NULL);
+	if(so_dir)
+	{
+		g_ptr_array_add(dirs,g_strdup(so_dir));
+		free(so_dir);
+	}
 	
-	g_autofree char *so_dir = get_so_directory();
+	g_ptr_array_add(dirs,g_build_filename(g_get_home_dir(), ".config/gedit/lspjump/", NULL));
+	g_ptr_array_add(dirs,g_strdup("/usr/share/gedit/plugins/lspjump/"));
+	g_ptr_array_add(dirs,g_strdup("/usr/local/share/gedit/plugins/lspjump/"));
+	g_ptr_array_add(dirs,NULL);
 	
-	char *dirs[] = {so_dir, home_config_dir, "/usr/share/gedit/plugins/lspjump/", "/usr/local/share/gedit/plugins/lspjump/"};
+	return (GStrv)g_ptr_array_free(dirs,FALSE);
+}
+
+static GPtrArray *read_configuration_files(void)
+{
+	GPtrArray *files=g_ptr_array_new_with_free_func((GDestroyNotify)lspjump_configuration_file_unref);
+	g_auto(GStrv) dirs=get_configuration_dirs();
 
-	for (size_t i = 0; i < G_N_ELEMENTS(dirs); i++)
+	for (size_t i = 0; dirs[i]; i++)
 	{
 		g_autoptr(GError) error = NULL;
 		g_autoptr(GDir) dir = g_dir_open(dirs[i], 0, &error);
@@ -107,13 +142,13 @@ int load_configuration()
 				printf("Read configuration file: %s\n",filename);
 			
 				char *filepath = g_build_filename(dirs[i], filename, NULL);
-				parse_lspjump_file(filepath);
+				parse_lspjump_file(files,filepath);
 				g_free(filepath);
 			}
 		}
 	}
-
-	return 0;
+	
+	return files;
 }
 
 xmlNode *xml_get_child_by_tag(xmlNode *parent, const char *const tag)
@@ -127,3 +162,368 @@ xmlNode *xml_get_child_by_tag(xmlNode *parent, const char *const tag)
 	}
 	return NULL;
 }
+
+LspJumpProfile *lspjump_profile_ref(LspJumpProfile *self)
+{
+	g_atomic_int_inc(&self->ref_count);
+	return self;
+}
+
+void lspjump_profile_unref(LspJumpProfile *self)
+{
+	if(self==NULL || !g_atomic_int_dec_and_test(&self->ref_count))
+	{
+		return;
+	}
+	
+	g_free(self->name);
+	g_free(self->languages);
+	g_free(self->bin);
+	g_free(self->bin_args);
+	g_free(self->search);
+	g_free(self->settings);
+	json_decref(self->capabilities);
+	lspjump_configuration_file_unref(self->file);
+	free(self);
+}
+
+static char *get_child_content(xmlNode *node, const char *const tag)
+{
+	xmlNode *child=xml_get_child_by_tag(node,tag);
+	
+	if(child==NULL)
+	{
+		return NULL;
+	}
+	
+	xmlChar *content=xmlNodeGetContent(child);
+	char *ret=g_strdup((const char *)content);
+	xmlFree(content);
+	
+	return ret;
+}
+
+static LspJumpProfile *profile_new(LspJumpConfigurationFile *file, xmlNode *node, guint index)
+{
+	LspJumpProfile *self=calloc(1,sizeof(LspJumpProfile));
+	xmlChar *name=xmlGetProp(node,(const xmlChar *)"name");
+	
+	self->ref_count=1;
+	self->name=g_strdup((const char *)name);
+	self->languages=get_child_content(node,"lsp_language");
+	self->bin=get_child_content(node,"lsp_bin");
+	self->bin_args=get_child_content(node,"lsp_bin_args");
+	self->search=get_child_content(node,"lsp_search");
+	self->settings=get_child_content(node,"lsp_settings");
+	self->index=index;
+	self->file=lspjump_configuration_file_ref(file);
+	self->node=node;
+	
+	xmlFree(name);
+	
+	if(self->settings && *self->settings)
+	{
+		json_error_t error;
+		self->capabilities=json_loads(self->settings,0,&error);
+		
+		if(self->capabilities==NULL)
+		{
+			fprintf(stderr, "JSON parse error in the settings of %s on line %d: %s\n", self->name, error.line, error.text);
+			self->broken_settings=1;
+		}
+	}
+	
+	return self;
+}
+
+static void table_add_profile(LspJumpConfigurationTable *self, LspJumpProfile *profile)
+{
+	g_ptr_array_add(self->profiles,profile);
+	
+	if(profile->name && !g_hash_table_contains(self->by_name,profile->name))
+	{
+		g_hash_table_insert(self->by_name,g_strdup(profile->name),profile);
+	}
+	
+	g_auto(GStrv) list=g_strsplit(profile->languages?profile->languages:"",",",-1);
+	
+	for(int i=0;list[i];i++)
+	{
+		g_autofree char *language=g_ascii_strdown(g_strstrip(list[i]),-1);
+		
+		if(*language && !g_hash_table_contains(self->by_language,language))
+		{
+			g_hash_table_insert(self->by_language,g_steal_pointer(&language),profile);
+		}
+	}
+}
+
+/**
+	A global setting is a child of the root element that is not a language
+	profile, e.g. <hover_delay>350</hover_delay>. The first file that has it wins.
+*/
+static void table_add_setting(LspJumpConfigurationTable *self, xmlNode *node)
+{
+	if(g_hash_table_contains(self->settings,(const char *)node->name))
+	{
+		return;
+	}
+	
+	xmlChar *content=xmlNodeGetContent(node);
+	
+	if(content==NULL)
+	{
+		return;
+	}
+	
+	char *end=NULL;
+	long value=strtol((const char *)content,&end,10);
+	
+	if(end!=(char *)content)
+	{
+		g_hash_table_insert(self->settings,g_strdup((const char *)node->name),GINT_TO_POINTER(value));
+	}
+	
+	xmlFree(content);
+}
+
+static LspJumpConfigurationTable *table_compile(GPtrArray *files)
+{
+	LspJumpConfigurationTable *self=calloc(1,sizeof(LspJumpConfigurationTable));
+	self->ref_count=1;
+	self->profiles=g_ptr_array_new_with_free_func((GDestroyNotify)lspjump_profile_unref);
+	self->by_language=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+	self->by_name=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+	self->settings=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+	
+	for(guint i=0;i<files->len;i++)
+	{
+		LspJumpConfigurationFile *conf=g_ptr_array_index(files,i);
+		xmlNode *root=xmlDocGetRootElement(conf->doc);
+		
+		for(xmlNode *node=root?root->children:NULL;node;node=node->next)
+		{
+			if(node->type!=XML_ELEMENT_NODE)
+			{
+				continue;
+			}
+			
+			if(xmlStrcmp(node->name,(const xmlChar *)"language")==0)
+			{
+				table_add_profile(self,profile_new(conf,node,self->profiles->len));
+			}
+			else
+			{
+				table_add_setting(self,node);
+			}
+		}
+	}
+	
+	return self;
+}
+
+void lspjump_configuration_table_unref(LspJumpConfigurationTable *self)
+{
+	if(self==NULL || !g_atomic_int_dec_and_test(&self->ref_count))
+	{
+		return;
+	}
+	
+	g_hash_table_unref(self->by_language);
+	g_hash_table_unref(self->by_name);
+	g_hash_table_unref(self->settings);
+	g_ptr_array_unref(self->profiles);
+	free(self);
+}
+
+/**
+	The current table. Tables are swapped on the main thread, which is also where
+	they are asked for. The configuration is read if it has not been yet.
+
+	@return
+		a new reference
+*/
+LspJumpConfigurationTable *lspjump_configuration_get_table(void)
+{
+	load_configuration();
+	
+	LspJumpConfigurationTable *self=g_atomic_pointer_get(&GLOBAL_CONFIGURATION_TABLE);
+	
+	if(self)
+	{
+		g_atomic_int_inc(&self->ref_count);
+	}
+	
+	return self;
+}
+
+/**
+	Compile the documents in GLOBAL_LSPJUMP_CONFIGURATIONS and use the result from
+	now on. Called again by whoever changes the documents.
+*/
+void lspjump_configuration_compile(void)
+{
+	LspJumpConfigurationTable *table=table_compile(GLOBAL_LSPJUMP_CONFIGURATIONS);
+	LspJumpConfigurationTable *old=g_atomic_pointer_exchange(&GLOBAL_CONFIGURATION_TABLE,table);
+	
+	lspjump_configuration_table_unref(old);
+}
+
+static gboolean reload_timeout(gpointer data)
+{
+	GLOBAL_CONFIGURATION_RELOAD_SOURCE=0;
+	
+	g_print("Reloading the configuration\n");
+	
+	// The settings window holds references to the files it shows
+	g_ptr_array_unref(GLOBAL_LSPJUMP_CONFIGURATIONS);
+	GLOBAL_LSPJUMP_CONFIGURATIONS=read_configuration_files();
+	lspjump_configuration_compile();
+	
+	return G_SOURCE_REMOVE;
+}
+
+static void on_configuration_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event_type, gpointer user_data)
+{
+	switch(event_type)
+	{
+		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		case G_FILE_MONITOR_EVENT_CREATED:
+		case G_FILE_MONITOR_EVENT_DELETED:
+		case G_FILE_MONITOR_EVENT_MOVED_IN:
+		case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		case G_FILE_MONITOR_EVENT_RENAMED:
+			break;
+		default:
+			return;
+	}
+	
+	g_autofree char *name=g_file_get_basename(file);
+	g_autofree char *other_name=other_file?g_file_get_basename(other_file):NULL;
+	
+	if(!g_str_has_suffix(name,".xml") && !(other_name && g_str_has_suffix(other_name,".xml")))
+	{
+		return;
+	}
+	
+	// An editor saving a file sends several events, they are all one reload
+	g_clear_handle_id(&GLOBAL_CONFIGURATION_RELOAD_SOURCE,g_source_remove);
+	GLOBAL_CONFIGURATION_RELOAD_SOURCE=g_timeout_add(LSPJUMP_CONFIGURATION_RELOAD_DELAY_MS,reload_timeout,NULL);
+}
+
+static void watch_configuration_dirs(void)
+{
+	GLOBAL_CONFIGURATION_MONITORS=g_ptr_array_new_with_free_func(g_object_unref);
+	g_auto(GStrv) dirs=get_configuration_dirs();
+	
+	for(size_t i=0;dirs[i];i++)
+	{
+		g_autoptr(GFile) dir=g_file_new_for_path(dirs[i]);
+		GFileMonitor *monitor=g_file_monitor_directory(dir,G_FILE_MONITOR_WATCH_MOVES,NULL,NULL);
+		
+		if(monitor)
+		{
+			g_signal_connect(monitor,"changed",G_CALLBACK(on_configuration_changed),NULL);
+			g_ptr_array_add(GLOBAL_CONFIGURATION_MONITORS,monitor);
+		}
+	}
+}
+
+/**
+	Forget the configuration, the next use reads it again
+*/
+void lspjump_configuration_unload(void)
+{
+	g_clear_handle_id(&GLOBAL_CONFIGURATION_RELOAD_SOURCE,g_source_remove);
+	g_clear_pointer(&GLOBAL_CONFIGURATION_MONITORS,g_ptr_array_unref);
+	lspjump_configuration_table_unref(g_atomic_pointer_exchange(&GLOBAL_CONFIGURATION_TABLE,NULL));
+	g_clear_pointer(&GLOBAL_LSPJUMP_CONFIGURATIONS,g_ptr_array_unref);
+}
+
+/**
+	Read and compile the configuration files, unless that has been done already.
+	Not done when the plugin is loaded, it scans four directories and parses every
+	file in them: the first use or an idle callback after gedit is up does it.
+*/
+int load_configuration()
+{
+	if(GLOBAL_LSPJUMP_CONFIGURATIONS)
+	{
+		return 0;
+	}
+	
+	GLOBAL_LSPJUMP_CONFIGURATIONS = read_configuration_files();
+	
+	lspjump_configuration_compile();
+	watch_configuration_dirs();
+
+	return 0;
+}
+
+/**
+	Get a global setting, e.g. <hover_delay>350</hover_delay>
+*/
+int lspjump_configuration_get_int(const char *const tag, int default_value)
+{
+	g_autoptr(LspJumpConfigurationTable) table=lspjump_configuration_get_table();
+	gpointer value;
+
+	if(table && g_hash_table_lookup_extended(table->settings,tag,NULL,&value))
+	{
+		return GPOINTER_TO_INT(value);
+	}
+
+	return default_value;
+}
+
+static LspJumpProfile *table_lookup_language(LspJumpConfigurationTable *table, const char *const language)
+{
+	if(language==NULL)
+	{
+		return NULL;
+	}
+	
+	g_autofree char *key=g_ascii_strdown(language,-1);
+	
+	return g_hash_table_lookup(table->by_language,key);
+}
+
+/**
+	Find the first profile that lists the language. Profiles name languages the way
+	the user wrote them, both the GtkSourceView id (cpp) and name (C++) match.
+
+	@return
+		a new reference to the profile, or NULL if no profile handles the language
+*/
+LspJumpProfile *lspjump_configuration_find_profile(const char *const language_id, const char *const language_name)
+{
+	g_autoptr(LspJumpConfigurationTable) table=lspjump_configuration_get_table();
+	
+	if(table==NULL)
+	{
+		return NULL;
+	}
+	
+	LspJumpProfile *by_id=table_lookup_language(table,language_id);
+	LspJumpProfile *by_name=table_lookup_language(table,language_name);
+	LspJumpProfile *profile=by_id;
+	
+	if(by_name && (profile==NULL || by_name->index<profile->index))
+	{
+		profile=by_name;
+	}
+	
+	return profile?lspjump_profile_ref(profile):NULL;
+}
+
+/**
+	@return
+		a new reference to the profile, or NULL if there is no profile with that name
+*/
+LspJumpProfile *lspjump_configuration_get_profile(const char *const name)
+{
+	g_autoptr(LspJumpConfigurationTable) table=lspjump_configuration_get_table();
+	LspJumpProfile *profile=(table && name)?g_hash_table_lookup(table->by_name,name):NULL;
+	
+	return profile?lspjump_profile_ref(profile):NULL;
+}
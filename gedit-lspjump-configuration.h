@@ -23,18 +23,75 @@ freely, subject to the following restrictions:
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <gio/gio.h>
+#include <jansson.h>
+#include <stdint.h>
 
 G_BEGIN_DECLS
 
+#define LSPJUMP_CONFIGURATION_RELOAD_DELAY_MS 200
+
 typedef struct LspJumpConfigurationFile
 {
+	gint ref_count;
 	GFile *file;
 	xmlDoc *doc;
 }LspJumpConfigurationFile;
 
+/**
+	A <language> element of a configuration file
+*/
+typedef struct LspJumpProfile
+{
+	gint ref_count;
+	char *name;
+	char *languages; // comma separated
+	char *bin;
+	char *bin_args;
+	char *search;
+	char *settings;
+	json_t *capabilities; // settings parsed once, NULL for the default capabilities
+	uint8_t broken_settings: 1; // settings are not JSON, no server is started for it
+
+	guint index; // position over all files, the first profile for a language wins
+	LspJumpConfigurationFile *file; // the element, for the settings window
+	xmlNode *node;
+}LspJumpProfile;
+
+/**
+	Everything the configuration files say, compiled once. A table is never changed,
+	a reload compiles a new one and swaps it in. Holders of the old one or of its
+	profiles keep them until they let go.
+*/
+typedef struct LspJumpConfigurationTable
+{
+	gint ref_count;
+	GPtrArray *profiles; // LspJumpProfile, in file order
+	GHashTable *by_language; // lower case language id or name -> first profile listing it
+	GHashTable *by_name; // profile name -> first profile with it
+	GHashTable *settings; // tag of a global setting -> its value, GINT_TO_POINTER
+}LspJumpConfigurationTable;
+
 int load_configuration();
+void lspjump_configuration_unload(void);
+void lspjump_configuration_compile(void);
+int lspjump_configuration_get_int(const char *const tag, int default_value);
 xmlNode *xml_get_child_by_tag(xmlNode *parent, const char *const tag);
 
+LspJumpConfigurationFile *lspjump_configuration_file_new(GFile *file, xmlDoc *doc);
+LspJumpConfigurationFile *lspjump_configuration_file_ref(LspJumpConfigurationFile *self);
+void lspjump_configuration_file_unref(LspJumpConfigurationFile *self);
+
+LspJumpConfigurationTable *lspjump_configuration_get_table(void);
+void lspjump_configuration_table_unref(LspJumpConfigurationTable *self);
+
+LspJumpProfile *lspjump_configuration_find_profile(const char *const language_id, const char *const language_name);
+LspJumpProfile *lspjump_configuration_get_profile(const char *const name);
+LspJumpProfile *lspjump_profile_ref(LspJumpProfile *self);
+void lspjump_profile_unref(LspJumpProfile *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(LspJumpProfile,lspjump_profile_unref)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(LspJumpConfigurationTable,lspjump_configuration_table_unref)
+
 extern GPtrArray *GLOBAL_LSPJUMP_CONFIGURATIONS;
 
 G_END_DECLS
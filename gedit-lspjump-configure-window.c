@@ -20,8 +20,11 @@ freely, subject to the following restrictions:
 #include "gedit-lspjump-configure-window.h"
 
 #include "gedit-lspjump-rpc.h"
+#include "gedit-lspjump-endpoints.h"
 #include "gedit-lspjump-common.h"
 #include "gedit-lspjump-configuration.h"
+#include "gedit-lspjump-perf-panel.h"
+#include "gedit-lspjump-roots.h"
 
 enum
 {
@@ -36,60 +39,31 @@ static void _update_language_combo_box(GeditWindow *window, GtkWidget *lang_cb,
 
 	gtk_list_store_clear(store);
 
-	const char *current_language=get_programming_language(window);
+	g_autoptr(LspJumpConfigurationTable) table=lspjump_configuration_get_table();
+	g_autoptr(LspJumpProfile) current=lspjump_configuration_find_profile(get_programming_language(window),NULL);
 	int default_item=0;
-	int cur_add_item=0;
 	
-	for(int i=0;i<GLOBAL_LSPJUMP_CONFIGURATIONS->len;i++)
+	for(guint i=0;table && i<table->profiles->len;i++)
 	{
-		LspJumpConfigurationFile *conf=g_ptr_array_index(GLOBAL_LSPJUMP_CONFIGURATIONS,i);
+		LspJumpProfile *profile=g_ptr_array_index(table->profiles,i);
 		
-		xmlNode *root = xmlDocGetRootElement(conf->doc);
-
-		for (xmlNode *node = root->children; node; node = node->next)
+		GtkTreeIter iter;
+		gtk_list_store_append(store, &iter);
+		g_autoptr(GObject) obj1 = g_object_new(G_TYPE_OBJECT, NULL);
+		g_object_set_data_full(obj1, "lsp_language", g_strdup(profile->languages), g_free);
+		g_object_set_data_full(obj1, "lsp_bin", g_strdup(profile->bin), g_free);
+		g_object_set_data_full(obj1, "lsp_bin_args", g_strdup(profile->bin_args), g_free);
+		g_object_set_data_full(obj1, "lsp_search", g_strdup(profile->search), g_free);
+		g_object_set_data_full(obj1, "lsp_settings", g_strdup(profile->settings), g_free);
+		g_object_set_data_full(obj1, "xml_node", profile->node, NULL);
+		g_object_set_data_full(obj1, "xml_file", lspjump_configuration_file_ref(profile->file), (GDestroyNotify)lspjump_configuration_file_unref);
+		
+		gtk_list_store_set(store, &iter, COLUMN_TEXT, profile->name, COLUMN_OBJECT, obj1, -1);
+		
+		if(profile==current)
 		{
-			if (node->type == XML_ELEMENT_NODE && xmlStrcmp(node->name, (const xmlChar *)"language") == 0)
-			{
-				g_autofree xmlChar *name = xmlGetProp(node, (const xmlChar *)"name");
-				
-				xmlNode *lsp_language_node=xml_get_child_by_tag(node,"lsp_language");
-				xmlChar *lsp_language=xmlNodeGetContent(lsp_language_node);
-				xmlNode *lsp_bin_node=xml_get_child_by_tag(node,"lsp_bin");
-				xmlChar *lsp_bin=xmlNodeGetContent(lsp_bin_node);
-				xmlNode *lsp_bin_args_node=xml_get_child_by_tag(node,"lsp_bin_args");
-				xmlChar *lsp_bin_args=xmlNodeGetContent(lsp_bin_args_node);
-				xmlNode *lsp_search_node=xml_get_child_by_tag(node,"lsp_search");
-				xmlChar *lsp_search=xmlNodeGetContent(lsp_search_node);
-				xmlNode *lsp_settings_node=xml_get_child_by_tag(node,"lsp_settings");
-				xmlChar *lsp_settings=xmlNodeGetContent(lsp_settings_node);
-				
-				GtkTreeIter iter;
-				gtk_list_store_append(store, &iter);
-				g_autoptr(GObject) obj1 = g_object_new(G_TYPE_OBJECT, NULL);
-				g_object_set_data_full(obj1, "lsp_language", lsp_language, g_free);
-				g_object_set_data_full(obj1, "lsp_bin", lsp_bin, g_free);
-				g_object_set_data_full(obj1, "lsp_bin_args", lsp_bin_args, g_free);
-				g_object_set_data_full(obj1, "lsp_search", lsp_search, g_free);
-				g_object_set_data_full(obj1, "lsp_settings", lsp_settings, g_free);
-				g_object_set_data_full(obj1, "xml_node", node, NULL);
-				g_object_set_data_full(obj1, "xml_file", conf, NULL);
-				
-				gtk_list_store_set(store, &iter, COLUMN_TEXT, name, COLUMN_OBJECT, obj1, -1);
-				
-				g_auto(GStrv) result = g_strsplit(lsp_language, ",", -1);
-				
-				for (int j = 0; result[j] != NULL; j++)
-				{
-					if(g_ascii_strcasecmp(current_language,result[j])==0)
-					{
-						fprintf(stdout,"%s:%d Found default: [%s %s]\n",__FILE__,__LINE__,name,lsp_language);
-						default_item=cur_add_item;
-					}
-				}
-				
-				cur_add_item++;
-//				gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(lang_cb), name);
-			}
+			fprintf(stdout,"%s:%d Found default: [%s %s]\n",__FILE__,__LINE__,profile->name,profile->languages);
+			default_item=i;
 		}
 	}
 	
@@ -110,21 +84,22 @@ static void _change_project_path(GtkWidget *widget, GtkWidget *path_entry)
 	
 	if (gtk_combo_box_get_active_iter(GTK_COMBO_BOX(curr_lang_combo), &iter))
 	{
-		GObject *obj = NULL;
-		gtk_tree_model_get(curr_lang_model, &iter, COLUMN_OBJECT, &obj, -1);
+		g_autofree char *profile_name = NULL;
+		gtk_tree_model_get(curr_lang_model, &iter, COLUMN_TEXT, &profile_name, -1);
 
-		if (obj)
+		if (profile_name)
 		{
-			const char *lsp_language=g_object_get_data(obj, "lsp_language");
-			const char *lsp_bin=g_object_get_data(obj, "lsp_bin");
-			const char *lsp_bin_args=g_object_get_data(obj, "lsp_bin_args");
-			const char *lsp_search=g_object_get_data(obj, "lsp_search");
-			const char *lsp_settings=g_object_get_data(obj, "lsp_settings");
+			// The entry holds a path, the server wants a uri
+			g_autoptr(GError) error = NULL;
+			g_autofree char *root_uri = g_filename_to_uri(new_path, NULL, &error);
 			
-			lspjump_rpc_init(new_path,lsp_bin,lsp_bin_args,lsp_settings);
+			if (root_uri == NULL)
+			{
+				g_printerr("Invalid project path: %s\n", error->message);
+				return;
+			}
 			
-			// Unref when you're done if needed
-//			g_object_unref(obj);
+			lspjump_endpoints_start(profile_name, root_uri);
 
 			return;
 		}
@@ -231,6 +206,7 @@ static void on_create_language_settings_dialog_response(GtkDialog *dialog, gint
 				gtk_widget_destroy(GTK_WIDGET(dialog));
 			}
 			
+			lspjump_configuration_compile();
 			_update_language_combo_box(window,curr_lang_combo,curr_lang_model);
     	}
     	//new
@@ -282,13 +258,12 @@ static void on_create_language_settings_dialog_response(GtkDialog *dialog, gint
 					gtk_widget_destroy(GTK_WIDGET(dialog));
 				}
 				
-				LspJumpConfigurationFile *cfile=calloc(1,sizeof(LspJumpConfigurationFile));
-				cfile->file=g_file_new_for_path(file_path);
-				cfile->doc=doc;
+				g_autoptr(GFile) file=g_file_new_for_path(file_path);
 				
-				g_ptr_array_add(GLOBAL_LSPJUMP_CONFIGURATIONS,cfile);
+				g_ptr_array_add(GLOBAL_LSPJUMP_CONFIGURATIONS,lspjump_configuration_file_new(file,doc));
 			}
 			
+			lspjump_configuration_compile();
 			_update_language_combo_box(window,curr_lang_combo,curr_lang_model);
     	}
     }
@@ -416,6 +391,9 @@ static void on_remove_language_response(GtkDialog *dialog, gint response_id, Gtk
 				xmlUnlinkNode(xml_node);
 				xmlFreeNode(xml_node);
 				
+				// The table still points at the node
+				lspjump_configuration_compile();
+				
 				g_autofree char *file_path=g_file_get_path(file->file);
 				
 				if (xmlSaveFormatFileEnc(file_path, file->doc, "UTF-8", 1) == -1)
@@ -511,50 +489,45 @@ static void _get_proj(GtkWidget *widget, GtkWidget *path_entry)
 	gtk_entry_set_text(GTK_ENTRY(path_entry), folder_path);
 }
 
-static char *find_parent_file_path(GFile *gfile, const gchar *target_filename)
+static void _search_proj_done(GFile *root, void *user_data)
 {
-	g_autoptr(GFile) current = g_file_dup(gfile); // Start from current file
-	while (current != NULL)
+	g_autoptr(GtkWidget) path_entry=user_data;
+	
+	if (root == NULL)
 	{
-		// Build a GFile pointing to the target inside this folder
-		g_autoptr(GFile) candidate = g_file_get_child(current, target_filename);
-		if (g_file_query_exists(candidate, NULL))
-		{
-			// Found the file!
-			gchar *found_path = g_file_get_path(current);
-			g_print("Found in: %s\n", found_path);
-			return found_path;
-		}
-
-		// Move one level up
-		g_autoptr(GFile) parent = g_file_get_parent(current);
-		if (parent == NULL)
-		{
-			g_print("Reached filesystem root, file not found.\n");
-			break;
-		}
-		current = g_steal_pointer(&parent); // Transfer ownership
+		g_print("Reached filesystem root, file not found.\n");
+		return;
 	}
 	
-	return NULL;
+	// The settings may have been closed while searching
+	if (gtk_widget_get_toplevel(path_entry) == path_entry)
+	{
+		return;
+	}
+	
+	g_autofree gchar *folder_path = g_file_get_path(root);
+	
+	gtk_entry_set_text(GTK_ENTRY(path_entry), folder_path);
 }
 
 static void _search_proj(GtkWidget *widget, GtkWidget *path_entry)
 {
-	const gchar *target_filename = "compile_commands.json";
-
-	puts("Get proj");
-	
 	GeditWindow *window=g_object_get_data(G_OBJECT(path_entry), "window-obj");
 
 	GFile *gfile=lspjump_get_active_file_from_window(window);
 	
-	g_autoptr(GFile) parent_path=g_file_get_parent(gfile);
+	if (gfile == NULL)
+	{
+		return;
+	}
 	
-	g_autofree gchar *folder_path = find_parent_file_path(parent_path,target_filename);
+	// The markers of the profile for the active document, the usual ones without one
+	g_autoptr(LspJumpProfile) profile=lspjump_configuration_find_profile(get_programming_language(window),NULL);
+	const char *markers=(profile && profile->search && *profile->search)?profile->search:LSPJUMP_ROOTS_DEFAULT_MARKERS;
 	
-	// Placeholder for getting project directory
-	gtk_entry_set_text(GTK_ENTRY(path_entry), folder_path);
+	g_autoptr(GFile) parent_path=g_file_get_parent(gfile);
+	
+	lspjump_roots_resolve(parent_path,markers,_search_proj_done,g_object_ref(path_entry));
 }
 
 static void _click_histoy_path(GtkComboBox *combo_box, gpointer user_data)
@@ -564,6 +537,14 @@ static void _click_histoy_path(GtkComboBox *combo_box, gpointer user_data)
 	// Placeholder for path history click functionality
 }
 
+static void _show_perf_panel(GtkWidget *widget, GeditWindow *window)
+{
+	// The settings are modal, the panel is meant to stay open while editing
+	gtk_widget_destroy(gtk_widget_get_toplevel(widget));
+	
+	lspjump_perf_panel_show(GTK_WINDOW(window));
+}
+
 static void on_dialog_response(GtkDialog *dialog, gint response_id, gpointer user_data)
 {
     if (response_id == GTK_RESPONSE_CLOSE)
@@ -653,6 +634,10 @@ GtkWidget *create_settings_window(GtkWidget *parent, GeditWindow *window)
 	g_signal_connect(button, "clicked", G_CALLBACK(_remove_language), window);
 	gtk_grid_attach(GTK_GRID(grid), button, 1, 6, 1, 1);
 
+	button = gtk_button_new_with_label("Performance");
+	g_signal_connect(button, "clicked", G_CALLBACK(_show_perf_panel), window);
+	gtk_grid_attach(GTK_GRID(grid), button, 0, 7, 2, 1);
+
 	gtk_widget_show_all(dialog);
 	return dialog;
 }
@@ -0,0 +1,514 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-docsync.h"
+#include "gedit-lspjump-rpc.h"
+#include "gedit-lspjump-common.h"
+#include "gedit-lspjump-endpoints.h"
+#include "gedit-lspjump-trace.h"
+
+#define LSPJUMP_DOCUMENT_SYNC_KEY "lspjump-document-sync"
+// Lines of the buffer copied out at a time when the whole text is sent
+#define LSPJUMP_DOCUMENT_SEGMENT_LINES 512
+
+static GQueue GLOBAL_DOCUMENTS=G_QUEUE_INIT; // LspJumpDocumentSync
+
+/**
+	GtkSourceView language ids that differ from the LSP languageId
+*/
+static const char *const LANGUAGE_ID_MAP[][2]=
+{
+	{"chdr","c"},
+	{"cpphdr","cpp"},
+	{"objc","objective-c"},
+	{"python3","python"},
+	{"js","javascript"},
+	{"sh","shellscript"},
+};
+
+static char *get_language_id(GeditDocument *doc)
+{
+	GtkSourceLanguage *language=gtk_source_buffer_get_language(GTK_SOURCE_BUFFER(doc));
+
+	if(!language)
+	{
+		return g_strdup("plaintext");
+	}
+
+	const char *id=gtk_source_language_get_id(language);
+
+	for(size_t i=0;i<G_N_ELEMENTS(LANGUAGE_ID_MAP);i++)
+	{
+		if(g_strcmp0(id,LANGUAGE_ID_MAP[i][0])==0)
+		{
+			return g_strdup(LANGUAGE_ID_MAP[i][1]);
+		}
+	}
+
+	return g_ascii_strdown(id,-1);
+}
+
+static char *get_document_uri(GeditDocument *doc)
+{
+	GtkSourceFile *source_file=gedit_document_get_file(doc);
+	GFile *location=source_file?gtk_source_file_get_location(source_file):NULL;
+
+	return location?g_file_get_uri(location):NULL;
+}
+
+/**
+	The mirror follows every edit, but lines are broken a little differently than
+	in GtkTextBuffer for some rare separators. Rebuilt when that shows.
+*/
+static LspJumpMirror *get_mirror(LspJumpDocumentSync *self)
+{
+	GtkTextBuffer *buffer=GTK_TEXT_BUFFER(self->doc);
+
+	if(lspjump_mirror_get_line_count(self->mirror)!=gtk_text_buffer_get_line_count(buffer))
+	{
+		g_autofree char *text=get_full_text_from_document(self->doc);
+		lspjump_mirror_set_text(self->mirror,text,-1);
+	}
+
+	return self->mirror;
+}
+
+static void make_position(LspJumpDocumentSync *self, const GtkTextIter *iter, LspJumpDocumentPosition *position)
+{
+	LspJumpMirror *mirror=get_mirror(self);
+
+	position->line=gtk_text_iter_get_line(iter);
+
+	for(int encoding=0;encoding<LSPJUMP_POSITION_ENCODING_COUNT;encoding++)
+	{
+		position->columns[encoding]=lspjump_mirror_to_encoding(mirror,position->line,gtk_text_iter_get_line_offset(iter),encoding);
+	}
+}
+
+static void change_clear(gpointer data)
+{
+	LspJumpDocumentChange *change=data;
+
+	g_free(change->text);
+}
+
+static json_t *make_content_changes(LspJumpDocumentSync *self, LspJumpPositionEncoding encoding)
+{
+	json_t *changes=json_array();
+
+	for(guint i=0;i<self->pending_changes->len;i++)
+	{
+		LspJumpDocumentChange *change=&g_array_index(self->pending_changes,LspJumpDocumentChange,i);
+
+		json_array_append_new(changes,json_pack("{s:{s:{s:i, s:i}, s:{s:i, s:i}}, s:s}",
+			"range",
+			"start", "line", change->start.line, "character", change->start.columns[encoding],
+			"end", "line", change->end.line, "character", change->end.columns[encoding],
+			"text", change->text
+		));
+	}
+
+	return changes;
+}
+
+static void schedule_flush(LspJumpDocumentSync *self);
+
+/**
+	Remember a change against the text the server has right now. Changes before the
+	document is opened are not needed, didOpen carries the whole text. Until the
+	server has said how it wants changes both forms are kept.
+*/
+static void add_change(LspJumpDocumentSync *self, const GtkTextIter *start, const GtkTextIter *end, const char *text, gssize len)
+{
+	size_t text_len=len<0?strlen(text):(size_t)len;
+	int first_line=gtk_text_iter_get_line(start);
+	int last_line=gtk_text_iter_get_line(end);
+	int added_lines=0;
+
+	for(const char *c=memchr(text,'\n',text_len);c;c=memchr(c+1,'\n',text+text_len-(c+1)))
+	{
+		added_lines++;
+	}
+
+	// Before the first flush there is no uri, and nothing cached for the document
+	lspjump_cache_document_changed(self->uri,self->version+1,first_line,last_line,added_lines-(last_line-first_line));
+
+	JsonRpcEndpoint *endpoint=lspjump_rpc_endpoint_from_generation(self->opened_generation);
+
+	if(endpoint==NULL)
+	{
+		return;
+	}
+
+	LspJumpSyncKind sync_kind=lspjump_rpc_get_sync_kind(endpoint,NULL);
+
+	if(sync_kind==LSPJUMP_SYNC_INCREMENTAL || !endpoint->initialized)
+	{
+		LspJumpDocumentChange change={.text=g_strndup(text,text_len)};
+
+		make_position(self,start,&change.start);
+		make_position(self,end,&change.end);
+
+		g_array_append_val(self->pending_changes,change);
+	}
+
+	self->needs_full_sync=1;
+
+	schedule_flush(self);
+}
+
+static void on_insert_text(GtkTextBuffer *buffer, GtkTextIter *location, gchar *text, gint len, gpointer user_data)
+{
+	LspJumpDocumentSync *self=user_data;
+	LspJumpMirror *mirror=get_mirror(self);
+
+	add_change(self,location,location,text,len);
+
+	lspjump_mirror_insert(mirror,gtk_text_iter_get_line(location),gtk_text_iter_get_line_offset(location),text,len);
+}
+
+static void on_delete_range(GtkTextBuffer *buffer, GtkTextIter *start, GtkTextIter *end, gpointer user_data)
+{
+	LspJumpDocumentSync *self=user_data;
+	LspJumpMirror *mirror=get_mirror(self);
+
+	add_change(self,start,end,"",0);
+
+	lspjump_mirror_delete(mirror,gtk_text_iter_get_line(start),gtk_text_iter_get_line_offset(start),
+	                      gtk_text_iter_get_line(end),gtk_text_iter_get_line_offset(end));
+}
+
+static gboolean flush_timeout(gpointer data)
+{
+	LspJumpDocumentSync *self=data;
+
+	self->flush_source=0;
+	lspjump_document_sync_flush(self->doc);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void schedule_flush(LspJumpDocumentSync *self)
+{
+	if(self->flush_source==0)
+	{
+		self->flush_source=g_timeout_add(LSPJUMP_DOCUMENT_SYNC_DELAY_MS,flush_timeout,self);
+	}
+}
+
+static void on_loaded(GeditDocument *doc, gpointer user_data)
+{
+	lspjump_document_sync_warm_up(doc);
+}
+
+static void lspjump_document_sync_free(gpointer data)
+{
+	LspJumpDocumentSync *self=data;
+
+	if(self->flush_source)
+	{
+		g_source_remove(self->flush_source);
+	}
+
+	lspjump_rpc_did_close(lspjump_rpc_endpoint_from_generation(self->opened_generation),self->uri);
+
+	g_queue_unlink(&GLOBAL_DOCUMENTS,&self->link);
+	g_array_unref(self->pending_changes);
+	lspjump_mirror_free(self->mirror);
+	g_free(self->uri);
+	g_free(self->language_id);
+	free(self);
+}
+
+/**
+	Get the sync state of a document, the signal handlers are connected the first
+	time it is asked for.
+*/
+LspJumpDocumentSync *lspjump_document_sync_get(GeditDocument *doc)
+{
+	LspJumpDocumentSync *self=g_object_get_data(G_OBJECT(doc),LSPJUMP_DOCUMENT_SYNC_KEY);
+
+	if(self==NULL)
+	{
+		self=calloc(1,sizeof(LspJumpDocumentSync));
+		self->doc=doc;
+		self->pending_changes=g_array_new(FALSE,FALSE,sizeof(LspJumpDocumentChange));
+		g_array_set_clear_func(self->pending_changes,change_clear);
+
+		g_autofree char *text=get_full_text_from_document(doc);
+		self->mirror=lspjump_mirror_new(text,-1);
+		self->link.data=self;
+		g_queue_push_tail_link(&GLOBAL_DOCUMENTS,&self->link);
+
+		// Connected before the default handler, the iters still describe the old text
+		self->insert_handler=g_signal_connect(doc,"insert-text",G_CALLBACK(on_insert_text),self);
+		self->delete_handler=g_signal_connect(doc,"delete-range",G_CALLBACK(on_delete_range),self);
+		// Only once it is loaded are the location and the language known
+		self->loaded_handler=g_signal_connect(doc,"loaded",G_CALLBACK(on_loaded),NULL);
+
+		g_object_set_data_full(G_OBJECT(doc),LSPJUMP_DOCUMENT_SYNC_KEY,self,lspjump_document_sync_free);
+	}
+
+	return self;
+}
+
+/**
+	The server for the language of the document and the project it is in
+
+	@param spawn
+		start the server if it is not running
+	@return
+		the endpoint, not referenced, or NULL
+*/
+JsonRpcEndpoint *lspjump_document_get_endpoint(GeditDocument *doc, gboolean spawn)
+{
+	GtkSourceLanguage *language=gtk_source_buffer_get_language(GTK_SOURCE_BUFFER(doc));
+	GtkSourceFile *source_file=gedit_document_get_file(doc);
+	GFile *location=source_file?gtk_source_file_get_location(source_file):NULL;
+
+	if(language==NULL || location==NULL)
+	{
+		return NULL;
+	}
+
+	return lspjump_endpoints_get(gtk_source_language_get_id(language),gtk_source_language_get_name(language),location,spawn);
+}
+
+/**
+	Escape the text of the document into out a few hundred lines at a time, so
+	the whole text is never copied out of the buffer at once
+*/
+static void write_document_text(GString *out, void *user_data)
+{
+	GtkTextBuffer *buffer=user_data;
+	GtkTextIter start, end;
+
+	gtk_text_buffer_get_start_iter(buffer,&start);
+
+	while(!gtk_text_iter_is_end(&start))
+	{
+		end=start;
+		gtk_text_iter_forward_lines(&end,LSPJUMP_DOCUMENT_SEGMENT_LINES);
+
+		g_autofree char *segment=gtk_text_buffer_get_text(buffer,&start,&end,FALSE);
+		lspjump_json_write_escaped(out,segment,strlen(segment));
+
+		start=end;
+	}
+}
+
+static size_t get_text_size_hint(GeditDocument *doc)
+{
+	// Characters, most source code is ASCII
+	return gtk_text_buffer_get_char_count(GTK_TEXT_BUFFER(doc));
+}
+
+static void send_did_open(LspJumpDocumentSync *self, JsonRpcEndpoint *endpoint)
+{
+	g_free(self->language_id);
+	self->language_id=get_language_id(self->doc);
+
+	self->version++;
+
+	if(lspjump_rpc_did_open(endpoint,self->uri,self->language_id,self->version,write_document_text,self->doc,get_text_size_hint(self->doc))==0)
+	{
+		self->opened_generation=endpoint->generation;
+		LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SYNC,LSPJUMP_TRACE_INFO,"didOpen %s version %d on server %u",self->uri,self->version,endpoint->generation);
+	}
+}
+
+/**
+	Send whatever the server is missing of the document: didOpen the first time,
+	the collected changes after that. Call it before any request about the document,
+	the server is started if it is not running.
+
+	@return
+		the endpoint to send requests about the document to, not referenced,
+		NULL if there is no server for it
+*/
+JsonRpcEndpoint *lspjump_document_sync_flush(GeditDocument *doc)
+{
+	LspJumpDocumentSync *self=lspjump_document_sync_get(doc);
+
+	if(self->flush_source)
+	{
+		g_source_remove(self->flush_source);
+		self->flush_source=0;
+	}
+
+	JsonRpcEndpoint *endpoint=lspjump_document_get_endpoint(doc,TRUE);
+	JsonRpcEndpoint *opened_on=lspjump_rpc_endpoint_from_generation(self->opened_generation);
+
+	// Save as gives the document a new uri and maybe a new server, the old one has to forget it
+	g_autofree char *uri=get_document_uri(doc);
+	gboolean same_uri=g_strcmp0(uri,self->uri)==0;
+
+	// Crashed and waiting to be restarted, the restart opens the document again by its generation
+	if(same_uri && endpoint==NULL && opened_on && opened_on->closed)
+	{
+		return NULL;
+	}
+
+	if(!same_uri || opened_on!=endpoint)
+	{
+		if(opened_on)
+		{
+			LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SYNC,LSPJUMP_TRACE_INFO,"didClose %s on server %u",self->uri,opened_on->generation);
+		}
+
+		lspjump_rpc_did_close(opened_on,self->uri);
+
+		self->opened_generation=0;
+		g_free(self->uri);
+		self->uri=g_steal_pointer(&uri);
+	}
+
+	if(endpoint==NULL || self->uri==NULL)
+	{
+		return NULL;
+	}
+
+	gboolean open_close;
+	LspJumpSyncKind sync_kind=lspjump_rpc_get_sync_kind(endpoint,&open_close);
+
+	if(self->opened_generation!=endpoint->generation)
+	{
+		g_array_set_size(self->pending_changes,0);
+		self->needs_full_sync=0;
+
+		if(open_close)
+		{
+			send_did_open(self,endpoint);
+		}
+
+		return endpoint;
+	}
+
+	// Changes wait until the server has said how it wants them
+	if(!endpoint->initialized)
+	{
+		return endpoint;
+	}
+
+	if(sync_kind==LSPJUMP_SYNC_INCREMENTAL && self->pending_changes->len>0)
+	{
+		g_autoptr(json_t) changes=make_content_changes(self,lspjump_rpc_get_position_encoding(endpoint));
+
+		self->version++;
+		lspjump_rpc_did_change(endpoint,self->uri,self->version,changes);
+		LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SYNC,LSPJUMP_TRACE_INFO,"didChange %s version %d, %u changes",self->uri,self->version,self->pending_changes->len);
+	}
+	else if(sync_kind==LSPJUMP_SYNC_FULL && self->needs_full_sync)
+	{
+		self->version++;
+		lspjump_rpc_did_change_full(endpoint,self->uri,self->version,write_document_text,doc,get_text_size_hint(doc));
+		LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SYNC,LSPJUMP_TRACE_INFO,"didChange %s version %d, whole text",self->uri,self->version);
+	}
+
+	g_array_set_size(self->pending_changes,0);
+	self->needs_full_sync=0;
+
+	return endpoint;
+}
+
+/**
+	Open the documents that were open on a server that went away on the server
+	that replaced it, so the next request does not have to wait for didOpen
+
+	@param generation
+		of the server that went away
+*/
+void lspjump_document_sync_reopen(guint generation)
+{
+	for(GList *item=GLOBAL_DOCUMENTS.head;item;item=item->next)
+	{
+		LspJumpDocumentSync *self=item->data;
+
+		if(self->opened_generation==generation)
+		{
+			LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SYNC,LSPJUMP_TRACE_INFO,"reopening %s, server %u went away",self->uri,generation);
+			lspjump_document_sync_flush(self->doc);
+		}
+	}
+}
+
+/**
+	Start the server of the document and open the document on it as soon as the
+	main loop is idle, so the first jump waits for neither. Does nothing if no
+	profile handles the document.
+*/
+void lspjump_document_sync_warm_up(GeditDocument *doc)
+{
+	LspJumpDocumentSync *self=lspjump_document_sync_get(doc);
+
+	// A flush that is already scheduled does the same, only later
+	if(self->flush_source)
+	{
+		g_source_remove(self->flush_source);
+	}
+
+	self->flush_source=g_idle_add(flush_timeout,self);
+}
+
+/**
+	Warm up every document with file as its location
+*/
+void lspjump_document_sync_warm_up_file(GFile *file)
+{
+	for(GList *item=GLOBAL_DOCUMENTS.head;item;item=item->next)
+	{
+		LspJumpDocumentSync *self=item->data;
+		GtkSourceFile *source_file=gedit_document_get_file(self->doc);
+		GFile *location=source_file?gtk_source_file_get_location(source_file):NULL;
+
+		if(location && g_file_equal(location,file))
+		{
+			lspjump_document_sync_warm_up(self->doc);
+		}
+	}
+}
+
+/**
+	A column of the document in the encoding of the server
+
+	@param offset
+		in characters, like gtk_text_iter_get_line_offset
+*/
+int lspjump_document_sync_to_lsp_column(GeditDocument *doc, JsonRpcEndpoint *endpoint, int line, int offset)
+{
+	LspJumpDocumentSync *self=lspjump_document_sync_get(doc);
+
+	return lspjump_mirror_to_encoding(get_mirror(self),line,offset,lspjump_rpc_get_position_encoding(endpoint));
+}
+
+/**
+	A column a server sent, in characters for gtk_text_buffer_get_iter_at_line_offset
+*/
+int lspjump_document_sync_from_lsp_column(GeditDocument *doc, int line, int column, LspJumpPositionEncoding encoding)
+{
+	LspJumpDocumentSync *self=lspjump_document_sync_get(doc);
+
+	return lspjump_mirror_from_encoding(get_mirror(self),line,column,encoding);
+}
@@ -0,0 +1,88 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <jansson.h>
+#include <stdint.h>
+#include <gedit/gedit-document.h>
+
+#include "gedit-lspjump-rpc.h"
+#include "gedit-lspjump-mirror.h"
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_DOCUMENT_SYNC_DELAY_MS 250
+
+/**
+	Where a change was made, in every encoding: the server may not have said yet
+	which one it uses when the change is made
+*/
+typedef struct LspJumpDocumentPosition
+{
+	int line;
+	int columns[LSPJUMP_POSITION_ENCODING_COUNT];
+}LspJumpDocumentPosition;
+
+typedef struct LspJumpDocumentChange
+{
+	LspJumpDocumentPosition start;
+	LspJumpDocumentPosition end;
+	char *text;
+}LspJumpDocumentChange;
+
+/**
+	Keeps the server copy of a GeditDocument up to date.
+
+	Edits are collected from the insert-text and delete-range signals and sent as
+	ranged didChange notifications. The same signals keep the mirror up to date.
+	didOpen is only sent once per server, each document goes to the server of its
+	language and project root.
+*/
+typedef struct LspJumpDocumentSync
+{
+	GeditDocument *doc; // not owned, the sync state lives as data on the document
+	char *uri;
+	char *language_id;
+	int version;
+	guint opened_generation; // server generation the document was opened on, 0 if not open
+
+	GArray *pending_changes; // LspJumpDocumentChange, contentChanges not sent yet
+	LspJumpMirror *mirror; // lines of the text, for columns in the encoding of the server
+	uint8_t needs_full_sync: 1;
+
+	gulong insert_handler;
+	gulong delete_handler;
+	gulong loaded_handler;
+	guint flush_source;
+
+	GList link; // position among all synced documents
+}LspJumpDocumentSync;
+
+LspJumpDocumentSync *lspjump_document_sync_get(GeditDocument *doc);
+JsonRpcEndpoint *lspjump_document_sync_flush(GeditDocument *doc);
+JsonRpcEndpoint *lspjump_document_get_endpoint(GeditDocument *doc, gboolean spawn);
+void lspjump_document_sync_reopen(guint generation);
+void lspjump_document_sync_warm_up(GeditDocument *doc);
+void lspjump_document_sync_warm_up_file(GFile *file);
+int lspjump_document_sync_to_lsp_column(GeditDocument *doc, JsonRpcEndpoint *endpoint, int line, int offset);
+int lspjump_document_sync_from_lsp_column(GeditDocument *doc, int line, int column, LspJumpPositionEncoding encoding);
+
+G_END_DECLS
@@ -0,0 +1,402 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-endpoints.h"
+#include "gedit-lspjump-configuration.h"
+#include "gedit-lspjump-docsync.h"
+#include "gedit-lspjump-roots.h"
+#include "gedit-lspjump-trace.h"
+
+/**
+	A server of a profile for a project root, restarted when it crashes
+*/
+typedef struct LspJumpServer
+{
+	JsonRpcEndpoint *endpoint;
+	char *profile_name;
+	char *root_uri;
+	
+	guint crashes; // in a row, without LSPJUMP_SERVER_STABLE_S of uptime in between
+	gint64 started;
+	guint restart_source;
+}LspJumpServer;
+
+static GHashTable *GLOBAL_SERVERS=NULL; // "profile\nroot uri" -> LspJumpServer
+static GHashTable *GLOBAL_ROOT_OVERRIDES=NULL; // profile name -> root uri chosen in the settings
+static guint GLOBAL_SERVERS_SWEEP_SOURCE=0;
+
+static void stop_endpoint(JsonRpcEndpoint *endpoint)
+{
+	if(endpoint)
+	{
+		lspjump_rpc_endpoint_shutdown(endpoint);
+		lspjump_rpc_endpoint_unref(endpoint);
+	}
+}
+
+static void server_release(gpointer data)
+{
+	LspJumpServer *server=data;
+	
+	g_clear_handle_id(&server->restart_source,g_source_remove);
+	stop_endpoint(server->endpoint);
+	
+	g_free(server->profile_name);
+	g_free(server->root_uri);
+	free(server);
+}
+
+static GHashTable *get_servers(void)
+{
+	if(GLOBAL_SERVERS==NULL)
+	{
+		GLOBAL_SERVERS=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,server_release);
+	}
+	
+	return GLOBAL_SERVERS;
+}
+
+static char *make_key(const char *const profile_name, const char *const root_uri)
+{
+	return g_strdup_printf("%s\n%s",profile_name,root_uri);
+}
+
+/**
+	Servers nobody has asked anything for server_idle_timeout seconds are shut down,
+	they are started again on the next request.
+*/
+static gboolean sweep_idle_servers(gpointer data)
+{
+	int timeout_s=lspjump_configuration_get_int("server_idle_timeout",LSPJUMP_SERVER_DEFAULT_IDLE_TIMEOUT_S);
+	GHashTableIter iter;
+	gpointer key, value;
+	
+	g_hash_table_iter_init(&iter,get_servers());
+	
+	while(g_hash_table_iter_next(&iter,&key,&value))
+	{
+		LspJumpServer *server=value;
+		JsonRpcEndpoint *endpoint=server->endpoint;
+		
+		// Waiting to be restarted
+		if(server->restart_source)
+		{
+			continue;
+		}
+		
+		// The restart found no profile or could not spawn it, or it closed by itself
+		if(endpoint==NULL || endpoint->closed)
+		{
+			g_print("Forgetting language server %s for %s\n",server->profile_name,server->root_uri);
+			g_hash_table_iter_remove(&iter);
+		}
+		else if(timeout_s>0 && lspjump_rpc_endpoint_is_idle(endpoint,(gint64)timeout_s*G_USEC_PER_SEC))
+		{
+			g_print("Stopping idle language server for %s\n",endpoint->root_uri);
+			LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SERVER,LSPJUMP_TRACE_INFO,"server %u idle for %d s, stopping it",endpoint->generation,timeout_s);
+			g_hash_table_iter_remove(&iter);
+		}
+	}
+	
+	if(g_hash_table_size(get_servers())==0)
+	{
+		GLOBAL_SERVERS_SWEEP_SOURCE=0;
+		return G_SOURCE_REMOVE;
+	}
+	
+	return G_SOURCE_CONTINUE;
+}
+
+static void server_exited(JsonRpcEndpoint *endpoint, int status, void *user_data);
+
+static JsonRpcEndpoint *spawn_endpoint(LspJumpServer *server, LspJumpProfile *profile)
+{
+	// Reported when the configuration was read
+	if(profile->broken_settings)
+	{
+		return NULL;
+	}
+	
+	g_print("Starting %s for %s\n",profile->name,server->root_uri);
+	
+	JsonRpcEndpoint *endpoint=lspjump_rpc_endpoint_new(server->root_uri,profile->bin,profile->bin_args,profile->capabilities);
+	
+	if(endpoint)
+	{
+		endpoint->outgoing.high_water=(size_t)lspjump_configuration_get_int("write_high_water_kb",LSPJUMP_OUT_QUEUE_HIGH_WATER/1024)*1024;
+		endpoint->exit_action=server_exited;
+		endpoint->exit_data=server;
+		server->started=g_get_monotonic_time();
+		LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SERVER,LSPJUMP_TRACE_INFO,"spawned %s as server %u for %s",profile->bin,endpoint->generation,server->root_uri);
+	}
+	else
+	{
+		LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SERVER,LSPJUMP_TRACE_ERROR,"could not spawn %s for %s",profile->bin,server->root_uri);
+	}
+	
+	return endpoint;
+}
+
+static JsonRpcEndpoint *start_server(LspJumpProfile *profile, const char *const root_uri, const char *const key)
+{
+	LspJumpServer *server=calloc(1,sizeof(LspJumpServer));
+	server->profile_name=g_strdup(profile->name);
+	server->root_uri=g_strdup(root_uri);
+	server->endpoint=spawn_endpoint(server,profile);
+	
+	if(server->endpoint==NULL)
+	{
+		server_release(server);
+		return NULL;
+	}
+	
+	g_hash_table_replace(get_servers(),g_strdup(key),server);
+	
+	if(GLOBAL_SERVERS_SWEEP_SOURCE==0)
+	{
+		GLOBAL_SERVERS_SWEEP_SOURCE=g_timeout_add_seconds(LSPJUMP_SERVER_SWEEP_INTERVAL_S,sweep_idle_servers,NULL);
+	}
+	
+	return server->endpoint;
+}
+
+/**
+	Start a server that crashed again, with the settings it has now, and open the
+	documents it had open
+*/
+static gboolean restart_server(gpointer data)
+{
+	LspJumpServer *server=data;
+	JsonRpcEndpoint *crashed=server->endpoint;
+	guint generation=crashed->generation;
+	g_autoptr(LspJumpProfile) profile=lspjump_configuration_get_profile(server->profile_name);
+	
+	server->restart_source=0;
+	server->endpoint=NULL;
+	stop_endpoint(crashed);
+	
+	if(profile)
+	{
+		server->endpoint=spawn_endpoint(server,profile);
+	}
+	
+	// Without an endpoint the sweep forgets the server, the next request starts it afresh
+	if(server->endpoint)
+	{
+		LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SERVER,LSPJUMP_TRACE_INFO,"server %u restarted as %u",generation,server->endpoint->generation);
+		lspjump_document_sync_reopen(generation);
+	}
+	
+	return G_SOURCE_REMOVE;
+}
+
+static void server_exited(JsonRpcEndpoint *endpoint, int status, void *user_data)
+{
+	LspJumpServer *server=user_data;
+	
+	if(g_get_monotonic_time()-server->started>(gint64)LSPJUMP_SERVER_STABLE_S*G_USEC_PER_SEC)
+	{
+		server->crashes=0;
+	}
+	
+	// 100 ms, 400 ms, 1.6 s, ... up to LSPJUMP_SERVER_RESTART_MAX_DELAY_MS
+	guint delay=LSPJUMP_SERVER_RESTART_DELAY_MS;
+	
+	for(guint i=0;i<server->crashes && delay<LSPJUMP_SERVER_RESTART_MAX_DELAY_MS;i++)
+	{
+		delay*=4;
+	}
+	
+	delay=MIN(delay,LSPJUMP_SERVER_RESTART_MAX_DELAY_MS);
+	server->crashes++;
+	
+	g_printerr("Language server %s for %s went away, restarting it in %u ms\n",server->profile_name,server->root_uri,delay);
+	LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_SERVER,LSPJUMP_TRACE_WARN,"server %u exited with status %d, crash %u, restart in %u ms",endpoint->generation,status,server->crashes,delay);
+	
+	server->restart_source=g_timeout_add(delay,restart_server,server);
+}
+
+static void root_resolved(GFile *root, void *user_data)
+{
+	g_autoptr(GFile) file=user_data;
+	
+	// The documents that found no server while the root was unknown
+	lspjump_document_sync_warm_up_file(file);
+}
+
+/**
+	The root chosen in the settings wins, then the closest parent with one of the
+	lsp_search markers of the profile, then the directory of the file.
+
+	The markers are only looked for asynchronously. Until the first search is done
+	there is no root, documents in the file are warmed up again once it is. When a
+	marker comes or goes the old root is used until it has been searched for again.
+*/
+static char *resolve_root_uri(LspJumpProfile *profile, GFile *file)
+{
+	const char *root_override=GLOBAL_ROOT_OVERRIDES?g_hash_table_lookup(GLOBAL_ROOT_OVERRIDES,profile->name):NULL;
+	
+	if(root_override)
+	{
+		return g_strdup(root_override);
+	}
+	
+	g_autoptr(GFile) dir=g_file_get_parent(file);
+	
+	if(dir==NULL)
+	{
+		return NULL;
+	}
+	
+	if(profile->search && *profile->search)
+	{
+		g_autoptr(GFile) root=NULL;
+		
+		if(!lspjump_roots_lookup(dir,profile->search,&root))
+		{
+			lspjump_roots_resolve(dir,profile->search,root_resolved,g_object_ref(file));
+			return NULL;
+		}
+		
+		if(root)
+		{
+			return g_file_get_uri(root);
+		}
+	}
+	
+	return g_file_get_uri(dir);
+}
+
+/**
+	Get the server for a file, by the profile that handles its language and the
+	project root the file is in.
+
+	@param language_id
+	@param language_name
+		GtkSourceView id and name of the language of the file
+	@param spawn
+		start the server if it is not running
+	@return
+		the endpoint, owned by the registry, or NULL if there is none
+*/
+JsonRpcEndpoint *lspjump_endpoints_get(const char *const language_id, const char *const language_name, GFile *file, gboolean spawn)
+{
+	g_autoptr(LspJumpProfile) profile=lspjump_configuration_find_profile(language_id,language_name);
+	
+	if(profile==NULL || file==NULL)
+	{
+		return NULL;
+	}
+	
+	g_autofree char *root_uri=resolve_root_uri(profile,file);
+	
+	if(root_uri==NULL)
+	{
+		return NULL;
+	}
+	
+	g_autofree char *key=make_key(profile->name,root_uri);
+	LspJumpServer *server=g_hash_table_lookup(get_servers(),key);
+	JsonRpcEndpoint *endpoint=server?server->endpoint:NULL;
+	
+	// Crashed, there is no server until it has been restarted
+	if(server && server->restart_source)
+	{
+		return NULL;
+	}
+	
+	// A server that went away otherwise is replaced on the next use
+	if(server && (endpoint==NULL || endpoint->closed))
+	{
+		g_hash_table_remove(get_servers(),key);
+		endpoint=NULL;
+	}
+	
+	if(endpoint==NULL && spawn)
+	{
+		endpoint=start_server(profile,root_uri,key);
+	}
+	
+	return endpoint;
+}
+
+/**
+	Use root_uri for every file of the profile from now on, and (re)start its server.
+
+	@return
+		the endpoint, owned by the registry, or NULL if it could not be started
+*/
+JsonRpcEndpoint *lspjump_endpoints_start(const char *const profile_name, const char *const root_uri)
+{
+	g_autoptr(LspJumpProfile) profile=lspjump_configuration_get_profile(profile_name);
+	
+	if(profile==NULL)
+	{
+		return NULL;
+	}
+	
+	if(GLOBAL_ROOT_OVERRIDES==NULL)
+	{
+		GLOBAL_ROOT_OVERRIDES=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,g_free);
+	}
+	
+	g_hash_table_replace(GLOBAL_ROOT_OVERRIDES,g_strdup(profile->name),g_strdup(root_uri));
+	
+	// Asked for explicitly, a running server is restarted to pick up edited settings
+	g_autofree char *key=make_key(profile->name,root_uri);
+	g_hash_table_remove(get_servers(),key);
+	
+	return start_server(profile,root_uri,key);
+}
+
+void lspjump_endpoints_shutdown_all(void)
+{
+	g_clear_handle_id(&GLOBAL_SERVERS_SWEEP_SOURCE,g_source_remove);
+	
+	if(GLOBAL_SERVERS)
+	{
+		g_hash_table_remove_all(GLOBAL_SERVERS);
+	}
+}
+
+/**
+	Call func for every running server, it must not start or stop servers
+*/
+void lspjump_endpoints_foreach(LspJumpEndpointFunction func, void *user_data)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	
+	g_hash_table_iter_init(&iter,get_servers());
+	
+	while(g_hash_table_iter_next(&iter,&key,&value))
+	{
+		LspJumpServer *server=value;
+		
+		if(server->endpoint)
+		{
+			func(server->profile_name,server->endpoint,user_data);
+		}
+	}
+}
@@ -0,0 +1,44 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "gedit-lspjump-rpc.h"
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_SERVER_DEFAULT_IDLE_TIMEOUT_S 600
+#define LSPJUMP_SERVER_SWEEP_INTERVAL_S 30
+// A crashed server is restarted after this, four times longer for every crash in a row
+#define LSPJUMP_SERVER_RESTART_DELAY_MS 100
+#define LSPJUMP_SERVER_RESTART_MAX_DELAY_MS 30000
+// Running this long resets the crash count
+#define LSPJUMP_SERVER_STABLE_S 60
+
+typedef void (*LspJumpEndpointFunction)(const char *const profile_name, JsonRpcEndpoint *endpoint, void *user_data);
+
+JsonRpcEndpoint *lspjump_endpoints_get(const char *const language_id, const char *const language_name, GFile *file, gboolean spawn);
+JsonRpcEndpoint *lspjump_endpoints_start(const char *const profile_name, const char *const root_uri);
+void lspjump_endpoints_shutdown_all(void);
+void lspjump_endpoints_foreach(LspJumpEndpointFunction func, void *user_data);
+
+G_END_DECLS
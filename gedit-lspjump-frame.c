@@ -0,0 +1,260 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-frame.h"
+
+#define LSPJUMP_FRAME_INITIAL_CAPACITY 8192
+// A header block larger than this can not be LSP, drop it instead of buffering forever
+#define LSPJUMP_FRAME_MAX_HEADER 65536
+// No server sends a message this large, a bigger Content-Length is a broken header
+#define LSPJUMP_FRAME_MAX_BODY ((size_t)256*1024*1024)
+
+LspJumpFrameParser *lspjump_frame_parser_new(void)
+{
+	LspJumpFrameParser *self=calloc(1,sizeof(LspJumpFrameParser));
+
+	self->capacity=LSPJUMP_FRAME_INITIAL_CAPACITY;
+	self->data=malloc(self->capacity);
+	self->state=LSPJUMP_FRAME_HEADER;
+
+	return self;
+}
+
+void lspjump_frame_parser_free(LspJumpFrameParser *self)
+{
+	if(self)
+	{
+		free(self->data);
+		free(self);
+	}
+}
+
+/**
+	Make room for at least min_len more bytes at the end of the buffer.
+
+	Consumed bytes are only moved away when they are at least as many as the
+	bytes that have to be moved, so every byte is moved a bounded number of times.
+
+	@return
+		pointer where new data may be written, *avail is the writable size. NULL if
+		the memory ran out, the buffered data is then left as it was.
+*/
+char *lspjump_frame_parser_reserve(LspJumpFrameParser *self, size_t min_len, size_t *avail)
+{
+	if(self->capacity-self->end<min_len)
+	{
+		size_t pending=self->end-self->start;
+
+		if(self->start>0 && self->start>=pending)
+		{
+			memmove(self->data,self->data+self->start,pending);
+			self->scan-=self->start;
+			self->end=pending;
+			self->start=0;
+		}
+	}
+
+	size_t needed=self->end+min_len;
+
+	// The whole body is known up front, allocate for it once
+	if(self->state==LSPJUMP_FRAME_BODY && self->start+self->content_length>needed)
+	{
+		needed=self->start+self->content_length;
+	}
+
+	if(needed>self->capacity)
+	{
+		size_t new_capacity=self->capacity*2;
+
+		if(new_capacity<needed)
+		{
+			new_capacity=needed;
+		}
+
+		char *data=realloc(self->data,new_capacity);
+
+		if(data==NULL)
+		{
+			*avail=0;
+			return NULL;
+		}
+
+		self->data=data;
+		self->capacity=new_capacity;
+	}
+
+	*avail=self->capacity-self->end;
+
+	return self->data+self->end;
+}
+
+void lspjump_frame_parser_commit(LspJumpFrameParser *self, size_t len)
+{
+	self->end+=len;
+}
+
+static gboolean header_name_is(const char *line, size_t name_len, const char *const name)
+{
+	return strlen(name)==name_len && g_ascii_strncasecmp(line,name,name_len)==0;
+}
+
+/**
+	Parse the header lines between start and header_end. Headers may come in any
+	order, Content-Type is accepted and ignored since LSP only speaks utf-8.
+
+	@return
+		0 on success, -1 when there is no usable Content-Length, also when it is
+		larger than LSPJUMP_FRAME_MAX_BODY
+*/
+static int parse_headers(LspJumpFrameParser *self, const char *header, const char *header_end)
+{
+	gboolean has_length=FALSE;
+
+	while(header<header_end)
+	{
+		const char *line_end=memchr(header,'\n',header_end-header);
+
+		if(!line_end)
+		{
+			line_end=header_end;
+		}
+
+		const char *colon=memchr(header,':',line_end-header);
+
+		if(colon && header_name_is(header,colon-header,"Content-Length"))
+		{
+			const char *value=colon+1;
+
+			while(value<line_end && (*value==' ' || *value=='\t'))
+			{
+				value++;
+			}
+
+			size_t length=0;
+			gboolean has_digit=FALSE;
+			gboolean too_large=FALSE;
+
+			while(value<line_end && g_ascii_isdigit(*value))
+			{
+				// Checked every digit, so the sum can not overflow
+				length=length*10+(*value-'0');
+				has_digit=TRUE;
+				value++;
+
+				if(length>LSPJUMP_FRAME_MAX_BODY)
+				{
+					too_large=TRUE;
+					break;
+				}
+			}
+
+			if(too_large)
+			{
+				g_printerr("Content-Length larger than %zu bytes\n",LSPJUMP_FRAME_MAX_BODY);
+				return -1;
+			}
+
+			if(has_digit)
+			{
+				self->content_length=length;
+				has_length=TRUE;
+			}
+		}
+
+		header=line_end+1;
+	}
+
+	return has_length?0:-1;
+}
+
+/**
+	Get the next complete message body.
+
+	The returned body points into the parser buffer and stays valid until the
+	next call to lspjump_frame_parser_reserve or lspjump_frame_parser_next.
+
+	@return
+		1 if a body was returned, 0 if more data is needed
+*/
+int lspjump_frame_parser_next(LspJumpFrameParser *self, const char **body, size_t *body_len)
+{
+	while(1)
+	{
+		if(self->state==LSPJUMP_FRAME_HEADER)
+		{
+			if(self->scan<self->start)
+			{
+				self->scan=self->start;
+			}
+
+			const char *found=memmem(self->data+self->scan,self->end-self->scan,"\r\n\r\n",4);
+
+			if(!found)
+			{
+				// Resume where a terminator split over two reads could still begin
+				if(self->end-self->start>=3)
+				{
+					self->scan=self->end-3;
+				}
+
+				if(self->end-self->start>LSPJUMP_FRAME_MAX_HEADER)
+				{
+					g_printerr("Dropping %zu bytes of garbage from the server\n",self->end-self->start);
+					self->start=self->end;
+					self->scan=self->end;
+				}
+
+				return 0;
+			}
+
+			const char *header=self->data+self->start;
+			size_t header_len=found-header+4;
+
+			if(parse_headers(self,header,found)!=0)
+			{
+				g_printerr("Message header without Content-Length, skipping it\n");
+				self->start+=header_len;
+				continue;
+			}
+
+			self->start+=header_len;
+			self->state=LSPJUMP_FRAME_BODY;
+		}
+
+		if(self->end-self->start<self->content_length)
+		{
+			return 0;
+		}
+
+		*body=self->data+self->start;
+		*body_len=self->content_length;
+
+		self->start+=self->content_length;
+		self->scan=self->start;
+		self->state=LSPJUMP_FRAME_HEADER;
+		self->content_length=0;
+
+		return 1;
+	}
+}
@@ -0,0 +1,60 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <stddef.h>
+
+G_BEGIN_DECLS
+
+typedef enum LspJumpFrameState
+{
+	LSPJUMP_FRAME_HEADER,
+	LSPJUMP_FRAME_BODY
+}LspJumpFrameState;
+
+/**
+	Resumable parser for the "Content-Length: N\r\n\r\n<body>" framing used by LSP.
+
+	Bytes are read straight into the parser buffer (reserve + commit), and complete
+	bodies are handed out as pointers into that buffer, so nothing is copied between
+	the pipe and the json parser.
+*/
+typedef struct LspJumpFrameParser
+{
+	char *data;
+	size_t capacity;
+	size_t start; // first byte not yet consumed
+	size_t end; // one past the last valid byte
+	size_t scan; // where the search for the header terminator resumes
+
+	LspJumpFrameState state;
+	size_t content_length;
+}LspJumpFrameParser;
+
+LspJumpFrameParser *lspjump_frame_parser_new(void);
+void lspjump_frame_parser_free(LspJumpFrameParser *self);
+
+char *lspjump_frame_parser_reserve(LspJumpFrameParser *self, size_t min_len, size_t *avail);
+void lspjump_frame_parser_commit(LspJumpFrameParser *self, size_t len);
+
+int lspjump_frame_parser_next(LspJumpFrameParser *self, const char **body, size_t *body_len);
+
+G_END_DECLS
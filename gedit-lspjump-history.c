@@ -0,0 +1,584 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gedit/gedit-tab.h>
+#include <gedit/gedit-document.h>
+
+#include "gedit-lspjump-history.h"
+#include "gedit-lspjump-common.h"
+
+#define LSPJUMP_HISTORY_KEY "lspjump-history"
+
+// File layout, little endian: magic, count, current, then count times line,
+// character, uri length and the uri without its terminator
+#define LSPJUMP_HISTORY_MAGIC "LJH1"
+
+// Only one history is kept on disk, the one of the window that jumped last
+static LspJumpHistory *GLOBAL_HISTORY_OWNER=NULL;
+
+static inline LspJumpHistoryEntry *entry_at(LspJumpHistory *self, guint index)
+{
+	return &self->entries[(self->start+index)%LSPJUMP_HISTORY_CAPACITY];
+}
+
+static char *get_document_uri(GeditDocument *doc)
+{
+	GtkSourceFile *source_file=gedit_document_get_file(doc);
+	GFile *gfile=source_file?gtk_source_file_get_location(source_file):NULL;
+
+	return gfile?g_file_get_uri(gfile):NULL;
+}
+
+/**
+	Line and column in the buffer, the end of the line or of the buffer if the
+	text got shorter
+*/
+static void get_iter_at_position(GtkTextBuffer *buffer, GtkTextIter *iter, guint32 line, guint32 character)
+{
+	gtk_text_buffer_get_iter_at_line(buffer,iter,line);
+
+	if(gtk_text_iter_get_line(iter)!=(gint)line)
+	{
+		gtk_text_buffer_get_end_iter(buffer,iter);
+	}
+	else if(character<(guint32)gtk_text_iter_get_chars_in_line(iter))
+	{
+		gtk_text_iter_set_line_offset(iter,character);
+	}
+	else if(!gtk_text_iter_ends_line(iter))
+	{
+		gtk_text_iter_forward_to_line_end(iter);
+	}
+}
+
+static void entry_drop_mark(LspJumpHistoryEntry *entry)
+{
+	if(entry->mark==NULL)
+	{
+		return;
+	}
+
+	GtkTextBuffer *buffer=gtk_text_mark_get_buffer(entry->mark);
+
+	if(buffer)
+	{
+		gtk_text_buffer_delete_mark(buffer,entry->mark);
+	}
+
+	g_clear_object(&entry->mark);
+}
+
+static void entry_clear(LspJumpHistoryEntry *entry)
+{
+	entry_drop_mark(entry);
+	entry->uri=NULL;
+}
+
+/**
+	Bring the line, column and uri up to date with where the mark is now
+*/
+static void entry_refresh(LspJumpHistoryEntry *entry)
+{
+	GtkTextBuffer *buffer=entry->mark?gtk_text_mark_get_buffer(entry->mark):NULL;
+
+	if(buffer==NULL)
+	{
+		return;
+	}
+
+	GtkTextIter iter;
+	gtk_text_buffer_get_iter_at_mark(buffer,&iter,entry->mark);
+
+	entry->line=gtk_text_iter_get_line(&iter);
+	entry->character=gtk_text_iter_get_line_offset(&iter);
+
+	// Saved under another name since
+	g_autofree char *uri=get_document_uri(GEDIT_DOCUMENT(buffer));
+
+	if(uri)
+	{
+		entry->uri=g_intern_string(uri);
+	}
+}
+
+static void entry_anchor(LspJumpHistoryEntry *entry, GtkTextBuffer *buffer)
+{
+	GtkTextIter iter;
+
+	entry_drop_mark(entry);
+	get_iter_at_position(buffer,&iter,entry->line,entry->character);
+
+	// Left gravity, text typed at the position goes after it
+	entry->mark=g_object_ref(gtk_text_buffer_create_mark(buffer,NULL,&iter,TRUE));
+}
+
+/**
+	@return
+		FALSE if the document has no file to come back to
+*/
+static gboolean entry_set_cursor(LspJumpHistoryEntry *entry, GeditDocument *doc)
+{
+	g_autofree char *uri=doc?get_document_uri(doc):NULL;
+
+	if(uri==NULL)
+	{
+		return FALSE;
+	}
+
+	GtkTextBuffer *buffer=GTK_TEXT_BUFFER(doc);
+	GtkTextIter iter;
+
+	gtk_text_buffer_get_iter_at_mark(buffer,&iter,gtk_text_buffer_get_insert(buffer));
+
+	entry_drop_mark(entry);
+	entry->uri=g_intern_string(uri);
+	entry->line=gtk_text_iter_get_line(&iter);
+	entry->character=gtk_text_iter_get_line_offset(&iter);
+	entry->mark=g_object_ref(gtk_text_buffer_create_mark(buffer,NULL,&iter,TRUE));
+
+	return TRUE;
+}
+
+/**
+	@return
+		the new newest entry, the oldest one makes room for it when the ring is full
+*/
+static LspJumpHistoryEntry *push_entry(LspJumpHistory *self)
+{
+	if(self->len==LSPJUMP_HISTORY_CAPACITY)
+	{
+		entry_clear(entry_at(self,0));
+		self->start=(self->start+1)%LSPJUMP_HISTORY_CAPACITY;
+		self->len--;
+
+		if(self->current>0)
+		{
+			self->current--;
+		}
+	}
+
+	return entry_at(self,self->len++);
+}
+
+/**
+	Entries of a document that was just loaded in the window start to follow its edits
+*/
+static void anchor_document(LspJumpHistory *self, GeditDocument *doc)
+{
+	g_autofree char *uri=get_document_uri(doc);
+
+	if(uri==NULL)
+	{
+		return;
+	}
+
+	const char *interned=g_intern_string(uri);
+
+	for(guint index=0;index<self->len;index++)
+	{
+		LspJumpHistoryEntry *entry=entry_at(self,index);
+
+		if(entry->uri==interned && entry->mark==NULL)
+		{
+			entry_anchor(entry,GTK_TEXT_BUFFER(doc));
+		}
+	}
+}
+
+//////////////////////////////////
+
+static gboolean read_u32(const guint8 **cursor, const guint8 *end, guint32 *value)
+{
+	if(end-*cursor<4)
+	{
+		return FALSE;
+	}
+
+	memcpy(value,*cursor,4);
+	*value=GUINT32_FROM_LE(*value);
+	*cursor+=4;
+
+	return TRUE;
+}
+
+static void append_u32(GByteArray *data, guint32 value)
+{
+	value=GUINT32_TO_LE(value);
+	g_byte_array_append(data,(const guint8 *)&value,4);
+}
+
+static char *get_history_path(void)
+{
+	return g_build_filename(g_get_user_cache_dir(),LSPJUMP_HISTORY_FILE,NULL);
+}
+
+static void load_history(LspJumpHistory *self)
+{
+	g_autofree char *path=get_history_path();
+	g_autofree char *contents=NULL;
+	gsize length;
+
+	if(!g_file_get_contents(path,&contents,&length,NULL) || length<12 || memcmp(contents,LSPJUMP_HISTORY_MAGIC,4)!=0)
+	{
+		return;
+	}
+
+	const guint8 *cursor=(const guint8 *)contents+4;
+	const guint8 *end=(const guint8 *)contents+length;
+	guint32 count, current;
+
+	read_u32(&cursor,end,&count);
+	read_u32(&cursor,end,&current);
+
+	guint32 loaded=0;
+
+	for(;loaded<count;loaded++)
+	{
+		guint32 line, character, uri_len;
+
+		if(!read_u32(&cursor,end,&line) || !read_u32(&cursor,end,&character) || !read_u32(&cursor,end,&uri_len) ||
+		   (gsize)(end-cursor)<uri_len || !g_utf8_validate((const char *)cursor,uri_len,NULL))
+		{
+			g_printerr("Ignoring the damaged end of %s\n",path);
+			break;
+		}
+
+		g_autofree char *uri=g_strndup((const char *)cursor,uri_len);
+		cursor+=uri_len;
+
+		LspJumpHistoryEntry *entry=push_entry(self);
+		entry->uri=g_intern_string(uri);
+		entry->line=line;
+		entry->character=character;
+	}
+
+	// The oldest ones did not fit in the ring
+	guint32 dropped=loaded-self->len;
+
+	current=current>dropped?current-dropped:0;
+	self->current=self->len>0?MIN(current,self->len-1):0;
+}
+
+/**
+	Write the history to the file, unless another window has jumped since
+*/
+static gboolean save_history(gpointer data)
+{
+	LspJumpHistory *self=data;
+
+	self->save_source=0;
+
+	if(self!=GLOBAL_HISTORY_OWNER)
+	{
+		return G_SOURCE_REMOVE;
+	}
+
+	g_autoptr(GByteArray) contents=g_byte_array_new();
+	guint32 count=0, current=0;
+
+	g_byte_array_append(contents,(const guint8 *)LSPJUMP_HISTORY_MAGIC,4);
+	append_u32(contents,0);
+	append_u32(contents,0);
+
+	for(guint index=0;index<self->len;index++)
+	{
+		LspJumpHistoryEntry *entry=entry_at(self,index);
+
+		entry_refresh(entry);
+
+		if(entry->uri==NULL)
+		{
+			continue;
+		}
+
+		if(index<=self->current)
+		{
+			current=count;
+		}
+
+		guint32 uri_len=strlen(entry->uri);
+
+		append_u32(contents,entry->line);
+		append_u32(contents,entry->character);
+		append_u32(contents,uri_len);
+		g_byte_array_append(contents,(const guint8 *)entry->uri,uri_len);
+		count++;
+	}
+
+	count=GUINT32_TO_LE(count);
+	current=GUINT32_TO_LE(current);
+	memcpy(contents->data+4,&count,4);
+	memcpy(contents->data+8,&current,4);
+
+	g_autofree char *path=get_history_path();
+	g_autoptr(GError) error=NULL;
+
+	if(!g_file_set_contents(path,(const char *)contents->data,contents->len,&error))
+	{
+		g_printerr("Could not save the jump history: %s\n",error->message);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void schedule_save(LspJumpHistory *self)
+{
+	GLOBAL_HISTORY_OWNER=self;
+
+	if(self->save_source==0)
+	{
+		self->save_source=g_timeout_add_seconds(LSPJUMP_HISTORY_SAVE_DELAY_S,save_history,self);
+	}
+}
+
+//////////////////////////////////
+
+static void on_document_loaded(GeditDocument *doc, gpointer user_data)
+{
+	LspJumpHistory *self=g_object_get_data(G_OBJECT(user_data),LSPJUMP_HISTORY_KEY);
+
+	if(self)
+	{
+		anchor_document(self,doc);
+	}
+}
+
+static void on_tab_added(GeditWindow *window, GeditTab *tab, gpointer user_data)
+{
+	// Gone with the window, the history may be detached before that
+	g_signal_connect_object(gedit_tab_get_document(tab),"loaded",G_CALLBACK(on_document_loaded),window,0);
+}
+
+static void on_tab_removed(GeditWindow *window, GeditTab *tab, gpointer user_data)
+{
+	LspJumpHistory *self=user_data;
+	GtkTextBuffer *buffer=GTK_TEXT_BUFFER(gedit_tab_get_document(tab));
+
+	g_signal_handlers_disconnect_by_func(buffer,on_document_loaded,window);
+
+	for(guint index=0;index<self->len;index++)
+	{
+		LspJumpHistoryEntry *entry=entry_at(self,index);
+
+		if(entry->mark && gtk_text_mark_get_buffer(entry->mark)==buffer)
+		{
+			entry_refresh(entry);
+			entry_drop_mark(entry);
+		}
+	}
+
+	// The positions of the document are final now, not a reason to take the file over
+	if(self==GLOBAL_HISTORY_OWNER)
+	{
+		schedule_save(self);
+	}
+}
+
+static void lspjump_history_free(gpointer data)
+{
+	LspJumpHistory *self=data;
+
+	g_clear_handle_id(&self->save_source,g_source_remove);
+
+	if(GLOBAL_HISTORY_OWNER==self)
+	{
+		GLOBAL_HISTORY_OWNER=NULL;
+	}
+
+	for(guint index=0;index<self->len;index++)
+	{
+		entry_clear(entry_at(self,index));
+	}
+
+	free(self);
+}
+
+static LspJumpHistory *get_history(GeditWindow *window)
+{
+	return g_object_get_data(G_OBJECT(window),LSPJUMP_HISTORY_KEY);
+}
+
+/**
+	Give the window a history, starting from the one saved last
+*/
+void lspjump_history_attach(GeditWindow *window)
+{
+	if(get_history(window))
+	{
+		return;
+	}
+
+	LspJumpHistory *self=calloc(1,sizeof(LspJumpHistory));
+	self->window=window;
+
+	g_object_set_data_full(G_OBJECT(window),LSPJUMP_HISTORY_KEY,self,lspjump_history_free);
+
+	load_history(self);
+
+	GList *documents=gedit_window_get_documents(window);
+
+	for(GList *item=documents;item;item=item->next)
+	{
+		GeditTab *tab=gedit_tab_get_from_document(item->data);
+
+		on_tab_added(window,tab,self);
+
+		if(gedit_tab_get_state(tab)==GEDIT_TAB_STATE_NORMAL)
+		{
+			anchor_document(self,item->data);
+		}
+	}
+
+	g_list_free(documents);
+
+	self->tab_added_handler=g_signal_connect(window,"tab-added",G_CALLBACK(on_tab_added),self);
+	self->tab_removed_handler=g_signal_connect(window,"tab-removed",G_CALLBACK(on_tab_removed),self);
+}
+
+/**
+	Save the history of the window if it jumped last, and forget it
+*/
+void lspjump_history_detach(GeditWindow *window)
+{
+	LspJumpHistory *self=get_history(window);
+
+	if(self==NULL)
+	{
+		return;
+	}
+
+	g_clear_handle_id(&self->save_source,g_source_remove);
+	save_history(self);
+
+	g_signal_handler_disconnect(window,self->tab_added_handler);
+	g_signal_handler_disconnect(window,self->tab_removed_handler);
+
+	g_object_set_data(G_OBJECT(window),LSPJUMP_HISTORY_KEY,NULL);
+}
+
+/**
+	Remember a jump from the cursor of the active document to a position. Forward
+	positions are forgotten, the jump goes somewhere else.
+*/
+void lspjump_history_track(GeditWindow *window, GFile *gfile, long line, long character)
+{
+	LspJumpHistory *self=get_history(window);
+
+	if(self==NULL)
+	{
+		return;
+	}
+
+	while(self->len>self->current+1)
+	{
+		entry_clear(entry_at(self,--self->len));
+	}
+
+	GeditDocument *doc=gedit_window_get_active_document(window);
+
+	// Where the cursor was moved to since the last jump is what back returns to
+	if(self->len==0)
+	{
+		LspJumpHistoryEntry *entry=push_entry(self);
+
+		if(!entry_set_cursor(entry,doc))
+		{
+			self->len--;
+		}
+	}
+	else
+	{
+		entry_set_cursor(entry_at(self,self->current),doc);
+	}
+
+	g_autofree char *uri=g_file_get_uri(gfile);
+	LspJumpHistoryEntry *entry=push_entry(self);
+
+	entry->uri=g_intern_string(uri);
+	entry->line=MAX(line,0);
+	entry->character=MAX(character,0);
+
+	GeditTab *tab=gedit_window_get_tab_from_location(window,gfile);
+
+	if(tab && gedit_tab_get_state(tab)==GEDIT_TAB_STATE_NORMAL)
+	{
+		entry_anchor(entry,GTK_TEXT_BUFFER(gedit_tab_get_document(tab)));
+	}
+
+	self->current=self->len-1;
+
+	schedule_save(self);
+}
+
+static void go_to_entry(LspJumpHistory *self, guint index)
+{
+	LspJumpHistoryEntry *entry=entry_at(self,index);
+
+	entry_refresh(entry);
+
+	g_autoptr(GFile) gfile=g_file_new_for_uri(entry->uri);
+
+	self->current=index;
+	gedit_lspjump_goto_file_line_column(self->window,gfile,entry->line,entry->character);
+
+	schedule_save(self);
+}
+
+/**
+	@return
+		FALSE if there is nothing further back
+*/
+gboolean lspjump_history_back(GeditWindow *window)
+{
+	LspJumpHistory *self=get_history(window);
+
+	if(self==NULL || self->current==0)
+	{
+		return FALSE;
+	}
+
+	// Forward comes back to where the cursor is now
+	entry_set_cursor(entry_at(self,self->current),gedit_window_get_active_document(window));
+	go_to_entry(self,self->current-1);
+
+	return TRUE;
+}
+
+/**
+	@return
+		FALSE if there is nothing further forward
+*/
+gboolean lspjump_history_forward(GeditWindow *window)
+{
+	LspJumpHistory *self=get_history(window);
+
+	if(self==NULL || self->current+1>=self->len)
+	{
+		return FALSE;
+	}
+
+	entry_set_cursor(entry_at(self,self->current),gedit_window_get_active_document(window));
+	go_to_entry(self,self->current+1);
+
+	return TRUE;
+}
@@ -0,0 +1,69 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <gedit/gedit-window.h>
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_HISTORY_CAPACITY 64
+#define LSPJUMP_HISTORY_SAVE_DELAY_S 2
+#define LSPJUMP_HISTORY_FILE "lspjump-history.bin"
+
+/**
+	One place in the history. While its document is open in the window the mark
+	keeps it on the same text through edits, otherwise it is only a line and column.
+*/
+typedef struct LspJumpHistoryEntry
+{
+	const char *uri; // interned, NULL for a free slot
+	GtkTextMark *mark; // NULL unless the document is open
+	guint32 line;
+	guint32 character;
+}LspJumpHistoryEntry;
+
+/**
+	Back and forward positions of one window, a ring that forgets the oldest
+	position once it is full.
+
+	Only one history is saved, the one of the window that jumped last. A new
+	window starts from it, the histories of the other windows are not kept.
+*/
+typedef struct LspJumpHistory
+{
+	GeditWindow *window; // not owned, the history lives as data on it
+	LspJumpHistoryEntry entries[LSPJUMP_HISTORY_CAPACITY];
+	guint start; // slot of the oldest position
+	guint len;
+	guint current; // counted from the oldest, where back and forward go from
+
+	guint save_source;
+	gulong tab_added_handler;
+	gulong tab_removed_handler;
+}LspJumpHistory;
+
+void lspjump_history_attach(GeditWindow *window);
+void lspjump_history_detach(GeditWindow *window);
+void lspjump_history_track(GeditWindow *window, GFile *gfile, long line, long character);
+gboolean lspjump_history_back(GeditWindow *window);
+gboolean lspjump_history_forward(GeditWindow *window);
+
+G_END_DECLS
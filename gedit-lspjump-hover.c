@@ -0,0 +1,271 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-hover.h"
+#include "gedit-lspjump-rpc.h"
+#include "gedit-lspjump-docsync.h"
+#include "gedit-lspjump-common.h"
+#include "gedit-lspjump-configuration.h"
+
+#define LSPJUMP_HOVER_KEY "lspjump-hover"
+
+static gboolean range_equal(const LspJumpRange *a, const LspJumpRange *b)
+{
+	return a->line==b->line && a->start==b->start && a->end==b->end;
+}
+
+static void cancel_pending(LspJumpHover *self)
+{
+	if(self->delay_source)
+	{
+		g_source_remove(self->delay_source);
+		self->delay_source=0;
+	}
+
+	if(self->inflight_id>0)
+	{
+		lspjump_rpc_cancel(self->inflight_endpoint,self->inflight_id);
+		self->inflight_id=0;
+		g_clear_pointer(&self->inflight_endpoint,lspjump_rpc_endpoint_unref);
+	}
+
+	self->has_pending=0;
+}
+
+/**
+	contents is MarkupContent, a MarkedString or an array of MarkedString
+*/
+static void append_contents(GString *text, json_t *contents)
+{
+	if(json_is_string(contents))
+	{
+		g_string_append(text,json_string_value(contents));
+	}
+	else if(json_is_object(contents))
+	{
+		g_string_append(text,json_string_value(json_object_get(contents,"value")));
+	}
+	else if(json_is_array(contents))
+	{
+		size_t index;
+		json_t *item;
+
+		json_array_foreach(contents,index,item)
+		{
+			if(text->len>0)
+			{
+				g_string_append(text,"\n\n");
+			}
+
+			append_contents(text,item);
+		}
+	}
+}
+
+/**
+{
+	"id":2367,"jsonrpc":"2.0","result":
+	{
+		"contents":
+		{
+			"kind":"markdown",
+			"value":"### macro `g_return_if_fail`  \nprovided by `\"glib.h\"`  \n\n---\n```cpp\n#define g_return_if_fail(expr)                                                 \\\n  G_STMT_START {                                                               \\\n    if (G_LIKELY(expr)) {                                                      \\\n    } else {                                                                   \\\n      g_return_if_fail_warning(G_LOG_DOMAIN, G_STRFUNC, #expr);                \\\n      return;                                                                  \\\n    }                                                                          \\\n  }                                                                            \\\n  G_STMT_END\n\n// Expands to\ndo {\n  if ((doc != ((void *)0))) {\n  } else {\n    g_return_if_fail_warning(((gchar *)0), ((const char *)(__func__)),\n                             \"doc != NULL\");\n    return;\n  }\n} while (0)\n```"
+		},
+		"range":
+		{
+			"end":
+			{
+				"character":20,
+				"line":54
+			},
+			"start":
+			{
+				"character":4,
+				"line":54
+			}
+		}
+	}
+}
+
+*/
+static void lspjump_rpc_hover_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+{
+	LspJumpHover *self=user_data;
+
+	// Superseded hovers are cancelled, so this is the reply for the latest position
+	self->inflight_id=0;
+	self->has_pending=0;
+	g_clear_pointer(&self->inflight_endpoint,lspjump_rpc_endpoint_unref);
+
+	json_t *result = json_object_get(root, "result");
+	if (!json_is_object(result) || json_object_size(result) == 0)
+	{
+		return;
+	}
+
+	g_autoptr(GString) text=g_string_new(NULL);
+	append_contents(text,json_object_get(result,"contents"));
+
+	if(text->len==0)
+	{
+		return;
+	}
+
+	g_free(self->result_text);
+	self->result_text=g_strdup(text->str);
+	self->result_range=self->pending;
+	self->has_result=1;
+
+	gtk_widget_trigger_tooltip_query(GTK_WIDGET(self->view));
+}
+
+static gboolean send_hover(gpointer data)
+{
+	LspJumpHover *self=data;
+	GeditDocument *doc=GEDIT_DOCUMENT(gtk_text_view_get_buffer(GTK_TEXT_VIEW(self->view)));
+	GtkSourceFile *source_file=gedit_document_get_file(doc);
+	GFile *gfile=source_file?gtk_source_file_get_location(source_file):NULL;
+
+	self->delay_source=0;
+
+	if(!gfile)
+	{
+		self->has_pending=0;
+		return G_SOURCE_REMOVE;
+	}
+
+	g_autofree gchar *uri=g_file_get_uri(gfile);
+
+	JsonRpcEndpoint *endpoint=lspjump_document_sync_flush(doc);
+
+	int version=lspjump_document_sync_get(doc)->version;
+	int column=lspjump_document_sync_to_lsp_column(doc,endpoint,self->pending.line,self->pending_offset);
+	int id=lspjump_rpc_hover(endpoint,uri,version,&self->pending,self->pending.line,column,lspjump_rpc_hover_cb,self);
+
+	// has_pending is cleared if the reply came before the id did
+	if(id>0 && self->has_pending)
+	{
+		self->inflight_id=id;
+		self->inflight_endpoint=lspjump_rpc_endpoint_ref(endpoint);
+	}
+	else
+	{
+		self->has_pending=0;
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean on_query_tooltip(GtkWidget *widget, int x, int y, gboolean keyboard_mode, GtkTooltip *tooltip, gpointer user_data)
+{
+	LspJumpHover *self=user_data;
+
+	if(keyboard_mode)
+	{
+		return FALSE;
+	}
+
+	gint buf_x,buf_y;
+	gtk_text_view_window_to_buffer_coords(GTK_TEXT_VIEW(widget),GTK_TEXT_WINDOW_WIDGET,x,y,&buf_x,&buf_y);
+
+	GtkTextIter iter, start, end;
+
+	if(!gtk_text_view_get_iter_at_location(GTK_TEXT_VIEW(widget),&iter,buf_x,buf_y) ||
+	   !lspjump_get_identifier_bounds(&iter,&start,&end))
+	{
+		cancel_pending(self);
+		return FALSE;
+	}
+
+	LspJumpRange range={
+		.line=gtk_text_iter_get_line(&start),
+		.start=gtk_text_iter_get_line_offset(&start),
+		.end=gtk_text_iter_get_line_offset(&end)
+	};
+
+	if(self->has_result && range_equal(&range,&self->result_range))
+	{
+		gtk_tooltip_set_text(tooltip,self->result_text);
+		return TRUE;
+	}
+
+	// Still the same identifier, the timer or the server is already on it
+	if(self->has_pending && range_equal(&range,&self->pending))
+	{
+		return FALSE;
+	}
+
+	cancel_pending(self);
+
+	self->pending=range;
+	self->pending_offset=gtk_text_iter_get_line_offset(&iter);
+	self->has_pending=1;
+	self->delay_source=g_timeout_add(lspjump_configuration_get_int("hover_delay",LSPJUMP_HOVER_DEFAULT_DELAY_MS),send_hover,self);
+
+	return FALSE;
+}
+
+static void on_buffer_changed(GtkTextBuffer *buffer, gpointer user_data)
+{
+	LspJumpHover *self=user_data;
+
+	self->has_result=0;
+	cancel_pending(self);
+}
+
+static void lspjump_hover_free(gpointer data)
+{
+	LspJumpHover *self=data;
+
+	cancel_pending(self);
+
+	g_signal_handler_disconnect(self->buffer,self->changed_handler);
+	g_object_unref(self->buffer);
+
+	g_free(self->result_text);
+	free(self);
+}
+
+/**
+	Show hover information in the tooltip of the view
+*/
+void lspjump_hover_attach(GeditView *view)
+{
+	if(g_object_get_data(G_OBJECT(view),LSPJUMP_HOVER_KEY))
+	{
+		return;
+	}
+
+	LspJumpHover *self=calloc(1,sizeof(LspJumpHover));
+	self->view=view;
+
+	g_object_set_data_full(G_OBJECT(view),LSPJUMP_HOVER_KEY,self,lspjump_hover_free);
+
+	gtk_widget_set_has_tooltip(GTK_WIDGET(view),TRUE);
+	g_signal_connect(view,"query-tooltip",G_CALLBACK(on_query_tooltip),self);
+
+	self->buffer=g_object_ref(gtk_text_view_get_buffer(GTK_TEXT_VIEW(view)));
+	self->changed_handler=g_signal_connect(self->buffer,"changed",G_CALLBACK(on_buffer_changed),self);
+}
@@ -0,0 +1,59 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <stdint.h>
+#include <gedit/gedit-view.h>
+
+#include "gedit-lspjump-cache.h"
+#include "gedit-lspjump-rpc.h"
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_HOVER_DEFAULT_DELAY_MS 350
+
+/**
+	Hover state of one view. A request is only sent once the pointer has rested on
+	an identifier for the configured delay, and only the reply for the latest
+	identifier is ever shown.
+*/
+typedef struct LspJumpHover
+{
+	GeditView *view; // not owned, the state lives as data on the view
+	guint delay_source;
+	int inflight_id; // hover request waiting for its reply, 0 if none
+	JsonRpcEndpoint *inflight_endpoint; // referenced while inflight_id is set
+
+	uint8_t has_pending: 1; // pending is waited for, by the timer or the server
+	uint8_t has_result: 1;
+	LspJumpRange pending;
+	int pending_offset; // pointer position within the line
+
+	LspJumpRange result_range;
+	char *result_text;
+
+	GtkTextBuffer *buffer;
+	gulong changed_handler;
+}LspJumpHover;
+
+void lspjump_hover_attach(GeditView *view);
+
+G_END_DECLS
@@ -0,0 +1,841 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-jsonpull.h"
+
+/**
+	Range kinds, a better one replaces what has been read so far
+*/
+enum
+{
+	RANGE_NONE,
+	RANGE_TARGET, // LocationLink targetRange, the whole definition
+	RANGE_LOCATION, // Location range
+	RANGE_TARGET_SELECTION // LocationLink targetSelectionRange, the name
+};
+
+typedef struct JsonPull
+{
+	const char *p;
+	const char *end;
+}JsonPull;
+
+/**
+	The location being read, the fields may come in any order
+*/
+typedef struct PullLocation
+{
+	GString *uri;
+	GString *name;
+	gboolean has_uri;
+	gboolean has_name;
+	int range_kind;
+	int range[4];
+}PullLocation;
+
+LspJumpLocations *lspjump_locations_new(void)
+{
+	LspJumpLocations *self=calloc(1,sizeof(LspJumpLocations));
+	
+	self->ref_count=1;
+	self->strings=g_string_chunk_new(4096);
+	
+	return self;
+}
+
+LspJumpLocations *lspjump_locations_ref(LspJumpLocations *self)
+{
+	g_atomic_int_inc(&self->ref_count);
+	
+	return self;
+}
+
+void lspjump_locations_unref(LspJumpLocations *self)
+{
+	if(self && g_atomic_int_dec_and_test(&self->ref_count))
+	{
+		g_string_chunk_free(self->strings);
+		g_free(self->items);
+		free(self);
+	}
+}
+
+static const char *intern(LspJumpLocations *self, const char *const str)
+{
+	// Replies are grouped by file, most locations share the uri of the one before
+	if(self->len>1 && strcmp(self->items[self->len-2].uri,str)==0)
+	{
+		return self->items[self->len-2].uri;
+	}
+	
+	// Counted again when the uris alternate, close enough for the cache budget
+	self->string_bytes+=strlen(str)+1;
+	
+	return g_string_chunk_insert_const(self->strings,str);
+}
+
+/**
+	@return
+		the new location, zeroed except for the uri
+*/
+LspJumpLocation *lspjump_locations_append(LspJumpLocations *self, const char *const uri)
+{
+	if(self->len==self->allocated)
+	{
+		self->allocated=self->allocated?self->allocated*2:16;
+		self->items=g_renew(LspJumpLocation,self->items,self->allocated);
+	}
+	
+	LspJumpLocation *location=&self->items[self->len++];
+	
+	memset(location,0,sizeof(LspJumpLocation));
+	location->uri=intern(self,uri);
+	
+	return location;
+}
+
+size_t lspjump_locations_size(LspJumpLocations *self)
+{
+	return sizeof(LspJumpLocations)+self->allocated*sizeof(LspJumpLocation)+self->string_bytes;
+}
+
+static void skip_ws(JsonPull *self)
+{
+	while(self->p<self->end && (*self->p==' ' || *self->p=='\t' || *self->p=='\n' || *self->p=='\r'))
+	{
+		self->p++;
+	}
+}
+
+static gboolean consume(JsonPull *self, char c)
+{
+	skip_ws(self);
+	
+	if(self->p<self->end && *self->p==c)
+	{
+		self->p++;
+		return TRUE;
+	}
+	
+	return FALSE;
+}
+
+/**
+	Find the quote that ends the string starting at self->p
+
+	@return
+		the closing quote, NULL if the string does not end
+*/
+static const char *find_string_end(JsonPull *self)
+{
+	const char *start=self->p+1;
+	const char *q=start;
+	
+	while(q<self->end && (q=memchr(q,'"',self->end-q)))
+	{
+		const char *b=q;
+		
+		while(b>start && b[-1]=='\\')
+		{
+			b--;
+		}
+		
+		// An even number of backslashes escape each other, not the quote
+		if(((q-b)&1)==0)
+		{
+			return q;
+		}
+		
+		q++;
+	}
+	
+	return NULL;
+}
+
+static gboolean skip_string(JsonPull *self)
+{
+	const char *q=find_string_end(self);
+	
+	if(q==NULL)
+	{
+		return FALSE;
+	}
+	
+	self->p=q+1;
+	
+	return TRUE;
+}
+
+/**
+	Read a key without unescaping it, the keys looked for have no escapes
+*/
+static gboolean read_key(JsonPull *self, const char **key, size_t *key_len)
+{
+	skip_ws(self);
+	
+	if(self->p>=self->end || *self->p!='"')
+	{
+		return FALSE;
+	}
+	
+	const char *q=find_string_end(self);
+	
+	if(q==NULL)
+	{
+		return FALSE;
+	}
+	
+	*key=self->p+1;
+	*key_len=q-*key;
+	self->p=q+1;
+	
+	return consume(self,':');
+}
+
+static gboolean key_is(const char *key, size_t key_len, const char *const name)
+{
+	return strlen(name)==key_len && memcmp(key,name,key_len)==0;
+}
+
+static int hex_value(const char *hex)
+{
+	int value=0;
+	
+	for(int i=0;i<4;i++)
+	{
+		int digit=g_ascii_xdigit_value(hex[i]);
+		
+		if(digit<0)
+		{
+			return -1;
+		}
+		
+		value=value*16+digit;
+	}
+	
+	return value;
+}
+
+static gboolean read_string(JsonPull *self, GString *out)
+{
+	skip_ws(self);
+	g_string_truncate(out,0);
+	
+	if(self->p>=self->end || *self->p!='"')
+	{
+		return FALSE;
+	}
+	
+	const char *q=find_string_end(self);
+	const char *c=self->p+1;
+	
+	if(q==NULL)
+	{
+		return FALSE;
+	}
+	
+	self->p=q+1;
+	
+	// Uris are plain ascii almost always
+	if(memchr(c,'\\',q-c)==NULL)
+	{
+		g_string_append_len(out,c,q-c);
+		return TRUE;
+	}
+	
+	while(c<q)
+	{
+		if(*c!='\\')
+		{
+			g_string_append_c(out,*c++);
+			continue;
+		}
+		
+		c++;
+		
+		switch(*c)
+		{
+			case 'b': g_string_append_c(out,'\b'); c++; break;
+			case 'f': g_string_append_c(out,'\f'); c++; break;
+			case 'n': g_string_append_c(out,'\n'); c++; break;
+			case 'r': g_string_append_c(out,'\r'); c++; break;
+			case 't': g_string_append_c(out,'\t'); c++; break;
+			case 'u':
+			{
+				if(q-c<5)
+				{
+					return FALSE;
+				}
+				
+				int unit=hex_value(c+1);
+				c+=5;
+				
+				if(unit<0)
+				{
+					return FALSE;
+				}
+				
+				gunichar ch=unit;
+				
+				if(unit>=0xD800 && unit<0xDC00 && q-c>=6 && c[0]=='\\' && c[1]=='u')
+				{
+					int low=hex_value(c+2);
+					
+					if(low>=0xDC00 && low<0xE000)
+					{
+						ch=0x10000+((unit-0xD800)<<10)+(low-0xDC00);
+						c+=6;
+					}
+				}
+				
+				g_string_append_unichar(out,ch);
+				break;
+			}
+			default: g_string_append_c(out,*c++); break;
+		}
+	}
+	
+	return TRUE;
+}
+
+static gboolean read_long(JsonPull *self, long *value)
+{
+	skip_ws(self);
+	
+	gboolean negative=FALSE;
+	long result=0;
+	const char *start;
+	
+	if(self->p<self->end && *self->p=='-')
+	{
+		negative=TRUE;
+		self->p++;
+	}
+	
+	start=self->p;
+	
+	while(self->p<self->end && g_ascii_isdigit(*self->p))
+	{
+		result=result*10+(*self->p-'0');
+		self->p++;
+	}
+	
+	// Fractions and exponents are not positions or ids
+	if(self->p==start || (self->p<self->end && (*self->p=='.' || *self->p=='e' || *self->p=='E')))
+	{
+		return FALSE;
+	}
+	
+	*value=negative?-result:result;
+	
+	return TRUE;
+}
+
+static gboolean read_int(JsonPull *self, int *value)
+{
+	long result;
+	
+	if(!read_long(self,&result))
+	{
+		return FALSE;
+	}
+	
+	*value=result;
+	
+	return TRUE;
+}
+
+static gboolean skip_value(JsonPull *self)
+{
+	skip_ws(self);
+	
+	if(self->p>=self->end)
+	{
+		return FALSE;
+	}
+	
+	if(*self->p=='"')
+	{
+		return skip_string(self);
+	}
+	
+	if(*self->p!='{' && *self->p!='[')
+	{
+		// true, false, null or a number
+		while(self->p<self->end && *self->p!=',' && *self->p!='}' && *self->p!=']' &&
+		      *self->p!=' ' && *self->p!='\t' && *self->p!='\n' && *self->p!='\r')
+		{
+			self->p++;
+		}
+		
+		return TRUE;
+	}
+	
+	int depth=0;
+	
+	while(self->p<self->end)
+	{
+		char c=*self->p;
+		
+		if(c=='"')
+		{
+			if(!skip_string(self))
+			{
+				return FALSE;
+			}
+			
+			continue;
+		}
+		
+		self->p++;
+		
+		if(c=='{' || c=='[')
+		{
+			depth++;
+		}
+		else if((c=='}' || c==']') && --depth==0)
+		{
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+static gboolean parse_position(JsonPull *self, int *line, int *character)
+{
+	const char *key;
+	size_t key_len;
+	
+	if(!consume(self,'{'))
+	{
+		return FALSE;
+	}
+	
+	if(consume(self,'}'))
+	{
+		return TRUE;
+	}
+	
+	do
+	{
+		if(!read_key(self,&key,&key_len))
+		{
+			return FALSE;
+		}
+		
+		gboolean ok;
+		
+		if(key_is(key,key_len,"line"))
+		{
+			ok=read_int(self,line);
+		}
+		else if(key_is(key,key_len,"character"))
+		{
+			ok=read_int(self,character);
+		}
+		else
+		{
+			ok=skip_value(self);
+		}
+		
+		if(!ok)
+		{
+			return FALSE;
+		}
+	}while(consume(self,','));
+	
+	return consume(self,'}');
+}
+
+static gboolean parse_range(JsonPull *self, int range[4])
+{
+	const char *key;
+	size_t key_len;
+	
+	if(!consume(self,'{'))
+	{
+		return FALSE;
+	}
+	
+	if(consume(self,'}'))
+	{
+		return TRUE;
+	}
+	
+	do
+	{
+		if(!read_key(self,&key,&key_len))
+		{
+			return FALSE;
+		}
+		
+		gboolean ok;
+		
+		if(key_is(key,key_len,"start"))
+		{
+			ok=parse_position(self,&range[0],&range[1]);
+		}
+		else if(key_is(key,key_len,"end"))
+		{
+			ok=parse_position(self,&range[2],&range[3]);
+		}
+		else
+		{
+			ok=skip_value(self);
+		}
+		
+		if(!ok)
+		{
+			return FALSE;
+		}
+	}while(consume(self,','));
+	
+	return consume(self,'}');
+}
+
+static gboolean parse_location_range(JsonPull *self, PullLocation *location, int kind)
+{
+	int range[4]={0,0,0,0};
+	
+	if(!parse_range(self,range))
+	{
+		return FALSE;
+	}
+	
+	if(kind>location->range_kind)
+	{
+		memcpy(location->range,range,sizeof(range));
+		location->range_kind=kind;
+	}
+	
+	return TRUE;
+}
+
+/**
+	Location, LocationLink or SymbolInformation, whose location member is read the same way
+*/
+static gboolean parse_location(JsonPull *self, PullLocation *location)
+{
+	const char *key;
+	size_t key_len;
+	
+	if(!consume(self,'{'))
+	{
+		return FALSE;
+	}
+	
+	if(consume(self,'}'))
+	{
+		return TRUE;
+	}
+	
+	do
+	{
+		if(!read_key(self,&key,&key_len))
+		{
+			return FALSE;
+		}
+		
+		gboolean ok;
+		
+		if(key_is(key,key_len,"uri") || key_is(key,key_len,"targetUri"))
+		{
+			ok=location->has_uri=read_string(self,location->uri);
+		}
+		else if(key_is(key,key_len,"name"))
+		{
+			ok=location->has_name=read_string(self,location->name);
+		}
+		else if(key_is(key,key_len,"range"))
+		{
+			ok=parse_location_range(self,location,RANGE_LOCATION);
+		}
+		else if(key_is(key,key_len,"targetSelectionRange"))
+		{
+			ok=parse_location_range(self,location,RANGE_TARGET_SELECTION);
+		}
+		else if(key_is(key,key_len,"targetRange"))
+		{
+			ok=parse_location_range(self,location,RANGE_TARGET);
+		}
+		else if(key_is(key,key_len,"location"))
+		{
+			ok=parse_location(self,location);
+		}
+		else
+		{
+			ok=skip_value(self);
+		}
+		
+		if(!ok)
+		{
+			return FALSE;
+		}
+	}while(consume(self,','));
+	
+	return consume(self,'}');
+}
+
+static gboolean parse_item(JsonPull *self, PullLocation *location, LspJumpLocations *locations)
+{
+	location->has_uri=FALSE;
+	location->has_name=FALSE;
+	location->range_kind=RANGE_NONE;
+	memset(location->range,0,sizeof(location->range));
+	
+	// Anything without a uri, like DocumentSymbol, is left to jansson
+	if(!parse_location(self,location) || !location->has_uri)
+	{
+		return FALSE;
+	}
+	
+	LspJumpLocation *item=lspjump_locations_append(locations,location->uri->str);
+	
+	item->line=location->range[0];
+	item->character=location->range[1];
+	item->end_line=location->range[2];
+	item->end_character=location->range[3];
+	
+	if(location->has_name)
+	{
+		item->name=g_string_chunk_insert(locations->strings,location->name->str);
+		locations->string_bytes+=location->name->len+1;
+	}
+	
+	return TRUE;
+}
+
+/**
+	Find id, method, error and result at the top level of a message, skipping over
+	the values.
+
+	@return
+		FALSE if the message is not a well formed object
+*/
+gboolean lspjump_jsonpull_scan_reply(const char *json, size_t len, LspJumpReplyInfo *info)
+{
+	JsonPull pull={json,json+len};
+	const char *key;
+	size_t key_len;
+	
+	memset(info,0,sizeof(LspJumpReplyInfo));
+	
+	if(!consume(&pull,'{'))
+	{
+		return FALSE;
+	}
+	
+	if(consume(&pull,'}'))
+	{
+		return TRUE;
+	}
+	
+	do
+	{
+		if(!read_key(&pull,&key,&key_len))
+		{
+			return FALSE;
+		}
+		
+		gboolean ok;
+		
+		if(key_is(key,key_len,"id"))
+		{
+			skip_ws(&pull);
+			
+			// String ids are never sent by us
+			if(pull.p<pull.end && *pull.p!='"')
+			{
+				ok=info->has_id=read_long(&pull,&info->id);
+			}
+			else
+			{
+				ok=skip_value(&pull);
+			}
+		}
+		else if(key_is(key,key_len,"result"))
+		{
+			skip_ws(&pull);
+			info->result=pull.p;
+			ok=skip_value(&pull);
+			info->result_len=pull.p-info->result;
+		}
+		else
+		{
+			info->has_method|=key_is(key,key_len,"method");
+			info->has_error|=key_is(key,key_len,"error");
+			ok=skip_value(&pull);
+		}
+		
+		if(!ok)
+		{
+			return FALSE;
+		}
+	}while(consume(&pull,','));
+	
+	return consume(&pull,'}');
+}
+
+/**
+	Pull the locations out of the result of a definition, references or symbol
+	request without building a JSON tree.
+
+	@param json
+		the result value: null, one location or an array of them
+	@return
+		the locations, or NULL if the result has another shape
+*/
+LspJumpLocations *lspjump_locations_parse(const char *json, size_t len)
+{
+	JsonPull pull={json,json+len};
+	g_autoptr(LspJumpLocations) locations=lspjump_locations_new();
+	g_autoptr(GString) uri=g_string_sized_new(256);
+	g_autoptr(GString) name=g_string_sized_new(64);
+	PullLocation location={.uri=uri,.name=name};
+	
+	skip_ws(&pull);
+	
+	if(pull.end-pull.p>=4 && memcmp(pull.p,"null",4)==0)
+	{
+		return g_steal_pointer(&locations);
+	}
+	
+	if(pull.p<pull.end && *pull.p=='{')
+	{
+		return parse_item(&pull,&location,locations)?g_steal_pointer(&locations):NULL;
+	}
+	
+	if(!consume(&pull,'['))
+	{
+		return NULL;
+	}
+	
+	if(consume(&pull,']'))
+	{
+		return g_steal_pointer(&locations);
+	}
+	
+	do
+	{
+		if(!parse_item(&pull,&location,locations))
+		{
+			return NULL;
+		}
+	}while(consume(&pull,','));
+	
+	return consume(&pull,']')?g_steal_pointer(&locations):NULL;
+}
+
+static void fill_range(LspJumpLocation *item, json_t *range)
+{
+	json_t *start=json_object_get(range,"start");
+	json_t *end=json_object_get(range,"end");
+	
+	item->line=json_integer_value(json_object_get(start,"line"));
+	item->character=json_integer_value(json_object_get(start,"character"));
+	item->end_line=json_integer_value(json_object_get(end,"line"));
+	item->end_character=json_integer_value(json_object_get(end,"character"));
+}
+
+static gboolean append_from_json(LspJumpLocations *self, json_t *item)
+{
+	json_t *location=json_object_get(item,"location");
+	json_t *source=json_is_object(location)?location:item;
+	const char *uri=json_string_value(json_object_get(source,"uri"));
+	json_t *range=json_object_get(item,"targetSelectionRange");
+	
+	if(uri==NULL)
+	{
+		uri=json_string_value(json_object_get(item,"targetUri"));
+	}
+	
+	if(uri==NULL)
+	{
+		return FALSE;
+	}
+	
+	if(range==NULL)
+	{
+		range=json_object_get(source,"range");
+	}
+	
+	if(range==NULL)
+	{
+		range=json_object_get(item,"targetRange");
+	}
+	
+	LspJumpLocation *append=lspjump_locations_append(self,uri);
+	fill_range(append,range);
+	
+	const char *name=json_string_value(json_object_get(item,"name"));
+	
+	if(name)
+	{
+		append->name=g_string_chunk_insert(self->strings,name);
+		self->string_bytes+=strlen(name)+1;
+	}
+	
+	return TRUE;
+}
+
+/**
+	The same as lspjump_locations_parse, for replies that were parsed by jansson
+
+	@return
+		the locations, or NULL if the result has another shape
+*/
+LspJumpLocations *lspjump_locations_from_json(json_t *result)
+{
+	g_autoptr(LspJumpLocations) locations=lspjump_locations_new();
+	
+	if(json_is_null(result))
+	{
+		return g_steal_pointer(&locations);
+	}
+	
+	if(json_is_object(result))
+	{
+		return append_from_json(locations,result)?g_steal_pointer(&locations):NULL;
+	}
+	
+	if(!json_is_array(result))
+	{
+		return NULL;
+	}
+	
+	size_t index;
+	json_t *item;
+	
+	json_array_foreach(result,index,item)
+	{
+		if(!append_from_json(locations,item))
+		{
+			return NULL;
+		}
+	}
+	
+	return g_steal_pointer(&locations);
+}
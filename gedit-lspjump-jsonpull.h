@@ -0,0 +1,80 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <jansson.h>
+
+G_BEGIN_DECLS
+
+/**
+	One Location, LocationLink or SymbolInformation, reduced to what a jump needs
+*/
+typedef struct LspJumpLocation
+{
+	const char *uri; // interned in the strings of the list
+	const char *name; // SymbolInformation only, NULL otherwise
+	int line;
+	int character;
+	int end_line;
+	int end_character;
+}LspJumpLocation;
+
+/**
+	Compact, refcounted list of locations. Every uri is stored once no matter how
+	many locations point into the file.
+*/
+typedef struct LspJumpLocations
+{
+	gint ref_count;
+	GStringChunk *strings;
+	size_t string_bytes;
+	LspJumpLocation *items;
+	guint len;
+	guint allocated;
+}LspJumpLocations;
+
+/**
+	Where the interesting parts of a JSON-RPC message are, found without parsing
+	the values
+*/
+typedef struct LspJumpReplyInfo
+{
+	gboolean has_id;
+	long id;
+	gboolean has_method;
+	gboolean has_error;
+	const char *result; // the raw result value, NULL if there is none
+	size_t result_len;
+}LspJumpReplyInfo;
+
+LspJumpLocations *lspjump_locations_new(void);
+LspJumpLocations *lspjump_locations_ref(LspJumpLocations *self);
+void lspjump_locations_unref(LspJumpLocations *self);
+LspJumpLocation *lspjump_locations_append(LspJumpLocations *self, const char *const uri);
+size_t lspjump_locations_size(LspJumpLocations *self);
+
+gboolean lspjump_jsonpull_scan_reply(const char *json, size_t len, LspJumpReplyInfo *info);
+LspJumpLocations *lspjump_locations_parse(const char *json, size_t len);
+LspJumpLocations *lspjump_locations_from_json(json_t *result);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(LspJumpLocations,lspjump_locations_unref)
+
+G_END_DECLS
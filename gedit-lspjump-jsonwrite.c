@@ -0,0 +1,99 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-jsonwrite.h"
+
+/**
+	Bytes that can not be copied as they are, everything else including UTF-8 is
+	written unchanged like json_dumps does
+*/
+static const char NEEDS_ESCAPE[256]=
+{
+	[0 ... 0x1f]=1,
+	['"']=1,
+	['\\']=1,
+};
+
+/**
+	Append str escaped as the inside of a JSON string. Runs of plain bytes are
+	copied with one append, the output grows once per call at most.
+*/
+void lspjump_json_write_escaped(GString *out, const char *str, size_t len)
+{
+	const unsigned char *c=(const unsigned char *)str;
+	const unsigned char *end=c+len;
+	
+	// Escapes are rare in source code, reserve for the common case
+	if(out->allocated_len<out->len+len+1)
+	{
+		gsize used=out->len;
+		
+		g_string_set_size(out,used+len+len/16);
+		g_string_truncate(out,used);
+	}
+	
+	while(c<end)
+	{
+		const unsigned char *run=c;
+		
+		while(c<end && !NEEDS_ESCAPE[*c])
+		{
+			c++;
+		}
+		
+		if(c>run)
+		{
+			g_string_append_len(out,(const char *)run,c-run);
+		}
+		
+		if(c==end)
+		{
+			break;
+		}
+		
+		switch(*c)
+		{
+			case '"': g_string_append_len(out,"\\\"",2); break;
+			case '\\': g_string_append_len(out,"\\\\",2); break;
+			case '\n': g_string_append_len(out,"\\n",2); break;
+			case '\t': g_string_append_len(out,"\\t",2); break;
+			case '\r': g_string_append_len(out,"\\r",2); break;
+			case '\b': g_string_append_len(out,"\\b",2); break;
+			case '\f': g_string_append_len(out,"\\f",2); break;
+			default: g_string_append_printf(out,"\\u%04x",*c); break;
+		}
+		
+		c++;
+	}
+}
+
+/**
+	Append str as a quoted JSON string
+*/
+void lspjump_json_write_string(GString *out, const char *str)
+{
+	g_string_append_c(out,'"');
+	lspjump_json_write_escaped(out,str,strlen(str));
+	g_string_append_c(out,'"');
+}
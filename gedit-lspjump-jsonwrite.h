@@ -0,0 +1,36 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <stddef.h>
+
+G_BEGIN_DECLS
+
+/**
+	Writes a JSON string value piece by piece, the caller adds the quotes. Called
+	with the output buffer, more text may follow on the next call.
+*/
+typedef void (*LspJumpTextWriter)(GString *out, void *user_data);
+
+void lspjump_json_write_escaped(GString *out, const char *str, size_t len);
+void lspjump_json_write_string(GString *out, const char *str);
+
+G_END_DECLS
@@ -0,0 +1,375 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-mirror.h"
+
+static LspJumpMirrorLine *line_new(void)
+{
+	return calloc(1,sizeof(LspJumpMirrorLine));
+}
+
+static void line_free(gpointer data)
+{
+	LspJumpMirrorLine *self=data;
+
+	if(self->wide)
+	{
+		g_array_unref(self->wide);
+	}
+
+	free(self);
+}
+
+static LspJumpMirrorWide *line_get_wide(const LspJumpMirrorLine *self, guint index)
+{
+	return &g_array_index(self->wide,LspJumpMirrorWide,index);
+}
+
+static void line_add_wide(LspJumpMirrorLine *self, guint offset, guint bytes, guint units)
+{
+	LspJumpMirrorWide wide={.offset=offset};
+
+	if(self->wide==NULL)
+	{
+		self->wide=g_array_new(FALSE,FALSE,sizeof(LspJumpMirrorWide));
+	}
+	else if(self->wide->len>0)
+	{
+		LspJumpMirrorWide *last=line_get_wide(self,self->wide->len-1);
+		wide.extra_utf8=last->extra_utf8;
+		wide.extra_utf16=last->extra_utf16;
+	}
+
+	wide.extra_utf8+=bytes-1;
+	wide.extra_utf16+=units-1;
+
+	g_array_append_val(self->wide,wide);
+}
+
+/**
+	@return
+		how many of the non-ASCII characters of the line are before offset
+*/
+static guint line_wide_before(const LspJumpMirrorLine *self, guint offset)
+{
+	guint low=0;
+	guint high=self->wide?self->wide->len:0;
+
+	while(low<high)
+	{
+		guint middle=low+(high-low)/2;
+
+		if(line_get_wide(self,middle)->offset<offset)
+		{
+			low=middle+1;
+		}
+		else
+		{
+			high=middle;
+		}
+	}
+
+	return low;
+}
+
+/**
+	Add text without line breaks to the end of the line
+*/
+static void line_append_text(LspJumpMirrorLine *self, const char *text, const char *const end)
+{
+	while(text<end)
+	{
+		if((guchar)*text<0x80)
+		{
+			self->length++;
+			text++;
+			continue;
+		}
+
+		// Four bytes in UTF-8 is outside the BMP, a surrogate pair in UTF-16
+		guint bytes=g_utf8_skip[*(const guchar *)text];
+
+		line_add_wide(self,self->length,bytes,bytes==4?2:1);
+		self->length++;
+		text+=bytes;
+	}
+}
+
+/**
+	Add the characters from up to to of another line to the end of the line
+*/
+static void line_append_slice(LspJumpMirrorLine *self, const LspJumpMirrorLine *src, guint from, guint to)
+{
+	guint base=self->length;
+
+	for(guint i=line_wide_before(src,from);src->wide && i<src->wide->len;i++)
+	{
+		const LspJumpMirrorWide *wide=line_get_wide(src,i);
+		const LspJumpMirrorWide *previous=i>0?line_get_wide(src,i-1):NULL;
+
+		if(wide->offset>=to)
+		{
+			break;
+		}
+
+		line_add_wide(self,base+wide->offset-from,
+		              wide->extra_utf8-(previous?previous->extra_utf8:0)+1,
+		              wide->extra_utf16-(previous?previous->extra_utf16:0)+1);
+	}
+
+	self->length+=to-from;
+}
+
+/**
+	Lines end like they do in a GtkTextBuffer: at \n, \r\n or a lone \r
+
+	@param next
+		set to the start of the next line
+	@return
+		the end of the line, end if the text has no line break
+*/
+static const char *find_line_break(const char *text, const char *const end, const char **next)
+{
+	for(const char *c=text;c<end;c++)
+	{
+		if(*c=='\n')
+		{
+			*next=c+1;
+			return c;
+		}
+
+		if(*c=='\r')
+		{
+			*next=(c+1<end && c[1]=='\n')?c+2:c+1;
+			return c;
+		}
+	}
+
+	*next=end;
+	return end;
+}
+
+static GSequenceIter *get_line_iter(LspJumpMirror *self, int line)
+{
+	int count=g_sequence_get_length(self->lines);
+
+	return g_sequence_get_iter_at_pos(self->lines,CLAMP(line,0,count-1));
+}
+
+static LspJumpMirrorLine *get_line(LspJumpMirror *self, int line)
+{
+	return g_sequence_get(get_line_iter(self,line));
+}
+
+/**
+	Build the mirror from the whole text, after that it is kept up to date with
+	lspjump_mirror_insert and lspjump_mirror_delete
+
+	@param len
+		length of text in bytes, -1 if it is nul terminated
+*/
+LspJumpMirror *lspjump_mirror_new(const char *const text, gssize len)
+{
+	LspJumpMirror *self=calloc(1,sizeof(LspJumpMirror));
+	self->lines=g_sequence_new(line_free);
+
+	lspjump_mirror_set_text(self,text,len);
+
+	return self;
+}
+
+void lspjump_mirror_free(LspJumpMirror *self)
+{
+	g_sequence_free(self->lines);
+	free(self);
+}
+
+void lspjump_mirror_set_text(LspJumpMirror *self, const char *const text, gssize len)
+{
+	const char *c=text?text:"";
+	const char *end=c+(len<0?strlen(c):(size_t)len);
+
+	g_sequence_remove_range(g_sequence_get_begin_iter(self->lines),g_sequence_get_end_iter(self->lines));
+
+	for(;;)
+	{
+		const char *next;
+		const char *line_end=find_line_break(c,end,&next);
+		LspJumpMirrorLine *line=line_new();
+
+		line_append_text(line,c,line_end);
+		g_sequence_append(self->lines,line);
+
+		if(line_end==end)
+		{
+			break;
+		}
+
+		c=next;
+	}
+}
+
+/**
+	Text is inserted at a position, in characters like a GtkTextIter
+*/
+void lspjump_mirror_insert(LspJumpMirror *self, int line, int offset, const char *const text, gssize len)
+{
+	GSequenceIter *iter=get_line_iter(self,line);
+	LspJumpMirrorLine *old=g_sequence_get(iter);
+	const char *end=text+(len<0?strlen(text):(size_t)len);
+	const char *next;
+	const char *line_end=find_line_break(text,end,&next);
+
+	offset=CLAMP(offset,0,(int)old->length);
+
+	LspJumpMirrorLine *head=line_new();
+	line_append_slice(head,old,0,offset);
+	line_append_text(head,text,line_end);
+
+	if(line_end<end)
+	{
+		GSequenceIter *after=g_sequence_iter_next(iter);
+
+		for(const char *c=next;;c=next)
+		{
+			LspJumpMirrorLine *added=line_new();
+
+			line_end=find_line_break(c,end,&next);
+			line_append_text(added,c,line_end);
+
+			// The last line of the text gets what followed the insert
+			if(line_end==end)
+			{
+				line_append_slice(added,old,offset,old->length);
+				g_sequence_insert_before(after,added);
+				break;
+			}
+
+			g_sequence_insert_before(after,added);
+		}
+	}
+	else
+	{
+		line_append_slice(head,old,offset,old->length);
+	}
+
+	// Frees old
+	g_sequence_set(iter,head);
+}
+
+/**
+	The range between two positions, in characters like GtkTextIters, is removed
+*/
+void lspjump_mirror_delete(LspJumpMirror *self, int start_line, int start_offset, int end_line, int end_offset)
+{
+	GSequenceIter *first=get_line_iter(self,start_line);
+	GSequenceIter *last=get_line_iter(self,end_line);
+	LspJumpMirrorLine *first_line=g_sequence_get(first);
+	LspJumpMirrorLine *last_line=g_sequence_get(last);
+
+	LspJumpMirrorLine *joined=line_new();
+	line_append_slice(joined,first_line,0,CLAMP(start_offset,0,(int)first_line->length));
+	line_append_slice(joined,last_line,CLAMP(end_offset,0,(int)last_line->length),last_line->length);
+
+	if(first!=last)
+	{
+		g_sequence_remove_range(g_sequence_iter_next(first),g_sequence_iter_next(last));
+	}
+
+	g_sequence_set(first,joined);
+}
+
+int lspjump_mirror_get_line_count(LspJumpMirror *self)
+{
+	return g_sequence_get_length(self->lines);
+}
+
+static guint wide_extra(const LspJumpMirrorWide *wide, LspJumpPositionEncoding encoding)
+{
+	return encoding==LSPJUMP_POSITION_UTF8?wide->extra_utf8:wide->extra_utf16;
+}
+
+/**
+	@param offset
+		in characters, like gtk_text_iter_get_line_offset
+	@return
+		the same column counted in the encoding
+*/
+int lspjump_mirror_to_encoding(LspJumpMirror *self, int line, int offset, LspJumpPositionEncoding encoding)
+{
+	if(encoding==LSPJUMP_POSITION_UTF32 || offset<=0)
+	{
+		return offset;
+	}
+
+	LspJumpMirrorLine *mirror_line=get_line(self,line);
+	guint before=line_wide_before(mirror_line,offset);
+
+	return before?offset+wide_extra(line_get_wide(mirror_line,before-1),encoding):offset;
+}
+
+/**
+	@param column
+		counted in the encoding
+	@return
+		the same column in characters. A column inside a character, half of a
+		surrogate pair or a continuation byte, is the start of that character.
+*/
+int lspjump_mirror_from_encoding(LspJumpMirror *self, int line, int column, LspJumpPositionEncoding encoding)
+{
+	if(encoding==LSPJUMP_POSITION_UTF32 || column<=0)
+	{
+		return column;
+	}
+
+	LspJumpMirrorLine *mirror_line=get_line(self,line);
+	guint count=mirror_line->wide?mirror_line->wide->len:0;
+	guint low=0;
+	guint high=count;
+
+	// How many of the non-ASCII characters end at or before the column
+	while(low<high)
+	{
+		guint middle=low+(high-low)/2;
+		LspJumpMirrorWide *wide=line_get_wide(mirror_line,middle);
+
+		if(wide->offset+1+wide_extra(wide,encoding)<=(guint)column)
+		{
+			low=middle+1;
+		}
+		else
+		{
+			high=middle;
+		}
+	}
+
+	int offset=column-(low?wide_extra(line_get_wide(mirror_line,low-1),encoding):0);
+
+	if(low<count && offset>(int)line_get_wide(mirror_line,low)->offset)
+	{
+		offset=line_get_wide(mirror_line,low)->offset;
+	}
+
+	return offset;
+}
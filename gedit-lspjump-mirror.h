@@ -0,0 +1,77 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+	What the character of an LSP position counts. UTF-16 unless the server picked
+	another one from the positionEncodings the client offered.
+*/
+typedef enum LspJumpPositionEncoding
+{
+	LSPJUMP_POSITION_UTF16,
+	LSPJUMP_POSITION_UTF8,
+	LSPJUMP_POSITION_UTF32, // characters, what GtkTextIter line offsets count
+	LSPJUMP_POSITION_ENCODING_COUNT
+}LspJumpPositionEncoding;
+
+/**
+	A character that takes more than one byte in UTF-8
+*/
+typedef struct LspJumpMirrorWide
+{
+	guint offset; // in characters, within the line
+	guint extra_utf8; // bytes beyond one per character, of this one and those before it
+	guint extra_utf16; // code units beyond one per character, likewise
+}LspJumpMirrorWide;
+
+typedef struct LspJumpMirrorLine
+{
+	guint length; // characters, without the line break
+	GArray *wide; // LspJumpMirrorWide, NULL if the line is ASCII
+}LspJumpMirrorLine;
+
+/**
+	The shape of a document, without its text: a sequence of lines, each with its
+	length and where its non-ASCII characters are. Finding a line is O(log n) and
+	a column in one encoding becomes one in another with a binary search over the
+	non-ASCII characters of the line, ASCII lines need nothing at all.
+*/
+typedef struct LspJumpMirror
+{
+	GSequence *lines; // LspJumpMirrorLine
+}LspJumpMirror;
+
+LspJumpMirror *lspjump_mirror_new(const char *const text, gssize len);
+void lspjump_mirror_free(LspJumpMirror *self);
+void lspjump_mirror_set_text(LspJumpMirror *self, const char *const text, gssize len);
+void lspjump_mirror_insert(LspJumpMirror *self, int line, int offset, const char *const text, gssize len);
+void lspjump_mirror_delete(LspJumpMirror *self, int start_line, int start_offset, int end_line, int end_offset);
+int lspjump_mirror_get_line_count(LspJumpMirror *self);
+
+int lspjump_mirror_to_encoding(LspJumpMirror *self, int line, int offset, LspJumpPositionEncoding encoding);
+int lspjump_mirror_from_encoding(LspJumpMirror *self, int line, int column, LspJumpPositionEncoding encoding);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(LspJumpMirror,lspjump_mirror_free)
+
+G_END_DECLS
@@ -0,0 +1,91 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+
+#include "gedit-lspjump-mpsc.h"
+
+void lspjump_mpsc_queue_init(LspJumpMpscQueue *self)
+{
+	self->stub.next=NULL;
+	self->head=&self->stub;
+	self->tail=&self->stub;
+}
+
+/**
+	Safe from any thread. The node is visible to the consumer once the link to it is
+	stored, anything written to the node before the push is visible with it.
+*/
+void lspjump_mpsc_queue_push(LspJumpMpscQueue *self, LspJumpMpscNode *node)
+{
+	__atomic_store_n(&node->next,NULL,__ATOMIC_RELAXED);
+
+	LspJumpMpscNode *prev=__atomic_exchange_n(&self->head,node,__ATOMIC_ACQ_REL);
+
+	__atomic_store_n(&prev->next,node,__ATOMIC_RELEASE);
+}
+
+/**
+	Only from the consumer thread.
+
+	@return
+		the oldest node, or NULL if the queue is empty or a producer is half way
+		through a push. The producer makes sure the consumer runs again after that.
+*/
+LspJumpMpscNode *lspjump_mpsc_queue_pop(LspJumpMpscQueue *self)
+{
+	LspJumpMpscNode *tail=self->tail;
+	LspJumpMpscNode *next=__atomic_load_n(&tail->next,__ATOMIC_ACQUIRE);
+
+	if(tail==&self->stub)
+	{
+		if(next==NULL)
+		{
+			return NULL;
+		}
+
+		self->tail=next;
+		tail=next;
+		next=__atomic_load_n(&tail->next,__ATOMIC_ACQUIRE);
+	}
+
+	if(next)
+	{
+		self->tail=next;
+		return tail;
+	}
+
+	if(tail!=__atomic_load_n(&self->head,__ATOMIC_ACQUIRE))
+	{
+		return NULL;
+	}
+
+	// tail is the last node, the stub goes behind it so tail can be handed out
+	lspjump_mpsc_queue_push(self,&self->stub);
+
+	next=__atomic_load_n(&tail->next,__ATOMIC_ACQUIRE);
+
+	if(next)
+	{
+		self->tail=next;
+		return tail;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,47 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+	Intrusive multi producer, single consumer queue (Vyukov). Producers never
+	block or take a lock, the consumer sees the nodes in the order they were pushed.
+	Embed the node as the first member of the queued struct.
+*/
+typedef struct LspJumpMpscNode
+{
+	struct LspJumpMpscNode *next;
+}LspJumpMpscNode;
+
+typedef struct LspJumpMpscQueue
+{
+	LspJumpMpscNode *head; // last pushed, written by the producers
+	LspJumpMpscNode *tail; // next to pop, only touched by the consumer
+	LspJumpMpscNode stub;
+}LspJumpMpscQueue;
+
+void lspjump_mpsc_queue_init(LspJumpMpscQueue *self);
+void lspjump_mpsc_queue_push(LspJumpMpscQueue *self, LspJumpMpscNode *node);
+LspJumpMpscNode *lspjump_mpsc_queue_pop(LspJumpMpscQueue *self);
+
+G_END_DECLS
@@ -0,0 +1,434 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#include "gedit-lspjump-outqueue.h"
+#include "gedit-lspjump-trace.h"
+
+// Messages written by one writev, two iovecs each
+#define LSPJUMP_OUT_QUEUE_BATCH 32
+
+static void out_message_free(LspJumpOutMessage *self)
+{
+	json_decref(self->json);
+	g_free(self->document);
+	free(self->body);
+	free(self);
+}
+
+static size_t out_message_left(const LspJumpOutMessage *self)
+{
+	return self->header_len+self->body_len-self->written;
+}
+
+static void set_body(LspJumpOutQueue *queue, LspJumpOutMessage *self, char *body, size_t body_len)
+{
+	self->body=body;
+	self->body_len=body_len;
+	self->header_len=snprintf(self->header,sizeof(self->header),"Content-Length: %zu\r\n\r\n",self->body_len);
+	
+	LSPJUMP_TRACE_RECORD(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_OUT,queue->generation,self->id,self->method,body_len,g_get_monotonic_time(),0);
+	LSPJUMP_TRACE_BODY(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_OUT,body,body_len);
+}
+
+static void serialize(LspJumpOutQueue *queue, LspJumpOutMessage *self, json_t *message)
+{
+	char *body=json_dumps(message,JSON_COMPACT);
+	
+	set_body(queue,self,body,strlen(body));
+}
+
+void lspjump_out_queue_init(LspJumpOutQueue *self, size_t high_water, LspJumpOutDropFunction drop, void *drop_data)
+{
+	memset(self,0,sizeof(LspJumpOutQueue));
+	g_queue_init(&self->messages);
+	self->high_water=high_water?high_water:LSPJUMP_OUT_QUEUE_HIGH_WATER;
+	self->drop=drop;
+	self->drop_data=drop_data;
+}
+
+/**
+	Forget everything that has not been written, without calling the drop function
+*/
+void lspjump_out_queue_clear(LspJumpOutQueue *self)
+{
+	g_queue_clear_full(&self->messages,(GDestroyNotify)out_message_free);
+	self->bytes=0;
+}
+
+gboolean lspjump_out_queue_is_empty(LspJumpOutQueue *self)
+{
+	return g_queue_is_empty(&self->messages);
+}
+
+static void remove_link(LspJumpOutQueue *self, GList *link)
+{
+	LspJumpOutMessage *message=link->data;
+	
+	self->bytes-=out_message_left(message);
+	g_queue_delete_link(&self->messages,link);
+	out_message_free(message);
+}
+
+/**
+	Drop low priority messages nobody has started writing
+
+	@param method
+		only drop messages for this method, NULL for all of them
+	@param keep
+		the message that is being queued, NULL if none. Its sender does not have
+		the id yet, so it is never dropped here.
+*/
+static void drop_low_priority(LspJumpOutQueue *self, const char *const method, const LspJumpOutMessage *keep)
+{
+	GList *link=self->messages.head;
+	g_autoptr(GArray) dropped_ids=g_array_new(FALSE,FALSE,sizeof(int));
+	
+	while(link)
+	{
+		GList *next=link->next;
+		LspJumpOutMessage *message=link->data;
+		
+		if(message!=keep && message->priority==LSPJUMP_OUT_PRIORITY_LOW && message->written==0 && (method==NULL || message->method==method))
+		{
+			int id=message->id;
+			
+			remove_link(self,link);
+			self->dropped++;
+			
+			if(id>0)
+			{
+				g_array_append_val(dropped_ids,id);
+			}
+		}
+		
+		link=next;
+	}
+	
+	// Only once the walk is over, whoever gets told may queue a new message right away
+	for(guint i=0;i<dropped_ids->len && self->drop;i++)
+	{
+		self->drop(g_array_index(dropped_ids,int,i),self->drop_data);
+	}
+}
+
+static const char *get_document_uri(json_t *message)
+{
+	return json_string_value(json_object_get(json_object_get(json_object_get(message,"params"),"textDocument"),"uri"));
+}
+
+/**
+	@return
+		the didChange for document at the end of the queue, if nothing of it has been written
+*/
+static LspJumpOutMessage *get_unwritten_change(LspJumpOutQueue *self, const char *const document)
+{
+	LspJumpOutMessage *last=self->messages.tail?self->messages.tail->data:NULL;
+	
+	if(last && last->written==0 && last->method==g_intern_static_string("textDocument/didChange") && g_strcmp0(last->document,document)==0)
+	{
+		return last;
+	}
+	
+	return NULL;
+}
+
+/**
+	A didChange that has not been written yet takes the changes of the next one for
+	the same document, the server gets one notification with the latest version.
+*/
+static gboolean merge_did_change(LspJumpOutQueue *self, LspJumpOutMessage *last, json_t *message)
+{
+	// The whole text sent as it is can not be merged into
+	if(last->json==NULL)
+	{
+		return FALSE;
+	}
+	
+	json_t *params=json_object_get(message,"params");
+	json_t *last_params=json_object_get(last->json,"params");
+	json_t *changes=json_object_get(params,"contentChanges");
+	json_t *last_changes=json_object_get(last_params,"contentChanges");
+	size_t index;
+	json_t *change;
+	
+	// A change without a range is the whole text, nothing before it matters
+	json_array_foreach(changes,index,change)
+	{
+		if(!json_object_get(change,"range"))
+		{
+			json_array_clear(last_changes);
+			break;
+		}
+	}
+	
+	json_array_extend(last_changes,changes);
+	json_object_set(json_object_get(last_params,"textDocument"),"version",json_object_get(json_object_get(params,"textDocument"),"version"));
+	
+	self->bytes-=out_message_left(last);
+	free(last->body);
+	serialize(self,last,last->json);
+	self->bytes+=out_message_left(last);
+	self->merged++;
+	
+	return TRUE;
+}
+
+/**
+	Queue a message, it is serialized right away so the caller may change it afterwards.
+
+	Messages sent before the server is initialized are written ahead of the ones
+	that wait for it.
+
+	@return
+		FALSE if a low priority message was refused because the server is behind
+*/
+gboolean lspjump_out_queue_push(LspJumpOutQueue *self, json_t *message, const char *const method, int id, LspJumpOutPriority priority, gboolean before_init)
+{
+	const char *interned=g_intern_string(method);
+	
+	if(priority==LSPJUMP_OUT_PRIORITY_LOW)
+	{
+		// Whoever asked again is not interested in the old answer
+		drop_low_priority(self,interned,NULL);
+		
+		if(self->bytes>=self->high_water)
+		{
+			self->dropped++;
+			return FALSE;
+		}
+	}
+	
+	gboolean did_change=interned==g_intern_static_string("textDocument/didChange");
+	LspJumpOutMessage *last=did_change?get_unwritten_change(self,get_document_uri(message)):NULL;
+	
+	if(last && merge_did_change(self,last,message))
+	{
+		return TRUE;
+	}
+	
+	LspJumpOutMessage *out=calloc(1,sizeof(LspJumpOutMessage));
+	out->method=interned;
+	out->id=id;
+	out->priority=priority;
+	out->before_init=before_init;
+	serialize(self,out,message);
+	
+	// Only the changes are merged, and they are shared with the caller
+	if(did_change)
+	{
+		out->json=json_deep_copy(message);
+		out->document=g_strdup(get_document_uri(message));
+	}
+	
+	self->bytes+=out_message_left(out);
+	
+	if(before_init)
+	{
+		GList *link=self->messages.head;
+		
+		while(link && (((LspJumpOutMessage *)link->data)->before_init || ((LspJumpOutMessage *)link->data)->written>0))
+		{
+			link=link->next;
+		}
+		
+		g_queue_insert_before(&self->messages,link,out);
+	}
+	else
+	{
+		g_queue_push_tail(&self->messages,out);
+	}
+	
+	if(self->bytes>self->high_water)
+	{
+		drop_low_priority(self,NULL,out);
+	}
+	
+	return TRUE;
+}
+
+/**
+	Queue a notification that is already serialized, used for messages carrying
+	the whole text of a document. Takes body.
+
+	@param document
+		uri of the document for didChange, the whole text makes an unwritten
+		didChange before it pointless
+*/
+gboolean lspjump_out_queue_push_body(LspJumpOutQueue *self, char *body, size_t body_len, const char *const method, const char *const document)
+{
+	const char *interned=g_intern_string(method);
+	
+	if(document && interned==g_intern_static_string("textDocument/didChange"))
+	{
+		LspJumpOutMessage *last=get_unwritten_change(self,document);
+		
+		if(last)
+		{
+			remove_link(self,self->messages.tail);
+			self->merged++;
+		}
+	}
+	
+	LspJumpOutMessage *out=calloc(1,sizeof(LspJumpOutMessage));
+	out->method=interned;
+	out->priority=LSPJUMP_OUT_PRIORITY_NORMAL;
+	out->document=g_strdup(document);
+	set_body(self,out,body,body_len);
+	
+	self->bytes+=out_message_left(out);
+	g_queue_push_tail(&self->messages,out);
+	
+	if(self->bytes>self->high_water)
+	{
+		drop_low_priority(self,NULL,out);
+	}
+	
+	return TRUE;
+}
+
+/**
+	Take back a request that has not been written yet
+
+	@return
+		TRUE if it was removed, the server never saw it
+*/
+gboolean lspjump_out_queue_remove(LspJumpOutQueue *self, int id)
+{
+	for(GList *link=self->messages.head;link;link=link->next)
+	{
+		LspJumpOutMessage *message=link->data;
+		
+		if(message->id==id)
+		{
+			if(message->written>0)
+			{
+				return FALSE;
+			}
+			
+			remove_link(self,link);
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+/**
+	Write as much as the pipe takes, several messages per writev with headers and
+	bodies in separate buffers. A message that was only partly written continues
+	where it stopped.
+
+	@param fd
+		non blocking
+	@param initialized
+		FALSE to write only the messages queued with before_init
+*/
+LspJumpOutStatus lspjump_out_queue_write(LspJumpOutQueue *self, int fd, gboolean initialized)
+{
+	while(1)
+	{
+		struct iovec iov[LSPJUMP_OUT_QUEUE_BATCH*2];
+		int count=0;
+		
+		for(GList *link=self->messages.head;link && count<LSPJUMP_OUT_QUEUE_BATCH*2;link=link->next)
+		{
+			LspJumpOutMessage *message=link->data;
+			size_t offset=message->written;
+			
+			if(!initialized && !message->before_init)
+			{
+				break;
+			}
+			
+			if(offset<message->header_len)
+			{
+				iov[count].iov_base=message->header+offset;
+				iov[count].iov_len=message->header_len-offset;
+				count++;
+				offset=0;
+			}
+			else
+			{
+				offset-=message->header_len;
+			}
+			
+			iov[count].iov_base=message->body+offset;
+			iov[count].iov_len=message->body_len-offset;
+			count++;
+		}
+		
+		if(count==0)
+		{
+			return LSPJUMP_OUT_DONE;
+		}
+		
+		ssize_t written=writev(fd,iov,count);
+		
+		if(written<0)
+		{
+			if(errno==EINTR)
+			{
+				continue;
+			}
+			
+			return (errno==EAGAIN || errno==EWOULDBLOCK)?LSPJUMP_OUT_AGAIN:LSPJUMP_OUT_ERROR;
+		}
+		
+		size_t left=written;
+		gint64 now=self->written?g_get_monotonic_time():0;
+		
+		self->bytes_written+=written;
+		
+		while(left>0)
+		{
+			LspJumpOutMessage *message=self->messages.head->data;
+			size_t message_left=out_message_left(message);
+			
+			if(left<message_left)
+			{
+				message->written+=left;
+				self->bytes-=left;
+				break;
+			}
+			
+			left-=message_left;
+			
+			if(self->recorder)
+			{
+				lspjump_recorder_write(self->recorder,LSPJUMP_RECORD_TO_SERVER,message->body,message->body_len);
+			}
+			
+			if(message->id>0 && self->written)
+			{
+				self->written(message->id,now,self->drop_data);
+			}
+			
+			remove_link(self,self->messages.head);
+		}
+	}
+}
@@ -0,0 +1,103 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <jansson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gedit-lspjump-record.h"
+
+G_BEGIN_DECLS
+
+// Unwritten bytes above which the server is considered to be behind
+#define LSPJUMP_OUT_QUEUE_HIGH_WATER (256*1024)
+
+typedef enum LspJumpOutPriority
+{
+	LSPJUMP_OUT_PRIORITY_NORMAL=0,
+	LSPJUMP_OUT_PRIORITY_LOW=1 // dropped when superseded, or while the server is behind
+}LspJumpOutPriority;
+
+typedef enum LspJumpOutStatus
+{
+	LSPJUMP_OUT_DONE, // everything that may be written has been written
+	LSPJUMP_OUT_AGAIN, // the pipe is full, wait for it to become writable
+	LSPJUMP_OUT_ERROR // errno is set, the server will not read any more
+}LspJumpOutStatus;
+
+/**
+	Called for requests that were queued but will never be written
+*/
+typedef void (*LspJumpOutDropFunction)(int id, void *user_data);
+/**
+	Called once the last byte of a request has gone into the pipe
+*/
+typedef void (*LspJumpOutWrittenFunction)(int id, gint64 now_us, void *user_data);
+
+typedef struct LspJumpOutMessage
+{
+	char header[48];
+	size_t header_len;
+	char *body; // malloc'ed, by jansson or as a GString
+	size_t body_len;
+	size_t written; // of header and body together
+
+	json_t *json; // kept for messages that can still be merged with the next one
+	char *document; // uri of the document a didChange is for
+	const char *method; // interned
+	int id; // 0 for notifications
+	LspJumpOutPriority priority;
+	uint8_t before_init: 1;
+}LspJumpOutMessage;
+
+/**
+	Messages for the server that have not been written yet. They are written in
+	the order they were queued, the server applies changes in that order, and
+	never block: what does not fit in the pipe waits until it is writable.
+*/
+typedef struct LspJumpOutQueue
+{
+	GQueue messages; // LspJumpOutMessage
+	size_t bytes; // not written yet
+	size_t high_water;
+	LspJumpOutDropFunction drop;
+	LspJumpOutWrittenFunction written; // optional, gets drop_data too
+	void *drop_data;
+	guint generation; // of the endpoint, for trace records
+	LspJumpRecorder *recorder; // gets every message once it is written, not owned
+
+	guint64 dropped;
+	guint64 merged;
+	guint64 bytes_written;
+}LspJumpOutQueue;
+
+void lspjump_out_queue_init(LspJumpOutQueue *self, size_t high_water, LspJumpOutDropFunction drop, void *drop_data);
+void lspjump_out_queue_clear(LspJumpOutQueue *self);
+
+gboolean lspjump_out_queue_push(LspJumpOutQueue *self, json_t *message, const char *const method, int id, LspJumpOutPriority priority, gboolean before_init);
+gboolean lspjump_out_queue_push_body(LspJumpOutQueue *self, char *body, size_t body_len, const char *const method, const char *const document);
+gboolean lspjump_out_queue_remove(LspJumpOutQueue *self, int id);
+LspJumpOutStatus lspjump_out_queue_write(LspJumpOutQueue *self, int fd, gboolean initialized);
+
+gboolean lspjump_out_queue_is_empty(LspJumpOutQueue *self);
+
+G_END_DECLS
@@ -0,0 +1,228 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-perf-panel.h"
+#include "gedit-lspjump-endpoints.h"
+#include "gedit-lspjump-stats.h"
+
+enum
+{
+	COLUMN_NAME,
+	COLUMN_COUNT,
+	COLUMN_P50,
+	COLUMN_P90,
+	COLUMN_P99,
+	COLUMN_MAX,
+	NUM_COLUMNS
+};
+
+static const char *const COLUMN_TITLES[NUM_COLUMNS]={"Method","Count","p50 ms","p90 ms","p99 ms","max ms"};
+
+static GtkWidget *GLOBAL_PERF_PANEL=NULL; // only one panel is open at a time
+
+static char *format_ms(gint64 us)
+{
+	return g_strdup_printf("%.2f",us/1000.0);
+}
+
+static void set_histogram_row(GtkTreeStore *store, GtkTreeIter *iter, const char *const name, const LspJumpHistogram *histogram)
+{
+	g_autofree char *p50=format_ms(lspjump_histogram_percentile(histogram,50));
+	g_autofree char *p90=format_ms(lspjump_histogram_percentile(histogram,90));
+	g_autofree char *p99=format_ms(lspjump_histogram_percentile(histogram,99));
+	g_autofree char *max=format_ms(histogram->max);
+
+	gtk_tree_store_set(store,iter,
+		COLUMN_NAME,name,
+		COLUMN_COUNT,histogram->total,
+		COLUMN_P50,p50,
+		COLUMN_P90,p90,
+		COLUMN_P99,p99,
+		COLUMN_MAX,max,
+		-1);
+}
+
+/**
+	One row per method with the whole time, the stages below it
+*/
+static void update_methods(GtkTreeView *view)
+{
+	GtkTreeStore *store=GTK_TREE_STORE(gtk_tree_view_get_model(view));
+	g_autoptr(GPtrArray) methods=lspjump_stats_get_methods();
+
+	gtk_tree_store_clear(store);
+
+	for(guint i=0;i<methods->len;i++)
+	{
+		LspJumpMethodStats *stats=g_ptr_array_index(methods,i);
+		GtkTreeIter parent, child;
+
+		gtk_tree_store_append(store,&parent,NULL);
+		set_histogram_row(store,&parent,stats->method,&stats->stages[LSPJUMP_STAGE_TOTAL]);
+
+		for(int stage=0;stage<LSPJUMP_STAGE_TOTAL;stage++)
+		{
+			gtk_tree_store_append(store,&child,&parent);
+			set_histogram_row(store,&child,LSPJUMP_STAGE_NAMES[stage],&stats->stages[stage]);
+		}
+	}
+
+	gtk_tree_view_expand_all(view);
+}
+
+static void append_server(const char *const profile_name, JsonRpcEndpoint *endpoint, void *user_data)
+{
+	GString *text=user_data;
+	RpcStats stats;
+	long rss_kb=endpoint->closed?-1:lspjump_stats_get_rss_kb(endpoint->child_pid);
+
+	lspjump_rpc_get_stats(endpoint,&stats);
+
+	g_string_append_printf(text,"%s %s\n",profile_name,endpoint->root_uri);
+	g_string_append_printf(text,"    queued %u (%zu bytes), in flight %u, in %" G_GUINT64_FORMAT " KiB, out %" G_GUINT64_FORMAT " KiB, ",
+	                       stats.queued_messages,stats.queued_bytes,stats.in_flight,stats.bytes_in/1024,stats.bytes_out/1024);
+
+	if(rss_kb>=0)
+	{
+		g_string_append_printf(text,"RSS %.1f MiB\n",rss_kb/1024.0);
+	}
+	else
+	{
+		g_string_append(text,"not running\n");
+	}
+}
+
+static gboolean refresh_panel(gpointer data)
+{
+	GtkWidget *dialog=data;
+	GtkLabel *servers=g_object_get_data(G_OBJECT(dialog),"servers");
+	g_autoptr(GString) text=g_string_new(NULL);
+
+	lspjump_endpoints_foreach(append_server,text);
+
+	if(text->len==0)
+	{
+		g_string_append(text,"No language server is running\n");
+	}
+
+	// Without the last newline
+	g_string_truncate(text,text->len-1);
+	gtk_label_set_text(servers,text->str);
+
+	update_methods(g_object_get_data(G_OBJECT(dialog),"methods"));
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void on_panel_response(GtkDialog *dialog, gint response_id, gpointer user_data)
+{
+	if(response_id==GTK_RESPONSE_REJECT)
+	{
+		lspjump_stats_reset();
+		refresh_panel(dialog);
+	}
+	else
+	{
+		gtk_widget_destroy(GTK_WIDGET(dialog));
+	}
+}
+
+static void on_panel_destroy(GtkWidget *dialog, gpointer user_data)
+{
+	guint refresh_source=GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(dialog),"refresh_source"));
+
+	g_source_remove(refresh_source);
+	GLOBAL_PERF_PANEL=NULL;
+}
+
+/**
+	Show how long requests take, stage by stage, and what the servers are doing.
+	The panel updates itself while it is open.
+
+	@return
+		the panel, the one already open if there is one
+*/
+GtkWidget *lspjump_perf_panel_show(GtkWindow *parent)
+{
+	if(GLOBAL_PERF_PANEL)
+	{
+		gtk_window_present(GTK_WINDOW(GLOBAL_PERF_PANEL));
+		return GLOBAL_PERF_PANEL;
+	}
+
+	GtkWidget *dialog=gtk_dialog_new_with_buttons(
+		"LSP performance",
+		parent,
+		GTK_DIALOG_DESTROY_WITH_PARENT,
+		"Reset", GTK_RESPONSE_REJECT,
+		"Close", GTK_RESPONSE_CLOSE,
+		NULL);
+
+	GtkWidget *content_area=gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+
+	GtkWidget *servers=gtk_label_new(NULL);
+	gtk_label_set_selectable(GTK_LABEL(servers),TRUE);
+	gtk_label_set_xalign(GTK_LABEL(servers),0.0);
+	gtk_box_pack_start(GTK_BOX(content_area),servers,FALSE,FALSE,5);
+
+	GtkTreeStore *store=gtk_tree_store_new(NUM_COLUMNS,G_TYPE_STRING,G_TYPE_UINT64,G_TYPE_STRING,G_TYPE_STRING,G_TYPE_STRING,G_TYPE_STRING);
+	GtkWidget *methods=gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+	g_object_unref(store);
+
+	for(int i=0;i<NUM_COLUMNS;i++)
+	{
+		GtkCellRenderer *renderer=gtk_cell_renderer_text_new();
+
+		if(i!=COLUMN_NAME)
+		{
+			gtk_cell_renderer_set_alignment(renderer,1.0,0.5);
+		}
+
+		gtk_tree_view_append_column(GTK_TREE_VIEW(methods),gtk_tree_view_column_new_with_attributes(COLUMN_TITLES[i],renderer,"text",i,NULL));
+	}
+
+	GtkWidget *scrolled_window=gtk_scrolled_window_new(NULL,NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled_window),GTK_POLICY_AUTOMATIC,GTK_POLICY_AUTOMATIC);
+	gtk_widget_set_vexpand(scrolled_window,TRUE);
+	gtk_container_add(GTK_CONTAINER(scrolled_window),methods);
+	gtk_box_pack_start(GTK_BOX(content_area),scrolled_window,TRUE,TRUE,5);
+
+	g_object_set_data(G_OBJECT(dialog),"servers",servers);
+	g_object_set_data(G_OBJECT(dialog),"methods",methods);
+
+	guint refresh_source=g_timeout_add(LSPJUMP_PERF_PANEL_REFRESH_MS,refresh_panel,dialog);
+	g_object_set_data(G_OBJECT(dialog),"refresh_source",GUINT_TO_POINTER(refresh_source));
+
+	g_signal_connect(dialog,"response",G_CALLBACK(on_panel_response),NULL);
+	g_signal_connect(dialog,"destroy",G_CALLBACK(on_panel_destroy),NULL);
+
+	refresh_panel(dialog);
+
+	gtk_widget_set_size_request(dialog,700,420);
+	gtk_widget_show_all(dialog);
+
+	GLOBAL_PERF_PANEL=dialog;
+
+	return dialog;
+}
@@ -0,0 +1,287 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-prefetch.h"
+#include "gedit-lspjump-docsync.h"
+#include "gedit-lspjump-common.h"
+#include "gedit-lspjump-configuration.h"
+
+#define LSPJUMP_PREFETCH_KEY "lspjump-prefetch"
+
+static GQueue GLOBAL_PREFETCH_REQUESTS=G_QUEUE_INIT; // of every view, claimed ones included
+
+static gboolean range_equal(const LspJumpRange *a, const LspJumpRange *b)
+{
+	return a->line==b->line && a->start==b->start && a->end==b->end;
+}
+
+static void prefetch_request_free(LspJumpPrefetchRequest *request)
+{
+	g_queue_remove(&GLOBAL_PREFETCH_REQUESTS,request);
+
+	lspjump_rpc_endpoint_unref(request->endpoint);
+	g_free(request->uri);
+	free(request);
+}
+
+static void cancel_pending(LspJumpPrefetch *self)
+{
+	g_clear_handle_id(&self->delay_source,g_source_remove);
+
+	LspJumpPrefetchRequest *request=self->request;
+
+	if(request==NULL)
+	{
+		return;
+	}
+
+	self->request=NULL;
+
+	// The jump still wants it, whatever the cursor did since
+	if(request->claimed)
+	{
+		request->owner=NULL;
+		return;
+	}
+
+	lspjump_rpc_cancel(request->endpoint,request->id);
+	prefetch_request_free(request);
+}
+
+static void lspjump_rpc_prefetch_cb(JsonRpcEndpoint *endpoint, LspJumpLocations *locations, void *user_data)
+{
+	LspJumpPrefetchRequest *request=user_data;
+
+	if(request->owner)
+	{
+		request->owner->request=NULL;
+	}
+
+	// Dropped because the server is behind, the jump asks like it always did
+	if(request->claimed && locations==NULL)
+	{
+		lspjump_rpc_definition(endpoint,request->uri,request->version,&request->word,request->line,request->column,request->claimed,request->claimed_data);
+	}
+	else if(request->claimed)
+	{
+		request->claimed(endpoint,locations,request->claimed_data);
+	}
+
+	prefetch_request_free(request);
+}
+
+/**
+	Requests of a server that was shut down never get a reply, they must not hold
+	on to the budget
+*/
+static guint count_inflight(void)
+{
+	GList *link=GLOBAL_PREFETCH_REQUESTS.head;
+
+	while(link)
+	{
+		LspJumpPrefetchRequest *request=link->data;
+
+		link=link->next;
+
+		if(!lspjump_rpc_is_pending(request->endpoint,request->id))
+		{
+			if(request->owner)
+			{
+				request->owner->request=NULL;
+			}
+
+			prefetch_request_free(request);
+		}
+	}
+
+	return GLOBAL_PREFETCH_REQUESTS.length;
+}
+
+static gboolean get_word_at_cursor(GtkTextBuffer *buffer, GtkTextIter *iter, LspJumpRange *word)
+{
+	GtkTextIter start, end;
+
+	gtk_text_buffer_get_iter_at_mark(buffer,iter,gtk_text_buffer_get_insert(buffer));
+
+	if(gtk_text_buffer_get_has_selection(buffer) || !lspjump_get_identifier_bounds(iter,&start,&end))
+	{
+		return FALSE;
+	}
+
+	word->line=gtk_text_iter_get_line(&start);
+	word->start=gtk_text_iter_get_line_offset(&start);
+	word->end=gtk_text_iter_get_line_offset(&end);
+
+	return TRUE;
+}
+
+static gboolean send_prefetch(gpointer data)
+{
+	LspJumpPrefetch *self=data;
+	GeditDocument *doc=GEDIT_DOCUMENT(self->buffer);
+	GtkSourceFile *source_file=gedit_document_get_file(doc);
+	GFile *gfile=source_file?gtk_source_file_get_location(source_file):NULL;
+
+	self->delay_source=0;
+
+	GtkTextIter iter;
+	LspJumpRange word;
+
+	if(!gfile || !get_word_at_cursor(self->buffer,&iter,&word) ||
+	   count_inflight()>=(guint)lspjump_configuration_get_int("prefetch_budget",LSPJUMP_PREFETCH_DEFAULT_BUDGET))
+	{
+		return G_SOURCE_REMOVE;
+	}
+
+	JsonRpcEndpoint *endpoint=lspjump_document_sync_flush(doc);
+
+	if(endpoint==NULL)
+	{
+		return G_SOURCE_REMOVE;
+	}
+
+	LspJumpPrefetchRequest *request=calloc(1,sizeof(LspJumpPrefetchRequest));
+	request->owner=self;
+	request->uri=g_file_get_uri(gfile);
+	request->version=lspjump_document_sync_get(doc)->version;
+	request->word=word;
+	request->line=gtk_text_iter_get_line(&iter);
+	request->column=lspjump_document_sync_to_lsp_column(doc,endpoint,request->line,gtk_text_iter_get_line_offset(&iter));
+
+	request->endpoint=lspjump_rpc_endpoint_ref(endpoint);
+	self->request=request;
+	g_queue_push_tail(&GLOBAL_PREFETCH_REQUESTS,request);
+
+	int id=lspjump_rpc_definition_prefetch(endpoint,request->uri,request->version,&word,request->line,request->column,lspjump_rpc_prefetch_cb,request);
+
+	// The reply may already have come, dropped while it was being sent, and freed it
+	if(!g_queue_find(&GLOBAL_PREFETCH_REQUESTS,request))
+	{
+		return G_SOURCE_REMOVE;
+	}
+
+	if(id<=0)
+	{
+		self->request=NULL;
+		prefetch_request_free(request);
+		return G_SOURCE_REMOVE;
+	}
+
+	request->id=id;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void on_cursor_moved(GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	LspJumpPrefetch *self=user_data;
+	GtkTextIter iter;
+	LspJumpRange word;
+	gboolean on_word=get_word_at_cursor(self->buffer,&iter,&word);
+
+	// Still in the identifier that is asked for
+	if(on_word && self->request && range_equal(&word,&self->request->word))
+	{
+		return;
+	}
+
+	cancel_pending(self);
+
+	int delay=lspjump_configuration_get_int("prefetch_delay",LSPJUMP_PREFETCH_DEFAULT_DELAY_MS);
+
+	if(on_word && lspjump_configuration_get_int("prefetch_budget",LSPJUMP_PREFETCH_DEFAULT_BUDGET)>0)
+	{
+		self->delay_source=g_timeout_add(delay,send_prefetch,self);
+	}
+}
+
+static void on_buffer_changed(GtkTextBuffer *buffer, gpointer user_data)
+{
+	LspJumpPrefetch *self=user_data;
+
+	// The reply would be for a version that is gone, the cursor moves along anyway
+	cancel_pending(self);
+}
+
+static void lspjump_prefetch_free(gpointer data)
+{
+	LspJumpPrefetch *self=data;
+
+	cancel_pending(self);
+
+	g_signal_handler_disconnect(self->buffer,self->cursor_handler);
+	g_signal_handler_disconnect(self->buffer,self->changed_handler);
+	g_object_unref(self->buffer);
+
+	free(self);
+}
+
+/**
+	Prefetch the definition of the identifier under the cursor of the view
+*/
+void lspjump_prefetch_attach(GeditView *view)
+{
+	if(g_object_get_data(G_OBJECT(view),LSPJUMP_PREFETCH_KEY))
+	{
+		return;
+	}
+
+	LspJumpPrefetch *self=calloc(1,sizeof(LspJumpPrefetch));
+	self->view=view;
+
+	g_object_set_data_full(G_OBJECT(view),LSPJUMP_PREFETCH_KEY,self,lspjump_prefetch_free);
+
+	self->buffer=g_object_ref(gtk_text_view_get_buffer(GTK_TEXT_VIEW(view)));
+	self->cursor_handler=g_signal_connect(self->buffer,"notify::cursor-position",G_CALLBACK(on_cursor_moved),self);
+	self->changed_handler=g_signal_connect(self->buffer,"changed",G_CALLBACK(on_buffer_changed),self);
+}
+
+/**
+	Let a jump wait for the prefetch of the same identifier instead of asking again.
+	Finished prefetches are found in the reply cache by the jump itself.
+
+	@return
+		TRUE if action will get the reply of the prefetch
+*/
+gboolean lspjump_prefetch_claim(GeditView *view, int version, const LspJumpRange *word, LocationsActionFunction action, void *user_data)
+{
+	LspJumpPrefetch *self=g_object_get_data(G_OBJECT(view),LSPJUMP_PREFETCH_KEY);
+	LspJumpPrefetchRequest *request=self?self->request:NULL;
+
+	if(self)
+	{
+		g_clear_handle_id(&self->delay_source,g_source_remove);
+	}
+
+	if(request==NULL || request->claimed || request->version!=version || !range_equal(word,&request->word))
+	{
+		return FALSE;
+	}
+
+	request->claimed=action;
+	request->claimed_data=user_data;
+
+	return TRUE;
+}
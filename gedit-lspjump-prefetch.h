@@ -0,0 +1,72 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <gedit/gedit-view.h>
+
+#include "gedit-lspjump-cache.h"
+#include "gedit-lspjump-rpc.h"
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_PREFETCH_DEFAULT_DELAY_MS 250
+#define LSPJUMP_PREFETCH_DEFAULT_BUDGET 2 // prefetches waiting for the server at once, 0 turns them off
+
+/**
+	A prefetched definition on its way. It outlives the view it was asked from when
+	a jump waits for it.
+*/
+typedef struct LspJumpPrefetchRequest
+{
+	struct LspJumpPrefetch *owner; // NULL once the view no longer waits for it
+	JsonRpcEndpoint *endpoint;
+	int id;
+
+	char *uri;
+	int version;
+	LspJumpRange word;
+	long line;
+	long column;
+
+	LocationsActionFunction claimed; // a jump that waits for the reply, NULL if none
+	void *claimed_data;
+}LspJumpPrefetchRequest;
+
+/**
+	Prefetch state of one view. Once the cursor has rested on an identifier, its
+	definition is asked for in the background and lands in the reply cache under
+	the document version, where a jump finds it.
+*/
+typedef struct LspJumpPrefetch
+{
+	GeditView *view; // not owned, the state lives as data on the view
+	guint delay_source;
+	LspJumpPrefetchRequest *request; // waiting for its reply, NULL if none
+
+	GtkTextBuffer *buffer;
+	gulong cursor_handler;
+	gulong changed_handler;
+}LspJumpPrefetch;
+
+void lspjump_prefetch_attach(GeditView *view);
+gboolean lspjump_prefetch_claim(GeditView *view, int version, const LspJumpRange *word, LocationsActionFunction action, void *user_data);
+
+G_END_DECLS
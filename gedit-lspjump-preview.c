@@ -0,0 +1,304 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-preview.h"
+
+/**
+	Where every line of a file starts, valid while the file keeps its mtime and size
+*/
+typedef struct LspJumpPreviewIndex
+{
+	gint64 mtime;
+	goffset size;
+	GArray *starts; // guint32 byte offsets, the first is 0
+}LspJumpPreviewIndex;
+
+/**
+	The lines wanted from one file, read on a thread of the pool
+*/
+typedef struct LspJumpPreviewJob
+{
+	char *path; // NULL if the uri is not a local file
+	int *lines;
+	guint count;
+	char **previews;
+
+	GCancellable *cancellable;
+	LspJumpPreviewFunction done;
+	void *user_data;
+	GDestroyNotify destroy;
+}LspJumpPreviewJob;
+
+static GThreadPool *GLOBAL_PREVIEW_POOL=NULL;
+static GMutex GLOBAL_INDEX_LOCK;
+static GHashTable *GLOBAL_INDEXES=NULL; // path -> LspJumpPreviewIndex, under GLOBAL_INDEX_LOCK
+
+static void preview_index_free(gpointer data)
+{
+	LspJumpPreviewIndex *self=data;
+
+	g_array_unref(self->starts);
+	free(self);
+}
+
+static void preview_job_free(LspJumpPreviewJob *self)
+{
+	if(self->destroy)
+	{
+		self->destroy(self->user_data);
+	}
+
+	g_strfreev(self->previews);
+	g_clear_object(&self->cancellable);
+	g_free(self->lines);
+	g_free(self->path);
+	free(self);
+}
+
+/**
+	memchr is vectorized by the C library, far faster than looking at every byte
+*/
+static GArray *build_line_starts(const char *data, gsize size)
+{
+	GArray *starts=g_array_sized_new(FALSE,FALSE,sizeof(guint32),size/32+1);
+	const char *end=data+size;
+	const char *cursor=data;
+	guint32 start=0;
+
+	g_array_append_val(starts,start);
+
+	while(cursor<end && (cursor=memchr(cursor,'\n',end-cursor)))
+	{
+		cursor++;
+		start=cursor-data;
+		g_array_append_val(starts,start);
+	}
+
+	return starts;
+}
+
+/**
+	@return
+		a reference to the line starts of the file, from the cache if the file did
+		not change since they were found
+*/
+static GArray *get_line_starts(const char *const path, gint64 mtime, const char *data, gsize size)
+{
+	GArray *starts=NULL;
+
+	g_mutex_lock(&GLOBAL_INDEX_LOCK);
+
+	LspJumpPreviewIndex *index=GLOBAL_INDEXES?g_hash_table_lookup(GLOBAL_INDEXES,path):NULL;
+
+	if(index && index->mtime==mtime && index->size==(goffset)size)
+	{
+		starts=g_array_ref(index->starts);
+	}
+
+	g_mutex_unlock(&GLOBAL_INDEX_LOCK);
+
+	if(starts)
+	{
+		return starts;
+	}
+
+	starts=build_line_starts(data,size);
+
+	index=calloc(1,sizeof(LspJumpPreviewIndex));
+	index->mtime=mtime;
+	index->size=size;
+	index->starts=g_array_ref(starts);
+
+	g_mutex_lock(&GLOBAL_INDEX_LOCK);
+
+	if(GLOBAL_INDEXES==NULL)
+	{
+		GLOBAL_INDEXES=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,preview_index_free);
+	}
+	else if(g_hash_table_size(GLOBAL_INDEXES)>=LSPJUMP_PREVIEW_MAX_INDEXES)
+	{
+		g_hash_table_remove_all(GLOBAL_INDEXES);
+	}
+
+	g_hash_table_replace(GLOBAL_INDEXES,g_strdup(path),index);
+
+	g_mutex_unlock(&GLOBAL_INDEX_LOCK);
+
+	return starts;
+}
+
+static char *extract_line(const char *data, gsize size, GArray *starts, int line)
+{
+	if(line<0 || (guint)line>=starts->len)
+	{
+		return g_strdup("");
+	}
+
+	const char *start=data+g_array_index(starts,guint32,line);
+	const char *end=(guint)line+1<starts->len?data+g_array_index(starts,guint32,line+1):data+size;
+
+	while(start<end && g_ascii_isspace(*start))
+	{
+		start++;
+	}
+
+	while(end>start && g_ascii_isspace(end[-1]))
+	{
+		end--;
+	}
+
+	gboolean truncated=end-start>LSPJUMP_PREVIEW_MAX_BYTES;
+
+	if(truncated)
+	{
+		end=start+LSPJUMP_PREVIEW_MAX_BYTES;
+	}
+
+	g_autofree char *text=g_utf8_make_valid(start,end-start);
+	g_strdelimit(text,"\t",' ');
+
+	return truncated?g_strconcat(text,"…",NULL):g_steal_pointer(&text);
+}
+
+static void read_previews(LspJumpPreviewJob *self)
+{
+	GStatBuf info;
+
+	if(self->path==NULL || g_stat(self->path,&info)!=0 || info.st_size==0 || info.st_size>G_MAXUINT32)
+	{
+		return;
+	}
+
+	g_autoptr(GMappedFile) mapped=g_mapped_file_new(self->path,FALSE,NULL);
+
+	if(mapped==NULL)
+	{
+		return;
+	}
+
+	const char *data=g_mapped_file_get_contents(mapped);
+	gsize size=g_mapped_file_get_length(mapped);
+	gint64 mtime=(gint64)info.st_mtim.tv_sec*G_USEC_PER_SEC+info.st_mtim.tv_nsec/1000;
+
+	// Changed between the stat and the map, the index would not match what it is cached for
+	if(data==NULL || size!=(gsize)info.st_size)
+	{
+		return;
+	}
+
+	g_autoptr(GArray) starts=get_line_starts(self->path,mtime,data,size);
+
+	for(guint index=0;index<self->count;index++)
+	{
+		if(g_cancellable_is_cancelled(self->cancellable))
+		{
+			return;
+		}
+
+		g_free(self->previews[index]);
+		self->previews[index]=extract_line(data,size,starts,self->lines[index]);
+	}
+}
+
+static gboolean preview_dispatch(gpointer data)
+{
+	LspJumpPreviewJob *self=data;
+
+	if(!g_cancellable_is_cancelled(self->cancellable))
+	{
+		self->done(g_steal_pointer(&self->previews),self->user_data);
+	}
+
+	preview_job_free(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void preview_worker(gpointer data, gpointer user_data)
+{
+	LspJumpPreviewJob *self=data;
+
+	if(!g_cancellable_is_cancelled(self->cancellable))
+	{
+		read_previews(self);
+	}
+
+	g_idle_add(preview_dispatch,self);
+}
+
+/**
+	Read lines of a file on the preview threads. The file is mapped once for all of
+	the lines, and where its lines start is kept until its mtime changes.
+
+	@param lines
+		zero based, copied
+	@param cancellable
+		done is not called once it is cancelled
+	@param done
+		called in the main context
+	@param destroy
+		frees user_data once the job is over, whether done was called or not
+*/
+void lspjump_preview_lines(const char *const uri, const int *lines, guint count, GCancellable *cancellable, LspJumpPreviewFunction done, void *user_data, GDestroyNotify destroy)
+{
+	LspJumpPreviewJob *self=calloc(1,sizeof(LspJumpPreviewJob));
+
+	self->path=g_filename_from_uri(uri,NULL,NULL);
+	self->lines=g_memdup2(lines,count*sizeof(int));
+	self->count=count;
+	self->previews=g_new0(char *,count+1);
+	self->cancellable=cancellable?g_object_ref(cancellable):NULL;
+	self->done=done;
+	self->user_data=user_data;
+	self->destroy=destroy;
+
+	for(guint index=0;index<count;index++)
+	{
+		self->previews[index]=g_strdup("");
+	}
+
+	if(GLOBAL_PREVIEW_POOL==NULL)
+	{
+		GLOBAL_PREVIEW_POOL=g_thread_pool_new(preview_worker,NULL,g_get_num_processors(),FALSE,NULL);
+	}
+
+	g_thread_pool_push(GLOBAL_PREVIEW_POOL,self,NULL);
+}
+
+/**
+	Wait for the running reads and drop the cached line starts
+*/
+void lspjump_preview_shutdown(void)
+{
+	if(GLOBAL_PREVIEW_POOL)
+	{
+		g_thread_pool_free(GLOBAL_PREVIEW_POOL,FALSE,TRUE);
+		GLOBAL_PREVIEW_POOL=NULL;
+	}
+
+	g_mutex_lock(&GLOBAL_INDEX_LOCK);
+	g_clear_pointer(&GLOBAL_INDEXES,g_hash_table_unref);
+	g_mutex_unlock(&GLOBAL_INDEX_LOCK);
+}
@@ -0,0 +1,40 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_PREVIEW_MAX_BYTES 200
+#define LSPJUMP_PREVIEW_MAX_INDEXES 256
+
+/**
+	@param previews
+		the text of every requested line in order, empty if the line or the file
+		could not be read. Owned by the receiver, free with g_strfreev.
+*/
+typedef void (*LspJumpPreviewFunction)(char **previews, void *user_data);
+
+void lspjump_preview_lines(const char *const uri, const int *lines, guint count, GCancellable *cancellable, LspJumpPreviewFunction done, void *user_data, GDestroyNotify destroy);
+void lspjump_preview_shutdown(void);
+
+G_END_DECLS
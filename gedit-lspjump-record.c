@@ -0,0 +1,142 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "gedit-lspjump-record.h"
+
+#define LSPJUMP_RECORD_MAGIC "LSPJREC1"
+
+LspJumpRecorder *lspjump_recorder_open(const char *const path, GError **error)
+{
+	FILE *file=fopen(path,"wb");
+	
+	if(file==NULL)
+	{
+		int saved_errno=errno;
+		g_set_error(error,G_FILE_ERROR,g_file_error_from_errno(saved_errno),"%s: %s",path,g_strerror(saved_errno));
+		return NULL;
+	}
+	
+	fwrite(LSPJUMP_RECORD_MAGIC,1,8,file);
+	
+	LspJumpRecorder *self=calloc(1,sizeof(LspJumpRecorder));
+	self->file=file;
+	self->start_us=g_get_monotonic_time();
+	g_mutex_init(&self->lock);
+	
+	return self;
+}
+
+/**
+	Append one message, flushed right away so nothing is lost if gedit crashes
+*/
+void lspjump_recorder_write(LspJumpRecorder *self, LspJumpRecordDirection direction, const char *body, size_t len)
+{
+	guint8 direction_byte=direction;
+	gint64 time_us=GINT64_TO_LE(g_get_monotonic_time()-self->start_us);
+	guint32 length=GUINT32_TO_LE(len);
+	
+	g_mutex_lock(&self->lock);
+	
+	fwrite(&direction_byte,1,1,self->file);
+	fwrite(&time_us,sizeof(time_us),1,self->file);
+	fwrite(&length,sizeof(length),1,self->file);
+	fwrite(body,1,len,self->file);
+	fflush(self->file);
+	
+	g_mutex_unlock(&self->lock);
+}
+
+void lspjump_recorder_close(LspJumpRecorder *self)
+{
+	if(self)
+	{
+		fclose(self->file);
+		g_mutex_clear(&self->lock);
+		free(self);
+	}
+}
+
+void lspjump_record_entry_free(gpointer data)
+{
+	LspJumpRecordEntry *self=data;
+	
+	free(self->body);
+	free(self);
+}
+
+/**
+	Read a whole recording. A recording cut off in the middle of an entry, as
+	when gedit was killed, ends at the last complete entry.
+
+	@return
+		array of LspJumpRecordEntry, NULL with error set if it is not a recording
+*/
+GPtrArray *lspjump_record_load(const char *const path, GError **error)
+{
+	g_autofree char *data=NULL;
+	gsize len;
+	
+	if(!g_file_get_contents(path,&data,&len,error))
+	{
+		return NULL;
+	}
+	
+	if(len<8 || memcmp(data,LSPJUMP_RECORD_MAGIC,8)!=0)
+	{
+		g_set_error(error,G_FILE_ERROR,G_FILE_ERROR_INVAL,"%s is not a recording",path);
+		return NULL;
+	}
+	
+	GPtrArray *entries=g_ptr_array_new_with_free_func(lspjump_record_entry_free);
+	size_t pos=8;
+	
+	while(pos+13<=len)
+	{
+		gint64 time_us;
+		guint32 length;
+		
+		memcpy(&time_us,data+pos+1,sizeof(time_us));
+		memcpy(&length,data+pos+9,sizeof(length));
+		length=GUINT32_FROM_LE(length);
+		
+		if(pos+13+length>len)
+		{
+			break;
+		}
+		
+		LspJumpRecordEntry *entry=calloc(1,sizeof(LspJumpRecordEntry));
+		entry->direction=data[pos];
+		entry->time_us=GINT64_FROM_LE(time_us);
+		entry->len=length;
+		entry->body=malloc(length+1);
+		memcpy(entry->body,data+pos+13,length);
+		entry->body[length]='\0';
+		
+		g_ptr_array_add(entries,entry);
+		pos+=13+length;
+	}
+	
+	return entries;
+}
@@ -0,0 +1,68 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+typedef enum LspJumpRecordDirection
+{
+	LSPJUMP_RECORD_TO_SERVER=0,
+	LSPJUMP_RECORD_FROM_SERVER=1
+}LspJumpRecordDirection;
+
+/**
+	Saves every message body of one endpoint with the time it was sent or read.
+
+	The file starts with "LSPJREC1", then one entry per message:
+
+		guint8 direction, LspJumpRecordDirection
+		gint64 microseconds since the recording started, monotonic
+		guint32 length, then the body
+
+	Integers are little endian.
+*/
+typedef struct LspJumpRecorder
+{
+	FILE *file;
+	GMutex lock; // written from the main thread and the I/O thread
+	gint64 start_us;
+}LspJumpRecorder;
+
+typedef struct LspJumpRecordEntry
+{
+	LspJumpRecordDirection direction;
+	gint64 time_us;
+	char *body; // nul terminated
+	size_t len;
+}LspJumpRecordEntry;
+
+LspJumpRecorder *lspjump_recorder_open(const char *const path, GError **error);
+void lspjump_recorder_write(LspJumpRecorder *self, LspJumpRecordDirection direction, const char *body, size_t len);
+void lspjump_recorder_close(LspJumpRecorder *self);
+
+GPtrArray *lspjump_record_load(const char *const path, GError **error);
+void lspjump_record_entry_free(gpointer data);
+
+G_END_DECLS
@@ -0,0 +1,787 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-results.h"
+#include "gedit-lspjump-common.h"
+#include "gedit-lspjump-preview.h"
+
+#define LSPJUMP_RESULTS_KEY "lspjump-results"
+
+// Rows of a file have no item, rows of a location have its index within the file plus one
+#define ITER_GROUP(iter) GPOINTER_TO_UINT((iter)->user_data)
+#define ITER_ITEM(iter) GPOINTER_TO_UINT((iter)->user_data2)
+
+static void lspjump_results_model_tree_model_init(GtkTreeModelIface *iface);
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED(LspJumpResultsModel, lspjump_results_model, G_TYPE_OBJECT, 0,
+                               G_IMPLEMENT_INTERFACE_DYNAMIC(GTK_TYPE_TREE_MODEL, lspjump_results_model_tree_model_init))
+
+/**
+	The window of one gedit window, kept around and refilled for every search
+*/
+typedef struct LspJumpResults
+{
+	GeditWindow *window; // not owned, the results live as data on it
+	GtkWidget *dialog;
+	GtkWidget *entry;
+	GtkWidget *view;
+	LspJumpResultsModel *model; // what the view shows
+	LspJumpPositionEncoding encoding; // the server may be gone by the time of a jump
+	GCancellable *previews; // of the locations shown
+}LspJumpResults;
+
+/**
+	Previews being read for one file of a base model
+*/
+typedef struct LspJumpResultsPreview
+{
+	LspJumpResults *results; // valid until the previews are cancelled
+	LspJumpResultsModel *base;
+	guint group;
+}LspJumpResultsPreview;
+
+static void group_clear(gpointer data)
+{
+	LspJumpResultsGroup *group=data;
+
+	g_free(group->path);
+	g_free(group->path_fold);
+}
+
+static void lspjump_results_model_init(LspJumpResultsModel *self)
+{
+	self->stamp=g_random_int();
+	self->groups=g_array_new(FALSE,FALSE,sizeof(LspJumpResultsGroup));
+	g_array_set_clear_func(self->groups,group_clear);
+	self->rows=g_array_new(FALSE,FALSE,sizeof(guint));
+}
+
+static void lspjump_results_model_finalize(GObject *object)
+{
+	LspJumpResultsModel *self=LSPJUMP_RESULTS_MODEL(object);
+
+	g_array_unref(self->groups);
+	g_array_unref(self->rows);
+
+	if(self->previews)
+	{
+		for(guint index=0;index<self->locations->len;index++)
+		{
+			g_free(self->previews[index]);
+		}
+
+		g_free(self->previews);
+	}
+
+	g_free(self->filter);
+	g_clear_object(&self->base);
+	lspjump_locations_unref(self->locations);
+
+	G_OBJECT_CLASS(lspjump_results_model_parent_class)->finalize(object);
+}
+
+static void lspjump_results_model_class_init(LspJumpResultsModelClass *klass)
+{
+	GObjectClass *object_class=G_OBJECT_CLASS(klass);
+
+	object_class->finalize=lspjump_results_model_finalize;
+}
+
+static void lspjump_results_model_class_finalize(LspJumpResultsModelClass *klass)
+{
+}
+
+//////////////////////////////////
+
+static inline LspJumpResultsGroup *get_group(LspJumpResultsModel *self, guint group)
+{
+	return &g_array_index(self->groups,LspJumpResultsGroup,group);
+}
+
+static inline guint get_row(LspJumpResultsModel *self, LspJumpResultsGroup *group, guint item)
+{
+	return g_array_index(self->rows,guint,group->first+item);
+}
+
+static inline void set_iter(LspJumpResultsModel *self, GtkTreeIter *iter, guint group, guint item)
+{
+	iter->stamp=self->stamp;
+	iter->user_data=GUINT_TO_POINTER(group);
+	iter->user_data2=GUINT_TO_POINTER(item);
+	iter->user_data3=NULL;
+}
+
+static GtkTreeModelFlags model_get_flags(GtkTreeModel *model)
+{
+	// A model is never changed, filtering makes a new one
+	return GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint model_get_n_columns(GtkTreeModel *model)
+{
+	return LSPJUMP_RESULTS_NUM_COLUMNS;
+}
+
+static GType model_get_column_type(GtkTreeModel *model, gint column)
+{
+	return column==LSPJUMP_RESULTS_COLUMN_INDEX?G_TYPE_INT:G_TYPE_STRING;
+}
+
+static gboolean model_get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	LspJumpResultsModel *self=LSPJUMP_RESULTS_MODEL(model);
+	gint depth;
+	gint *indices=gtk_tree_path_get_indices_with_depth(path,&depth);
+
+	if(depth<1 || depth>2 || indices[0]<0 || (guint)indices[0]>=self->groups->len)
+	{
+		return FALSE;
+	}
+
+	if(depth==1)
+	{
+		set_iter(self,iter,indices[0],0);
+		return TRUE;
+	}
+
+	if(indices[1]<0 || (guint)indices[1]>=get_group(self,indices[0])->count)
+	{
+		return FALSE;
+	}
+
+	set_iter(self,iter,indices[0],indices[1]+1);
+	return TRUE;
+}
+
+static GtkTreePath *model_get_path(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	if(ITER_ITEM(iter)==0)
+	{
+		return gtk_tree_path_new_from_indices(ITER_GROUP(iter),-1);
+	}
+
+	return gtk_tree_path_new_from_indices(ITER_GROUP(iter),ITER_ITEM(iter)-1,-1);
+}
+
+static void model_get_value(GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value)
+{
+	LspJumpResultsModel *self=LSPJUMP_RESULTS_MODEL(model);
+	LspJumpResultsGroup *group=get_group(self,ITER_GROUP(iter));
+	guint item=ITER_ITEM(iter);
+
+	g_value_init(value,model_get_column_type(model,column));
+
+	if(column==LSPJUMP_RESULTS_COLUMN_INDEX)
+	{
+		g_value_set_int(value,item==0?-1:(gint)get_row(self,group,item-1));
+	}
+	else if(item==0)
+	{
+		g_value_take_string(value,g_strdup_printf("%s (%u)",group->path,group->count));
+	}
+	else
+	{
+		guint row=get_row(self,group,item-1);
+		const LspJumpLocation *location=&self->locations->items[row];
+		LspJumpResultsModel *base=self->base?self->base:self;
+		const char *preview=base->previews[row];
+
+		g_value_take_string(value,g_strdup_printf("%d:%d\t%s",location->line+1,location->character+1,preview?preview:""));
+	}
+}
+
+static gboolean model_iter_next(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	LspJumpResultsModel *self=LSPJUMP_RESULTS_MODEL(model);
+	guint group=ITER_GROUP(iter);
+	guint item=ITER_ITEM(iter);
+
+	if(item==0)
+	{
+		if(group+1>=self->groups->len)
+		{
+			return FALSE;
+		}
+
+		iter->user_data=GUINT_TO_POINTER(group+1);
+		return TRUE;
+	}
+
+	if(item>=get_group(self,group)->count)
+	{
+		return FALSE;
+	}
+
+	iter->user_data2=GUINT_TO_POINTER(item+1);
+	return TRUE;
+}
+
+static gint model_iter_n_children(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	LspJumpResultsModel *self=LSPJUMP_RESULTS_MODEL(model);
+
+	if(iter==NULL)
+	{
+		return self->groups->len;
+	}
+
+	return ITER_ITEM(iter)==0?get_group(self,ITER_GROUP(iter))->count:0;
+}
+
+static gboolean model_iter_nth_child(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n)
+{
+	LspJumpResultsModel *self=LSPJUMP_RESULTS_MODEL(model);
+
+	if(n<0 || n>=model_iter_n_children(model,parent))
+	{
+		return FALSE;
+	}
+
+	if(parent==NULL)
+	{
+		set_iter(self,iter,n,0);
+	}
+	else
+	{
+		set_iter(self,iter,ITER_GROUP(parent),n+1);
+	}
+
+	return TRUE;
+}
+
+static gboolean model_iter_children(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return model_iter_nth_child(model,iter,parent,0);
+}
+
+static gboolean model_iter_has_child(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return model_iter_n_children(model,iter)>0;
+}
+
+static gboolean model_iter_parent(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	if(ITER_ITEM(child)==0)
+	{
+		return FALSE;
+	}
+
+	set_iter(LSPJUMP_RESULTS_MODEL(model),iter,ITER_GROUP(child),0);
+	return TRUE;
+}
+
+static void lspjump_results_model_tree_model_init(GtkTreeModelIface *iface)
+{
+	iface->get_flags=model_get_flags;
+	iface->get_n_columns=model_get_n_columns;
+	iface->get_column_type=model_get_column_type;
+	iface->get_iter=model_get_iter;
+	iface->get_path=model_get_path;
+	iface->get_value=model_get_value;
+	iface->iter_next=model_iter_next;
+	iface->iter_children=model_iter_children;
+	iface->iter_has_child=model_iter_has_child;
+	iface->iter_n_children=model_iter_n_children;
+	iface->iter_nth_child=model_iter_nth_child;
+	iface->iter_parent=model_iter_parent;
+}
+
+//////////////////////////////////
+
+static int compare_locations(const void *a, const void *b, void *user_data)
+{
+	const LspJumpLocation *items=user_data;
+	const LspJumpLocation *first=&items[*(const guint *)a];
+	const LspJumpLocation *second=&items[*(const guint *)b];
+
+	if(first->line!=second->line)
+	{
+		return first->line<second->line?-1:1;
+	}
+
+	return (first->character>second->character)-(first->character<second->character);
+}
+
+static void append_group(LspJumpResultsModel *self, const char *const uri, const char *const path, const char *const path_fold, guint first, guint count)
+{
+	LspJumpResultsGroup group={
+		.uri=uri,
+		.path=g_strdup(path),
+		.path_fold=g_strdup(path_fold),
+		.first=first,
+		.count=count
+	};
+
+	g_array_append_val(self->groups,group);
+}
+
+/**
+	Group the locations by file, in the order the server sent the files, and sort
+	each file by position. The uris are interned so the pointer is the file.
+*/
+static void build_all(LspJumpResultsModel *self)
+{
+	LspJumpLocations *locations=self->locations;
+	g_autoptr(GHashTable) by_uri=g_hash_table_new(g_direct_hash,g_direct_equal);
+	g_autofree guint *group_of=g_new(guint,locations->len?locations->len:1);
+
+	for(guint index=0;index<locations->len;index++)
+	{
+		const char *uri=locations->items[index].uri;
+		gpointer found=g_hash_table_lookup(by_uri,uri);
+
+		if(found==NULL)
+		{
+			g_autofree char *path=g_filename_from_uri(uri,NULL,NULL);
+			const char *shown=path?path:uri;
+			g_autofree char *path_fold=g_utf8_strdown(shown,-1);
+
+			append_group(self,uri,shown,path_fold,0,0);
+			found=GUINT_TO_POINTER(self->groups->len);
+			g_hash_table_insert(by_uri,(gpointer)uri,found);
+		}
+
+		group_of[index]=GPOINTER_TO_UINT(found)-1;
+		get_group(self,group_of[index])->count++;
+	}
+
+	guint first=0;
+
+	for(guint index=0;index<self->groups->len;index++)
+	{
+		LspJumpResultsGroup *group=get_group(self,index);
+
+		group->first=first;
+		first+=group->count;
+		group->count=0;
+	}
+
+	g_array_set_size(self->rows,locations->len);
+
+	for(guint index=0;index<locations->len;index++)
+	{
+		LspJumpResultsGroup *group=get_group(self,group_of[index]);
+
+		g_array_index(self->rows,guint,group->first+group->count++)=index;
+	}
+
+	for(guint index=0;index<self->groups->len;index++)
+	{
+		LspJumpResultsGroup *group=get_group(self,index);
+
+		g_qsort_with_data(&g_array_index(self->rows,guint,group->first),group->count,sizeof(guint),compare_locations,locations->items);
+	}
+}
+
+/**
+	Keep the rows of from whose "path:line" contains the filter. Both are in the
+	same order so the grouping and sorting carry over.
+*/
+static void build_filtered(LspJumpResultsModel *self, LspJumpResultsModel *from)
+{
+	g_autoptr(GString) key=g_string_new(NULL);
+
+	for(guint index=0;index<from->groups->len;index++)
+	{
+		LspJumpResultsGroup *group=get_group(from,index);
+		gboolean whole_file=strstr(group->path_fold,self->filter)!=NULL;
+		guint first=self->rows->len;
+
+		for(guint item=0;item<group->count;item++)
+		{
+			guint row=get_row(from,group,item);
+
+			if(!whole_file)
+			{
+				g_string_printf(key,"%s:%d",group->path_fold,self->locations->items[row].line+1);
+
+				if(strstr(key->str,self->filter)==NULL)
+				{
+					continue;
+				}
+			}
+
+			g_array_append_val(self->rows,row);
+		}
+
+		if(self->rows->len>first)
+		{
+			append_group(self,group->uri,group->path,group->path_fold,first,self->rows->len-first);
+		}
+	}
+}
+
+LspJumpResultsModel *lspjump_results_model_new(LspJumpLocations *locations)
+{
+	LspJumpResultsModel *self=g_object_new(LSPJUMP_TYPE_RESULTS_MODEL,NULL);
+
+	self->locations=lspjump_locations_ref(locations);
+	self->previews=g_new0(char *,locations->len);
+	build_all(self);
+
+	return self;
+}
+
+/**
+	@param filter
+		matched without case against "path:line" of every location, NULL or empty
+		for all of them
+	@return
+		a new reference to a model with the matching locations. Narrowing the
+		previous filter only looks at what from has left.
+*/
+LspJumpResultsModel *lspjump_results_model_filter(LspJumpResultsModel *from, const char *const filter)
+{
+	LspJumpResultsModel *base=from->base?from->base:from;
+
+	if(filter==NULL || filter[0]=='\0')
+	{
+		return g_object_ref(base);
+	}
+
+	g_autofree char *filter_fold=g_utf8_strdown(filter,-1);
+
+	if(g_strcmp0(filter_fold,from->filter)==0)
+	{
+		return g_object_ref(from);
+	}
+
+	LspJumpResultsModel *self=g_object_new(LSPJUMP_TYPE_RESULTS_MODEL,NULL);
+
+	self->locations=lspjump_locations_ref(base->locations);
+	self->base=g_object_ref(base);
+	self->filter=g_steal_pointer(&filter_fold);
+
+	build_filtered(self,(from->filter && g_str_has_prefix(self->filter,from->filter))?from:base);
+
+	return self;
+}
+
+void lspjump_results_register_types(GTypeModule *module)
+{
+	lspjump_results_model_register_type(module);
+}
+
+//////////////////////////////////
+
+static void set_model(LspJumpResults *self, LspJumpResultsModel *model)
+{
+	GtkTreeView *view=GTK_TREE_VIEW(self->view);
+
+	g_set_object(&self->model,model);
+	gtk_tree_view_set_model(view,GTK_TREE_MODEL(model));
+	gtk_tree_view_expand_all(view);
+
+	if(model->groups->len>0)
+	{
+		g_autoptr(GtkTreePath) path=gtk_tree_path_new_from_indices(0,0,-1);
+
+		gtk_tree_view_set_cursor(view,path,NULL,FALSE);
+	}
+
+	g_autofree char *title=g_strdup_printf("Locations (%u)",model->rows->len);
+	gtk_window_set_title(GTK_WINDOW(self->dialog),title);
+}
+
+static void on_previews_read(char **previews, void *user_data)
+{
+	LspJumpResultsPreview *preview=user_data;
+	LspJumpResultsModel *base=preview->base;
+	LspJumpResultsGroup *group=get_group(base,preview->group);
+
+	for(guint item=0;item<group->count;item++)
+	{
+		guint row=get_row(base,group,item);
+
+		g_free(base->previews[row]);
+		base->previews[row]=g_steal_pointer(&previews[item]);
+	}
+
+	g_free(previews);
+
+	// The file may be filtered down or out in what is shown
+	LspJumpResultsModel *model=preview->results->model;
+
+	if(model==NULL || (model!=base && model->base!=base))
+	{
+		return;
+	}
+
+	for(guint index=0;index<model->groups->len;index++)
+	{
+		LspJumpResultsGroup *shown=get_group(model,index);
+
+		if(shown->uri!=group->uri)
+		{
+			continue;
+		}
+
+		for(guint item=0;item<shown->count;item++)
+		{
+			g_autoptr(GtkTreePath) path=gtk_tree_path_new_from_indices(index,item,-1);
+			GtkTreeIter iter;
+
+			set_iter(model,&iter,index,item+1);
+			gtk_tree_model_row_changed(GTK_TREE_MODEL(model),path,&iter);
+		}
+
+		break;
+	}
+}
+
+static void results_preview_free(gpointer data)
+{
+	LspJumpResultsPreview *self=data;
+
+	g_object_unref(self->base);
+	free(self);
+}
+
+/**
+	Read the lines of the locations, file by file in the order they are shown
+*/
+static void read_previews(LspJumpResults *self, LspJumpResultsModel *base)
+{
+	if(self->previews)
+	{
+		g_cancellable_cancel(self->previews);
+		g_clear_object(&self->previews);
+	}
+
+	self->previews=g_cancellable_new();
+
+	g_autoptr(GArray) lines=g_array_new(FALSE,FALSE,sizeof(int));
+
+	for(guint index=0;index<base->groups->len;index++)
+	{
+		LspJumpResultsGroup *group=get_group(base,index);
+		LspJumpResultsPreview *preview=calloc(1,sizeof(LspJumpResultsPreview));
+
+		preview->results=self;
+		preview->base=g_object_ref(base);
+		preview->group=index;
+
+		g_array_set_size(lines,group->count);
+
+		for(guint item=0;item<group->count;item++)
+		{
+			g_array_index(lines,int,item)=base->locations->items[get_row(base,group,item)].line;
+		}
+
+		lspjump_preview_lines(group->uri,(const int *)lines->data,lines->len,self->previews,on_previews_read,preview,results_preview_free);
+	}
+}
+
+static void jump_to_path(LspJumpResults *self, GtkTreePath *path)
+{
+	GtkTreeModel *model=GTK_TREE_MODEL(self->model);
+	GtkTreeIter iter;
+
+	if(!gtk_tree_model_get_iter(model,&iter,path))
+	{
+		return;
+	}
+
+	gint index;
+	gtk_tree_model_get(model,&iter,LSPJUMP_RESULTS_COLUMN_INDEX,&index,-1);
+
+	if(index<0)
+	{
+		if(gtk_tree_view_row_expanded(GTK_TREE_VIEW(self->view),path))
+		{
+			gtk_tree_view_collapse_row(GTK_TREE_VIEW(self->view),path);
+		}
+		else
+		{
+			gtk_tree_view_expand_row(GTK_TREE_VIEW(self->view),path,FALSE);
+		}
+
+		return;
+	}
+
+	const LspJumpLocation *location=&self->model->locations->items[index];
+	g_autoptr(GFile) gfile=g_file_new_for_uri(location->uri);
+
+	gedit_lspjump_goto_lsp_position_and_track(self->window,gfile,location->line,location->character,self->encoding);
+}
+
+static void on_row_activated(GtkTreeView *view, GtkTreePath *path, GtkTreeViewColumn *column, gpointer user_data)
+{
+	jump_to_path(user_data,path);
+}
+
+static void on_search_changed(GtkSearchEntry *entry, gpointer user_data)
+{
+	LspJumpResults *self=user_data;
+	g_autoptr(LspJumpResultsModel) model=lspjump_results_model_filter(self->model,gtk_entry_get_text(GTK_ENTRY(entry)));
+
+	if(model!=self->model)
+	{
+		set_model(self,model);
+	}
+}
+
+static void on_search_activate(GtkEntry *entry, gpointer user_data)
+{
+	LspJumpResults *self=user_data;
+	g_autoptr(GtkTreePath) path=NULL;
+
+	gtk_tree_view_get_cursor(GTK_TREE_VIEW(self->view),&path,NULL);
+
+	if(path)
+	{
+		jump_to_path(self,path);
+	}
+}
+
+static void on_stop_search(GtkSearchEntry *entry, gpointer user_data)
+{
+	LspJumpResults *self=user_data;
+
+	gtk_widget_hide(self->dialog);
+}
+
+static gboolean on_entry_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+{
+	LspJumpResults *self=user_data;
+
+	if(event->keyval==GDK_KEY_Down || event->keyval==GDK_KEY_KP_Down)
+	{
+		gtk_widget_grab_focus(self->view);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean on_dialog_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+{
+	if(event->keyval==GDK_KEY_Escape)
+	{
+		gtk_widget_hide(widget);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void lspjump_results_free(gpointer data)
+{
+	LspJumpResults *self=data;
+
+	if(self->previews)
+	{
+		g_cancellable_cancel(self->previews);
+		g_object_unref(self->previews);
+	}
+
+	if(self->dialog)
+	{
+		g_object_remove_weak_pointer(G_OBJECT(self->dialog),(gpointer *)&self->dialog);
+		gtk_widget_destroy(self->dialog);
+	}
+
+	g_clear_object(&self->model);
+	free(self);
+}
+
+static LspJumpResults *get_results(GeditWindow *window)
+{
+	LspJumpResults *self=g_object_get_data(G_OBJECT(window),LSPJUMP_RESULTS_KEY);
+
+	if(self)
+	{
+		return self;
+	}
+
+	self=calloc(1,sizeof(LspJumpResults));
+	self->window=window;
+
+	self->dialog=gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	g_object_add_weak_pointer(G_OBJECT(self->dialog),(gpointer *)&self->dialog);
+	gtk_window_set_transient_for(GTK_WINDOW(self->dialog),GTK_WINDOW(window));
+	gtk_window_set_destroy_with_parent(GTK_WINDOW(self->dialog),TRUE);
+	gtk_window_set_default_size(GTK_WINDOW(self->dialog),600,400);
+	g_signal_connect(self->dialog,"delete-event",G_CALLBACK(gtk_widget_hide_on_delete),NULL);
+	g_signal_connect(self->dialog,"key-press-event",G_CALLBACK(on_dialog_key_press),NULL);
+
+	GtkWidget *vbox=gtk_box_new(GTK_ORIENTATION_VERTICAL,4);
+	gtk_container_set_border_width(GTK_CONTAINER(vbox),8);
+	gtk_container_add(GTK_CONTAINER(self->dialog),vbox);
+
+	self->entry=gtk_search_entry_new();
+	gtk_entry_set_placeholder_text(GTK_ENTRY(self->entry),"Filter by path:line");
+	g_signal_connect(self->entry,"search-changed",G_CALLBACK(on_search_changed),self);
+	g_signal_connect(self->entry,"activate",G_CALLBACK(on_search_activate),self);
+	g_signal_connect(self->entry,"stop-search",G_CALLBACK(on_stop_search),self);
+	g_signal_connect(self->entry,"key-press-event",G_CALLBACK(on_entry_key_press),self);
+	gtk_box_pack_start(GTK_BOX(vbox),self->entry,FALSE,FALSE,0);
+
+	// Fixed heights let the view lay out only the rows it draws
+	self->view=gtk_tree_view_new();
+	gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(self->view),FALSE);
+	gtk_tree_view_set_enable_search(GTK_TREE_VIEW(self->view),FALSE);
+	gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(self->view),TRUE);
+
+	GtkCellRenderer *renderer=gtk_cell_renderer_text_new();
+	g_object_set(renderer,"ellipsize",PANGO_ELLIPSIZE_MIDDLE,NULL);
+	GtkTreeViewColumn *column=gtk_tree_view_column_new_with_attributes("Location",renderer,"text",LSPJUMP_RESULTS_COLUMN_TEXT,NULL);
+	gtk_tree_view_column_set_sizing(column,GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_expand(column,TRUE);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(self->view),column);
+	g_signal_connect(self->view,"row-activated",G_CALLBACK(on_row_activated),self);
+
+	GtkWidget *scrolled=gtk_scrolled_window_new(NULL,NULL);
+	gtk_widget_set_vexpand(scrolled,TRUE);
+	gtk_container_add(GTK_CONTAINER(scrolled),self->view);
+	gtk_box_pack_start(GTK_BOX(vbox),scrolled,TRUE,TRUE,0);
+
+	gtk_widget_show_all(vbox);
+
+	g_object_set_data_full(G_OBJECT(window),LSPJUMP_RESULTS_KEY,self,lspjump_results_free);
+
+	return self;
+}
+
+/**
+	Show locations in the results window of the gedit window, replacing what it
+	showed before. A jump leaves the window open for the next one.
+*/
+void lspjump_results_show(GeditWindow *window, LspJumpLocations *locations, LspJumpPositionEncoding encoding)
+{
+	LspJumpResults *self=get_results(window);
+	g_autoptr(LspJumpResultsModel) model=lspjump_results_model_new(locations);
+
+	self->encoding=encoding;
+
+	g_signal_handlers_block_by_func(self->entry,on_search_changed,self);
+	gtk_entry_set_text(GTK_ENTRY(self->entry),"");
+	g_signal_handlers_unblock_by_func(self->entry,on_search_changed,self);
+
+	set_model(self,model);
+	read_previews(self,model);
+
+	gtk_window_present(GTK_WINDOW(self->dialog));
+	gtk_widget_grab_focus(self->entry);
+}
@@ -0,0 +1,89 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <gtk/gtk.h>
+#include <gedit/gedit-window.h>
+
+#include "gedit-lspjump-jsonpull.h"
+#include "gedit-lspjump-mirror.h"
+
+G_BEGIN_DECLS
+
+#define LSPJUMP_TYPE_RESULTS_MODEL        (lspjump_results_model_get_type())
+#define LSPJUMP_RESULTS_MODEL(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), LSPJUMP_TYPE_RESULTS_MODEL, LspJumpResultsModel))
+#define LSPJUMP_IS_RESULTS_MODEL(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), LSPJUMP_TYPE_RESULTS_MODEL))
+
+enum
+{
+	LSPJUMP_RESULTS_COLUMN_TEXT,
+	LSPJUMP_RESULTS_COLUMN_INDEX, // of the location, -1 on the row of a file
+	LSPJUMP_RESULTS_NUM_COLUMNS
+};
+
+/**
+	The locations of one file, a slice of the rows of the model
+*/
+typedef struct LspJumpResultsGroup
+{
+	const char *uri; // interned in the locations
+	char *path;
+	char *path_fold; // lower case, for filtering
+	guint first;
+	guint count;
+}LspJumpResultsGroup;
+
+typedef struct _LspJumpResultsModel      LspJumpResultsModel;
+typedef struct _LspJumpResultsModelClass LspJumpResultsModelClass;
+
+/**
+	A GtkTreeModel straight over LspJumpLocations: one row per file with its
+	locations below it. Nothing is stored per row but an index, the text of a row
+	is only made when the view draws it. Filtering makes a new model.
+*/
+struct _LspJumpResultsModel
+{
+	GObject parent;
+
+	gint stamp;
+	LspJumpLocations *locations;
+	LspJumpResultsModel *base; // the unfiltered model, NULL if this is it
+	char *filter; // lower case, NULL for every location
+	GArray *groups; // LspJumpResultsGroup
+	GArray *rows; // guint index into locations, grouped by file and sorted by line
+	char **previews; // the line of every location, NULL until it is read. Only on the base model.
+};
+
+struct _LspJumpResultsModelClass
+{
+	GObjectClass parent_class;
+};
+
+GType lspjump_results_model_get_type(void) G_GNUC_CONST;
+void lspjump_results_register_types(GTypeModule *module);
+
+LspJumpResultsModel *lspjump_results_model_new(LspJumpLocations *locations);
+LspJumpResultsModel *lspjump_results_model_filter(LspJumpResultsModel *from, const char *const filter);
+
+void lspjump_results_show(GeditWindow *window, LspJumpLocations *locations, LspJumpPositionEncoding encoding);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(LspJumpResultsModel,g_object_unref)
+
+G_END_DECLS
@@ -0,0 +1,479 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <gio/gio.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-roots.h"
+
+typedef struct RootWaiter
+{
+	LspJumpRootFunction done;
+	void *user_data;
+}RootWaiter;
+
+/**
+	One walk up the tree. Every marker of a level is queried at once, the walk only
+	goes on to the parent once all of them have answered.
+*/
+typedef struct RootSearch
+{
+	char *key; // key of the directory the walk started in
+	char *markers_key;
+	GStrv markers;
+	GFile *current;
+	GPtrArray *visited; // uris of the directories checked so far
+	guint pending; // marker queries of the current level still running
+	uint8_t found: 1;
+	uint8_t outdated: 1; // a directory it checked has changed since, it does not fill the cache
+	guint generation;
+	GArray *waiters; // RootWaiter
+}RootSearch;
+
+/**
+	A root that was found. A stale one is still handed out while it is searched
+	for again, so documents stay on their server in the meantime.
+*/
+typedef struct RootEntry
+{
+	char *root_uri; // "" if there is none
+	uint8_t stale: 1;
+}RootEntry;
+
+typedef struct LspJumpRoots
+{
+	GHashTable *cache; // markers "\n" directory uri -> RootEntry
+	GHashTable *searches; // key of the start directory -> RootSearch
+	GHashTable *monitors; // directory uri -> GFileMonitor
+	GHashTable *marker_names; // every marker looked for, for the monitors
+	guint generation; // bumped on every clear, older searches do not fill the cache
+}LspJumpRoots;
+
+static LspJumpRoots GLOBAL_ROOTS;
+
+static void monitor_free(gpointer data)
+{
+	GFileMonitor *monitor=data;
+
+	g_signal_handlers_disconnect_matched(monitor,G_SIGNAL_MATCH_DATA,0,0,NULL,NULL,&GLOBAL_ROOTS);
+	g_file_monitor_cancel(monitor);
+	g_object_unref(monitor);
+}
+
+static void root_entry_free(gpointer data)
+{
+	RootEntry *self=data;
+
+	g_free(self->root_uri);
+	free(self);
+}
+
+static void init_roots(void)
+{
+	if(GLOBAL_ROOTS.cache)
+	{
+		return;
+	}
+
+	GLOBAL_ROOTS.cache=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,root_entry_free);
+	GLOBAL_ROOTS.searches=g_hash_table_new(g_str_hash,g_str_equal);
+	GLOBAL_ROOTS.monitors=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,monitor_free);
+	GLOBAL_ROOTS.marker_names=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+}
+
+/**
+	Split a lsp_search value, "compile_commands.json, .git", into its markers
+
+	@return
+		the markers, with the same text for the same set written differently
+*/
+static GStrv parse_markers(const char *const markers, char **markers_key)
+{
+	g_auto(GStrv) list=g_strsplit(markers?markers:"",",",-1);
+	GPtrArray *parsed=g_ptr_array_new();
+
+	for(int i=0;list[i];i++)
+	{
+		g_strstrip(list[i]);
+
+		if(*list[i])
+		{
+			g_ptr_array_add(parsed,g_strdup(list[i]));
+		}
+	}
+
+	g_ptr_array_add(parsed,NULL);
+
+	GStrv result=(GStrv)g_ptr_array_free(parsed,FALSE);
+	*markers_key=g_strjoinv(",",result);
+
+	return result;
+}
+
+static char *make_key(const char *const markers_key, GFile *dir)
+{
+	g_autofree char *uri=g_file_get_uri(dir);
+
+	return g_strconcat(markers_key,"\n",uri,NULL);
+}
+
+/**
+	A marker came or went in a directory. The roots of the directory and of the
+	directories below it may have changed, the roots elsewhere have not.
+*/
+static void invalidate_directory(const char *const dir_uri)
+{
+	g_autofree char *prefix=g_str_has_suffix(dir_uri,"/")?g_strdup(dir_uri):g_strconcat(dir_uri,"/",NULL);
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init(&iter,GLOBAL_ROOTS.cache);
+
+	while(g_hash_table_iter_next(&iter,&key,&value))
+	{
+		const char *uri=strchr(key,'\n')+1;
+
+		if(strcmp(uri,dir_uri)==0 || g_str_has_prefix(uri,prefix))
+		{
+			((RootEntry *)value)->stale=1;
+		}
+	}
+
+	g_hash_table_iter_init(&iter,GLOBAL_ROOTS.searches);
+
+	while(g_hash_table_iter_next(&iter,&key,&value))
+	{
+		RootSearch *search=value;
+
+		for(guint i=0;i<search->visited->len;i++)
+		{
+			if(strcmp(g_ptr_array_index(search->visited,i),dir_uri)==0)
+			{
+				search->outdated=1;
+				break;
+			}
+		}
+	}
+}
+
+static void on_directory_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event_type, gpointer user_data)
+{
+	switch(event_type)
+	{
+		case G_FILE_MONITOR_EVENT_CREATED:
+		case G_FILE_MONITOR_EVENT_DELETED:
+		case G_FILE_MONITOR_EVENT_MOVED_IN:
+		case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		case G_FILE_MONITOR_EVENT_RENAMED:
+			break;
+		default:
+			return;
+	}
+
+	g_autofree char *name=g_file_get_basename(file);
+	g_autofree char *other_name=other_file?g_file_get_basename(other_file):NULL;
+
+	if(!g_hash_table_contains(GLOBAL_ROOTS.marker_names,name) &&
+	   !(other_name && g_hash_table_contains(GLOBAL_ROOTS.marker_names,other_name)))
+	{
+		return;
+	}
+
+	g_autoptr(GFile) dir=g_file_get_parent(file);
+
+	if(dir)
+	{
+		g_autofree char *dir_uri=g_file_get_uri(dir);
+		invalidate_directory(dir_uri);
+	}
+}
+
+static void watch_directory(GFile *dir, const char *const uri)
+{
+	if(g_hash_table_contains(GLOBAL_ROOTS.monitors,uri))
+	{
+		return;
+	}
+
+	GFileMonitor *monitor=g_file_monitor_directory(dir,G_FILE_MONITOR_WATCH_MOVES,NULL,NULL);
+
+	if(monitor==NULL)
+	{
+		return;
+	}
+
+	g_signal_connect(monitor,"changed",G_CALLBACK(on_directory_changed),&GLOBAL_ROOTS);
+	g_hash_table_insert(GLOBAL_ROOTS.monitors,g_strdup(uri),monitor);
+}
+
+static void root_search_free(RootSearch *self)
+{
+	g_free(self->key);
+	g_free(self->markers_key);
+	g_strfreev(self->markers);
+	g_clear_object(&self->current);
+	g_ptr_array_unref(self->visited);
+	g_array_unref(self->waiters);
+	free(self);
+}
+
+/**
+	Remember the root for every directory the walk went through and tell everyone
+	waiting for it
+
+	@param root_uri
+		NULL if no parent has any of the markers
+*/
+static void finish_search(RootSearch *self, const char *const root_uri)
+{
+	// An outdated walk leaves the stale entries, the next lookup walks again
+	if(self->generation==GLOBAL_ROOTS.generation && !self->outdated)
+	{
+		for(guint i=0;i<self->visited->len;i++)
+		{
+			RootEntry *entry=calloc(1,sizeof(RootEntry));
+			entry->root_uri=g_strdup(root_uri?root_uri:"");
+
+			char *key=g_strconcat(self->markers_key,"\n",g_ptr_array_index(self->visited,i),NULL);
+			g_hash_table_replace(GLOBAL_ROOTS.cache,key,entry);
+		}
+	}
+
+	g_hash_table_remove(GLOBAL_ROOTS.searches,self->key);
+
+	g_autoptr(GFile) root=root_uri?g_file_new_for_uri(root_uri):NULL;
+
+	for(guint i=0;i<self->waiters->len;i++)
+	{
+		RootWaiter *waiter=&g_array_index(self->waiters,RootWaiter,i);
+		waiter->done(root,waiter->user_data);
+	}
+
+	root_search_free(self);
+}
+
+static void check_level(RootSearch *self);
+
+static void on_marker_queried(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	RootSearch *self=user_data;
+	g_autoptr(GFileInfo) info=g_file_query_info_finish(G_FILE(source),result,NULL);
+
+	if(info)
+	{
+		self->found=1;
+	}
+
+	if(--self->pending>0)
+	{
+		return;
+	}
+
+	if(self->found)
+	{
+		g_autofree char *root_uri=g_file_get_uri(self->current);
+		finish_search(self,root_uri);
+		return;
+	}
+
+	GFile *parent=g_file_get_parent(self->current);
+
+	if(parent==NULL)
+	{
+		finish_search(self,NULL);
+		return;
+	}
+
+	g_object_unref(self->current);
+	self->current=parent;
+
+	check_level(self);
+}
+
+static void check_level(RootSearch *self)
+{
+	g_autofree char *uri=g_file_get_uri(self->current);
+	g_autofree char *key=g_strconcat(self->markers_key,"\n",uri,NULL);
+	RootEntry *cached=g_hash_table_lookup(GLOBAL_ROOTS.cache,key);
+
+	// Another walk has already been here, since the last change
+	if(cached && !cached->stale)
+	{
+		finish_search(self,*cached->root_uri?cached->root_uri:NULL);
+		return;
+	}
+
+	watch_directory(self->current,uri);
+	g_ptr_array_add(self->visited,g_steal_pointer(&uri));
+
+	self->found=0;
+	self->pending=g_strv_length(self->markers);
+
+	for(int i=0;self->markers[i];i++)
+	{
+		g_autoptr(GFile) candidate=g_file_get_child(self->current,self->markers[i]);
+		g_file_query_info_async(candidate,G_FILE_ATTRIBUTE_STANDARD_TYPE,G_FILE_QUERY_INFO_NONE,G_PRIORITY_DEFAULT,NULL,on_marker_queried,self);
+	}
+}
+
+/**
+	Start a walk from dir, or join the one already going
+
+	@param waiter
+		NULL for a walk that only refreshes the cache
+*/
+static void start_search(GFile *dir, const char *const markers, const RootWaiter *waiter)
+{
+	g_autofree char *markers_key=NULL;
+	GStrv list=parse_markers(markers,&markers_key);
+	g_autofree char *key=make_key(markers_key,dir);
+	RootSearch *self=g_hash_table_lookup(GLOBAL_ROOTS.searches,key);
+
+	// The same directory is already being searched for, wait for that walk
+	if(self)
+	{
+		if(waiter)
+		{
+			g_array_append_val(self->waiters,*waiter);
+		}
+
+		g_strfreev(list);
+		return;
+	}
+
+	if(list[0]==NULL)
+	{
+		g_strfreev(list);
+
+		if(waiter)
+		{
+			waiter->done(NULL,waiter->user_data);
+		}
+
+		return;
+	}
+
+	for(int i=0;list[i];i++)
+	{
+		g_hash_table_add(GLOBAL_ROOTS.marker_names,g_strdup(list[i]));
+	}
+
+	self=calloc(1,sizeof(RootSearch));
+	self->key=g_steal_pointer(&key);
+	self->markers_key=g_steal_pointer(&markers_key);
+	self->markers=list;
+	self->current=g_object_ref(dir);
+	self->visited=g_ptr_array_new_with_free_func(g_free);
+	self->generation=GLOBAL_ROOTS.generation;
+	self->waiters=g_array_new(FALSE,FALSE,sizeof(RootWaiter));
+
+	if(waiter)
+	{
+		g_array_append_val(self->waiters,*waiter);
+	}
+
+	g_hash_table_insert(GLOBAL_ROOTS.searches,self->key,self);
+
+	check_level(self);
+}
+
+static RootEntry *lookup_entry(GFile *dir, const char *const markers)
+{
+	init_roots();
+
+	g_autofree char *markers_key=NULL;
+	g_auto(GStrv) list=parse_markers(markers,&markers_key);
+	g_autofree char *key=make_key(markers_key,dir);
+
+	return g_hash_table_lookup(GLOBAL_ROOTS.cache,key);
+}
+
+/**
+	Look the root up in the cache only, never waiting for the disk. A root that may
+	have changed is still returned, and searched for again in the background.
+
+	@param markers
+		comma separated file names, as in lsp_search
+	@param root
+		set to a new reference to the root, or NULL if the directory has been
+		searched and none of its parents has a marker
+	@return
+		TRUE if the directory has been searched before
+*/
+gboolean lspjump_roots_lookup(GFile *dir, const char *const markers, GFile **root)
+{
+	RootEntry *entry=lookup_entry(dir,markers);
+
+	if(entry==NULL)
+	{
+		return FALSE;
+	}
+
+	*root=*entry->root_uri?g_file_new_for_uri(entry->root_uri):NULL;
+
+	if(entry->stale)
+	{
+		start_search(dir,markers,NULL);
+	}
+
+	return TRUE;
+}
+
+/**
+	Find the closest directory, dir itself or one of its parents, that contains any
+	of the markers. The disk is only read asynchronously and every directory passed
+	on the way is remembered, so siblings and subdirectories are answered from memory.
+
+	@param markers
+		comma separated file names, as in lsp_search
+	@param done
+		called with the root, right away if it is known and has not changed since
+*/
+void lspjump_roots_resolve(GFile *dir, const char *const markers, LspJumpRootFunction done, void *user_data)
+{
+	RootEntry *entry=lookup_entry(dir,markers);
+
+	if(entry && !entry->stale)
+	{
+		g_autoptr(GFile) root=*entry->root_uri?g_file_new_for_uri(entry->root_uri):NULL;
+
+		done(root,user_data);
+		return;
+	}
+
+	RootWaiter waiter={.done=done,.user_data=user_data};
+
+	start_search(dir,markers,&waiter);
+}
+
+/**
+	Forget every root found so far, walks still running do not fill the cache
+*/
+void lspjump_roots_clear(void)
+{
+	init_roots();
+
+	g_hash_table_remove_all(GLOBAL_ROOTS.cache);
+	g_hash_table_remove_all(GLOBAL_ROOTS.monitors);
+	GLOBAL_ROOTS.generation++;
+}
@@ -0,0 +1,41 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+// Used when a profile has no lsp_search of its own
+#define LSPJUMP_ROOTS_DEFAULT_MARKERS "compile_commands.json"
+
+/**
+	@param root
+		the closest directory with one of the markers, NULL if there is none.
+		Not owned, ref it to keep it.
+*/
+typedef void (*LspJumpRootFunction)(GFile *root, void *user_data);
+
+gboolean lspjump_roots_lookup(GFile *dir, const char *const markers, GFile **root);
+void lspjump_roots_resolve(GFile *dir, const char *const markers, LspJumpRootFunction done, void *user_data);
+void lspjump_roots_clear(void);
+
+G_END_DECLS
@@ -23,55 +23,207 @@ freely, subject to the following restrictions:
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 #include "gedit-lspjump-rpc.h"
-#include "gedit-lspjump-common.h"
+#include "gedit-lspjump-trace.h"
+#include "gedit-lspjump-stats.h"
+#include "gedit-lspjump-timeline.h"
 
 int GLOBAL_RPC_ID=1;
+static guint GLOBAL_ENDPOINT_GENERATION=0;
 
-static JsonRpcEndpoint *GLOBAL_ENDPOINT=NULL;
+static GHashTable *GLOBAL_ENDPOINTS=NULL; // generation -> JsonRpcEndpoint, not owned
 
-static void send_request(JsonRpcEndpoint *endpoint, const char *message)
+static gboolean write_stdin(GIOChannel *source, GIOCondition condition, gpointer data);
+static void on_child_exit(GPid pid, gint status, gpointer user_data);
+
+/**
+	Write what the pipe takes of the outgoing queue, the rest is written from a
+	G_IO_OUT watch once the server has read some of it. Never blocks.
+*/
+static LspJumpOutStatus flush_outgoing(JsonRpcEndpoint *endpoint)
 {
-	g_autoptr(GError) error = NULL;
-	gsize bytes_written;
-	g_io_channel_write_chars(endpoint->stdin_channel, message, -1, &bytes_written, &error);
-	g_io_channel_flush(endpoint->stdin_channel, &error);
-	if (error)
+	if(endpoint->stdin_channel==NULL)
+	{
+		return LSPJUMP_OUT_DONE;
+	}
+	
+	LspJumpOutStatus status=lspjump_out_queue_write(&endpoint->outgoing,g_io_channel_unix_get_fd(endpoint->stdin_channel),endpoint->initialized);
+	
+	if(status==LSPJUMP_OUT_AGAIN)
+	{
+		if(endpoint->stdin_source==0)
+		{
+			endpoint->stdin_source=g_io_add_watch(endpoint->stdin_channel,G_IO_OUT|G_IO_ERR|G_IO_HUP,write_stdin,endpoint);
+		}
+		
+		return status;
+	}
+	
+	if(status==LSPJUMP_OUT_ERROR)
+	{
+		g_printerr("Error writing to child: %s\n", g_strerror(errno));
+		lspjump_out_queue_clear(&endpoint->outgoing);
+	}
+	
+	// Servers that wait for end of input exit once stdin is closed
+	if(endpoint->close_stdin && lspjump_out_queue_is_empty(&endpoint->outgoing))
+	{
+		g_clear_handle_id(&endpoint->stdin_source,g_source_remove);
+		g_clear_pointer(&endpoint->stdin_channel,g_io_channel_unref);
+	}
+	
+	return status;
+}
+
+static gboolean write_stdin(GIOChannel *source, GIOCondition condition, gpointer data)
+{
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
+	
+	if(endpoint->stdin_channel && flush_outgoing(endpoint)==LSPJUMP_OUT_AGAIN)
 	{
-		g_printerr("Error writing to child: %s\n", error->message);
+		return G_SOURCE_CONTINUE;
 	}
+	
+	endpoint->stdin_source=0;
+	
+	return G_SOURCE_REMOVE;
+}
+
+static void rpc_id_action_free(gpointer data)
+{
+	RpcIdAction *self=data;
+	g_free(self->method);
+	g_free(self->cache_uri);
+	json_decref(self->cached_reply);
+	lspjump_locations_unref(self->cached_locations);
+	free(self);
 }
 
-int store_rpc_action(JsonRpcEndpoint *endpoint, IdActionFunction action, void *user_data)
+static gboolean sweep_rpc_actions(gpointer data);
+
+/**
+	Replies to these are lists of locations, the I/O thread pulls them out of the
+	text without building a JSON tree when the request asked for locations
+*/
+static const char *const LOCATIONS_METHODS[]=
+{
+	"textDocument/definition",
+	"textDocument/declaration",
+	"textDocument/typeDefinition",
+	"textDocument/implementation",
+	"textDocument/references",
+	"workspace/symbol",
+};
+
+static const char *get_locations_method(const char *const method_name)
 {
-	for(int i=0;i<GEDIT_RPC_ID_ACTIONS_LEN;i++)
+	for(size_t i=0;i<G_N_ELEMENTS(LOCATIONS_METHODS);i++)
 	{
-		if(endpoint->id_actions[i].active==0)
+		if(strcmp(LOCATIONS_METHODS[i],method_name)==0)
 		{
-			endpoint->id_actions[i].id=GLOBAL_RPC_ID;
-			endpoint->id_actions[i].action=action;
-			endpoint->id_actions[i].user_data=user_data;
-			endpoint->id_actions[i].active=1;
-			
-			return GLOBAL_RPC_ID;
+			return LOCATIONS_METHODS[i];
 		}
 	}
 	
-	return -1;
+	return NULL;
+}
+
+static void remember_method(JsonRpcEndpoint *endpoint, int id, const char *const method_name)
+{
+	g_mutex_lock(&endpoint->methods_lock);
+	g_hash_table_insert(endpoint->pending_methods,GINT_TO_POINTER(id),(gpointer)method_name);
+	g_mutex_unlock(&endpoint->methods_lock);
+}
+
+/**
+	@return
+		the method the request was sent with if its reply should be pulled, NULL otherwise
+*/
+static const char *take_method(JsonRpcEndpoint *endpoint, int id)
+{
+	gpointer method_name=NULL;
+	
+	g_mutex_lock(&endpoint->methods_lock);
+	g_hash_table_steal_extended(endpoint->pending_methods,GINT_TO_POINTER(id),NULL,&method_name);
+	g_mutex_unlock(&endpoint->methods_lock);
+	
+	return method_name;
+}
+
+/**
+	Register a callback for the reply to a request that is about to be sent.
+
+	@param timeout_ms
+		how long to wait for the reply before the request is cancelled and the
+		action gets NULL, 0 for GEDIT_RPC_REQUEST_TIMEOUT_MS
+	@return
+		the id the request should be sent with
+*/
+int store_rpc_action(JsonRpcEndpoint *endpoint, const char *const method_name, IdActionFunction action, void *user_data, guint timeout_ms)
+{
+	RpcIdAction *id_action=calloc(1,sizeof(RpcIdAction));
+	id_action->id=GLOBAL_RPC_ID++;
+	id_action->method=g_strdup(method_name);
+	id_action->action=action;
+	id_action->user_data=user_data;
+	id_action->enqueued_us=g_get_monotonic_time();
+	id_action->deadline=id_action->enqueued_us+(gint64)(timeout_ms?timeout_ms:GEDIT_RPC_REQUEST_TIMEOUT_MS)*1000;
+	
+	g_hash_table_insert(endpoint->id_actions,GINT_TO_POINTER(id_action->id),id_action);
+	
+	if(endpoint->sweep_source==0)
+	{
+		endpoint->sweep_source=g_timeout_add(GEDIT_RPC_SWEEP_INTERVAL_MS,sweep_rpc_actions,endpoint);
+	}
+	
+	return id_action->id;
+}
+
+/**
+	Requests nobody waits for once a newer one has been asked, they are the first
+	to go when the server does not keep up
+*/
+static const char *const LOW_PRIORITY_METHODS[]=
+{
+	"textDocument/hover",
+};
+
+static LspJumpOutPriority get_priority(const char *const method_name)
+{
+	for(size_t i=0;i<G_N_ELEMENTS(LOW_PRIORITY_METHODS);i++)
+	{
+		if(strcmp(LOW_PRIORITY_METHODS[i],method_name)==0)
+		{
+			return LSPJUMP_OUT_PRIORITY_LOW;
+		}
+	}
+	
+	return LSPJUMP_OUT_PRIORITY_NORMAL;
 }
 
 /**
+	Messages other than initialize are held back until the server has answered it,
+	so a server that was just spawned can be used right away.
+	
+	Nothing is written here directly, messages go through the outgoing queue.
+
 	@param id
 		id>=0 send that id
 		id==-1 send with next id
 		id==-2 send with no id, needed for initialized
+	@return
+		the id, -1 if a low priority request was refused because the server is behind
 */
-int send_rpc_message(JsonRpcEndpoint *endpoint, const char *const method_name, json_t *params, long id)
+static int send_rpc_message_with_priority(JsonRpcEndpoint *endpoint, const char *const method_name, json_t *params, long id, LspJumpOutPriority priority)
 {
 	long use_id=-3;
+	gint64 timeline_start=LSPJUMP_TIMELINE_START();
 
 	g_autoptr(json_t) root = json_pack("{s:s, s:s}",
 		"jsonrpc", "2.0",
@@ -93,369 +245,1428 @@ int send_rpc_message(JsonRpcEndpoint *endpoint, const char *const method_name, j
 		json_object_set_new(root, "id", json_integer(use_id));
 	}
 	
-	g_autofree char *json_str = json_dumps(root, JSON_COMPACT);
+	endpoint->last_used=g_get_monotonic_time();
+	
+	if(endpoint->closed || endpoint->stdin_channel==NULL || endpoint->close_stdin)
+	{
+		return use_id;
+	}
 	
-	fprintf(stdout,"%s:%d SEND RPC STRING: [%s]\n",__FILE__,__LINE__,json_str);
+	gboolean before_init=strcmp(method_name,"initialize")==0 || strcmp(method_name,"initialized")==0;
 	
-	g_autofree char *send_msg=NULL;
+	if(!lspjump_out_queue_push(&endpoint->outgoing,root,method_name,use_id>0?use_id:0,priority,before_init))
+	{
+		return -1;
+	}
 	
-	asprintf(&send_msg,"Content-Length: %ld\r\n\r\n%s",strlen(json_str),json_str);
+	flush_outgoing(endpoint);
 	
-	send_request(endpoint, send_msg);
+	LSPJUMP_TIMELINE_SPAN("rpc",method_name,timeline_start,use_id>0?use_id:0,LSPJUMP_FLOW_START);
 	
 	return use_id;
 }
 
-static gboolean read_stdout(GIOChannel *source, GIOCondition condition, gpointer data)
+int send_rpc_message(JsonRpcEndpoint *endpoint, const char *const method_name, json_t *params, long id)
 {
-	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
-	g_autoptr(GError) error = NULL;
-	gchar buffer[4096];
-	gsize bytes_read=0;
-
-	if (condition & G_IO_HUP) {
-		g_print("Child process closed stdout.\n");
-		return FALSE;
-	}
-
-	while (g_io_channel_read_chars(endpoint->stdout_channel, buffer, sizeof(buffer) - 1, &bytes_read, &error) == G_IO_STATUS_NORMAL && bytes_read > 0) {
-		buffer[bytes_read] = '\0';
-		g_string_append(endpoint->read_buffer, buffer);
-
-		// Look for complete LSP messages
-		while (1) {
-			// Look for Content-Length header
-			char *header_end = strstr(endpoint->read_buffer->str, "\r\n\r\n");
-			if (!header_end)
-				break;
-
-			size_t header_len = header_end - endpoint->read_buffer->str + 4;
-			char *content_length_str = g_strstr_len(endpoint->read_buffer->str, header_len, "Content-Length:");
-
-			if (!content_length_str)
-				break;
-
-			int content_length = 0;
-			sscanf(content_length_str, "Content-Length: %d", &content_length);
-
-			if (endpoint->read_buffer->len < header_len + content_length)
-				break; // not enough data yet
-
-			// Extract JSON message
-			char *json_start = endpoint->read_buffer->str + header_len;
-			g_autofree char *json_chunk = g_strndup(json_start, content_length);
-
-			// Parse JSON
-			json_error_t jerr;
-			g_autoptr(json_t) json = json_loads(json_chunk, 0, &jerr);
+	return send_rpc_message_with_priority(endpoint,method_name,params,id,get_priority(method_name));
+}
 
-			if (json)
-			{
-				// Print parsed result (or handle LSP responses)
-				g_autofree gchar *formatted = json_dumps(json, JSON_INDENT(2));
-				g_print("Parsed JSON:\n%s\n", formatted);
-
-				// Check for "id":0 which is response to initialize
-				json_t *id = json_object_get(json, "id");
-				json_int_t id_val=json_integer_value(id);
-				if (id && json_is_integer(id))
-				{
-					for(int i=0;i<GEDIT_RPC_ID_ACTIONS_LEN;i++)
-					{
-						if(endpoint->id_actions[i].active && endpoint->id_actions[i].id==id_val)
-						{
-							endpoint->id_actions[i].action(endpoint,json,endpoint->id_actions[i].user_data);
-						
-							endpoint->id_actions[i].id=0;
-							endpoint->id_actions[i].action=NULL;
-							endpoint->id_actions[i].user_data=NULL;
-							endpoint->id_actions[i].active=0;
-							
-							break;
-						}
-					}
-				}
-			}
-			else {
-				g_printerr("JSON parse error: %s at line %d\n", jerr.text, jerr.line);
-			}
+/**
+	A message read by the I/O thread, parsed there and handed to the main thread
+*/
+typedef struct RpcMessage
+{
+	LspJumpMpscNode node;
+	json_t *json; // NULL when the server closed its stdout, or if locations is set
+	LspJumpLocations *locations; // a reply that was pulled without jansson
+	int id;
+	gint64 first_byte_us; // when the first byte of the message was read
+	gint64 parsed_us;
+}RpcMessage;
 
-			// Remove the processed message
-			g_string_erase(endpoint->read_buffer, 0, header_len + content_length);
+/**
+	Hand the reply to the action that waits for it, in the form it asked for
+*/
+static void run_action(JsonRpcEndpoint *endpoint, RpcIdAction *id_action, json_t *json, LspJumpLocations *locations)
+{
+	gboolean error=json && json_object_get(json,"error");
+	g_autoptr(LspJumpLocations) converted=NULL;
+	
+	if(id_action->locations_action && !locations && !error)
+	{
+		locations=converted=lspjump_locations_from_json(json_object_get(json,"result"));
+	}
+	
+	if(id_action->cache_uri && !error)
+	{
+		if(locations)
+		{
+			lspjump_cache_store_locations(id_action->cache_uri,id_action->cache_version,id_action->method,&id_action->cache_range,locations);
+		}
+		else if(json && !id_action->locations_action)
+		{
+			lspjump_cache_store(id_action->cache_uri,id_action->cache_version,id_action->method,&id_action->cache_range,json);
 		}
 	}
-
-	return TRUE;
-}
-
-
-static gboolean read_stderr(GIOChannel *source, GIOCondition condition, gpointer data) {
-	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
-	gchar *message = NULL;
-	gsize len;
-	g_autoptr(GError) error = NULL;
-
-	if (condition & G_IO_HUP) {
-		g_print("Child process closed stderr.\n");
-		return FALSE;
+	
+	gint64 timeline_start=LSPJUMP_TIMELINE_START();
+	
+	if(id_action->locations_action)
+	{
+		id_action->locations_action(endpoint,locations,id_action->user_data);
 	}
-
-	if (g_io_channel_read_line(endpoint->stderr_channel, &message, &len, NULL, &error) == G_IO_STATUS_NORMAL) {
-		g_print("ERR:: %s", message);
-		g_free(message);
+	else if(id_action->action)
+	{
+		id_action->action(endpoint,json,id_action->user_data);
 	}
-
-	return TRUE;
+	
+	LSPJUMP_TIMELINE_SPAN("ui",id_action->method,timeline_start,id_action->id,LSPJUMP_FLOW_END);
 }
 
-static void spawn_child(JsonRpcEndpoint *endpoint, const gchar *program, gchar **args) {
-	g_autoptr(GError) error = NULL;
-	gint stdin_fd, stdout_fd, stderr_fd;
-
-	if (!g_spawn_async_with_pipes(NULL, args, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &endpoint->child_pid, &stdin_fd, &stdout_fd, &stderr_fd, &error)) {
-		g_printerr("Failed to spawn process: %s\n", error->message);
-		g_error_free(error);
-		return;
-	}
-	
-	endpoint->read_buffer = g_string_new(NULL);
+static void record_times(RpcIdAction *id_action, RpcMessage *message)
+{
+	LspJumpRequestTimes times={
+		.enqueued_us=id_action->enqueued_us,
+		.written_us=id_action->written_us,
+		.first_byte_us=message->first_byte_us,
+		.parsed_us=message->parsed_us,
+		.done_us=g_get_monotonic_time()
+	};
 	
-	endpoint->stdin_channel = g_io_channel_unix_new(stdin_fd);
-	g_io_channel_set_flags(endpoint->stdin_channel, G_IO_FLAG_NONBLOCK, NULL);
-	endpoint->stdout_channel = g_io_channel_unix_new(stdout_fd);
-//	g_io_channel_set_encoding(endpoint->stdout_channel, NULL, NULL);
-	g_io_channel_set_flags(endpoint->stdout_channel, G_IO_FLAG_NONBLOCK, NULL);
-//	g_io_channel_set_buffered(endpoint->stdout_channel, FALSE);
-	endpoint->stderr_channel = g_io_channel_unix_new(stderr_fd);
-	g_io_channel_set_flags(endpoint->stderr_channel, G_IO_FLAG_NONBLOCK, NULL);
-
-	g_io_add_watch(endpoint->stdout_channel, G_IO_IN | G_IO_HUP, read_stdout, endpoint);
-	g_io_add_watch(endpoint->stderr_channel, G_IO_IN | G_IO_HUP, read_stderr, endpoint);
+	lspjump_stats_record_request(id_action->method,&times);
 }
 
-const char *LOGIN_STR="{"
-"	\"textDocument\": {\"codeAction\": {\"dynamicRegistration\": true},"
-"	\"codeLens\": {\"dynamicRegistration\": true},"
-"	\"colorProvider\": {\"dynamicRegistration\": true},"
-"	\"completion\": {\"completionItem\": {\"commitCharactersSupport\": true,\"documentationFormat\": [\"markdown\", \"plaintext\"],\"snippetSupport\": true},"
-"	\"completionItemKind\": {\"valueSet\": [1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25]},"
-"	\"contextSupport\": true,"
-"	\"dynamicRegistration\": true},"
-"	\"definition\": {\"dynamicRegistration\": true},"
-"	\"documentHighlight\": {\"dynamicRegistration\": true},"
-"	\"documentLink\": {\"dynamicRegistration\": true},"
-"	\"documentSymbol\": {\"dynamicRegistration\": true,"
-"	\"symbolKind\": {\"valueSet\": [1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26]}},"
-"	\"formatting\": {\"dynamicRegistration\": true},"
-"	\"hover\": {\"contentFormat\": [\"markdown\", \"plaintext\"],"
-"	\"dynamicRegistration\": true},"
-"	\"implementation\": {\"dynamicRegistration\": true},"
-"	\"onTypeFormatting\": {\"dynamicRegistration\": true},"
-"	\"publishDiagnostics\": {\"relatedInformation\": true},"
-"	\"rangeFormatting\": {\"dynamicRegistration\": true},"
-"	\"references\": {\"dynamicRegistration\": true},"
-"	\"rename\": {\"dynamicRegistration\": true},"
-"	\"signatureHelp\": {\"dynamicRegistration\": true,"
-"	\"signatureInformation\": {\"documentationFormat\": [\"markdown\", \"plaintext\"]}},"
-"	\"synchronization\": {\"didSave\": true,"
-"	\"dynamicRegistration\": true,"
-"	\"willSave\": true,"
-"	\"willSaveWaitUntil\": true},"
-"	\"typeDefinition\": {\"dynamicRegistration\": true}},"
-"	\"workspace\": {\"applyEdit\": true,"
-"	\"configuration\": true,"
-"	\"didChangeConfiguration\": {\"dynamicRegistration\": true},"
-"	\"didChangeWatchedFiles\": {\"dynamicRegistration\": true},"
-"	\"executeCommand\": {\"dynamicRegistration\": true},"
-"	\"symbol\": {\"dynamicRegistration\": true,"
-"	\"symbolKind\": {\"valueSet\": [1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26]}},\"workspaceEdit\": {\"documentChanges\": true},"
-"	\"workspaceFolders\": true}"
-"}";
-
-static void init_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+static void dispatch_locations(JsonRpcEndpoint *endpoint, RpcMessage *message)
 {
-	g_print("Initialize response received\n");
-
-	// Send "initialized"
-	send_rpc_message(endpoint, "initialized", NULL, -2);
+	gpointer key=GINT_TO_POINTER(message->id);
+	RpcIdAction *id_action=g_hash_table_lookup(endpoint->id_actions,key);
 	
-	endpoint->initialized=1;
+	// Cancelled or timed out while it was on its way
+	if(id_action)
+	{
+		g_hash_table_steal(endpoint->id_actions,key);
+		run_action(endpoint,id_action,NULL,message->locations);
+		record_times(id_action,message);
+		rpc_id_action_free(id_action);
+	}
 }
 
-int initialize(JsonRpcEndpoint *endpoint,const char *const root_path, const char *const root_uri, json_t *initialization_options,
-               json_t *capabilities, const char *const trace, json_t *workspace_folders)
+static void dispatch_message(JsonRpcEndpoint *endpoint, RpcMessage *message)
 {
-//	pid_t process_id = getpid();
-	pid_t process_id = endpoint->child_pid;
-	
-	g_autoptr(json_t) params = json_pack("{s:i, s:s, s:O, s:s, s:O}",
-		"processId",process_id,
-		"rootUri",root_uri,
-		"capabilities",capabilities,
-		"trace",trace,
-		"workspaceFolders",workspace_folders
-	);
-	
-	if(root_path)
+	// Requests from the server also carry an id, only replies are looked up
+	json_t *id = json_object_get(message->json, "id");
+	if (id && json_is_integer(id) && !json_object_get(message->json, "method"))
 	{
-		json_object_set_new(params, "rootPath", json_string(root_path));
+		gpointer key=GINT_TO_POINTER((int)json_integer_value(id));
+		RpcIdAction *id_action=g_hash_table_lookup(endpoint->id_actions,key);
+		
+		if(id_action)
+		{
+			// The action may send new requests, take it out of the table first
+			g_hash_table_steal(endpoint->id_actions,key);
+			run_action(endpoint,id_action,message->json,NULL);
+			record_times(id_action,message);
+			rpc_id_action_free(id_action);
+		}
 	}
+}
+
+static void request_written(int id, gint64 now_us, void *user_data)
+{
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)user_data;
+	RpcIdAction *id_action=g_hash_table_lookup(endpoint->id_actions,GINT_TO_POINTER(id));
 	
-	if(initialization_options)
+	if(id_action)
 	{
-		json_object_set_new(params, "initializationOptions", initialization_options);
+		id_action->written_us=now_us;
 	}
+}
+
+/**
+	A low priority request was dropped from the outgoing queue before the server saw
+	it, the action gets NULL so whoever waits for it can ask again
+*/
+static void drop_request(int id, void *user_data)
+{
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)user_data;
+	gpointer key=GINT_TO_POINTER(id);
+	RpcIdAction *id_action=g_hash_table_lookup(endpoint->id_actions,key);
 	
-	int send_id=store_rpc_action(endpoint,init_cb,NULL);
+	if(id_action)
+	{
+		g_hash_table_steal(endpoint->id_actions,key);
+		take_method(endpoint,id);
+		run_action(endpoint,id_action,NULL,NULL);
+		rpc_id_action_free(id_action);
+	}
+}
+
+/**
+	@return
+		TRUE while the action of the request can still be called. Requests of a
+		server that is shut down are forgotten without calling it.
+*/
+gboolean lspjump_rpc_is_pending(JsonRpcEndpoint *endpoint, int id)
+{
+	return endpoint && g_hash_table_contains(endpoint->id_actions,GINT_TO_POINTER(id));
+}
+
+static void send_cancel_request(JsonRpcEndpoint *endpoint, int id)
+{
+	g_autoptr(json_t) params = json_pack("{s:i}", "id", id);
 	
-	send_rpc_message(endpoint,"initialize",params,send_id);
+	send_rpc_message(endpoint,"$/cancelRequest",params,-2);
 }
 
-int lspjump_rpc_did_open(const char *const uri_path, const char *const file_contents)
+/**
+	Cancel a request that is still waiting for its reply. Its action will not be called.
+	
+	@return
+		0 if the request was pending, 1 otherwise
+*/
+int lspjump_rpc_cancel(JsonRpcEndpoint *endpoint, int id)
 {
-	JsonRpcEndpoint *endpoint=GLOBAL_ENDPOINT;
+	RpcIdAction *id_action=endpoint?g_hash_table_lookup(endpoint->id_actions,GINT_TO_POINTER(id)):NULL;
 	
-	if(endpoint)
+	if(id_action)
 	{
-		g_autoptr(json_t) params = json_pack("{s:{s:s, s:s, s:i, s:s}}",
-			"textDocument",
-			"uri", uri_path,
-			"languageId", "c",
-			"version", 1,
-			"text", file_contents
-		);
+		// Cached replies never went to the server, queued ones can still be taken back
+		if(!id_action->cached_reply && !id_action->cached_locations && !lspjump_out_queue_remove(&endpoint->outgoing,id))
+		{
+			send_cancel_request(endpoint,id);
+		}
 		
-		send_rpc_message(endpoint,"textDocument/didOpen",params,-2);
+		take_method(endpoint,id);
+		g_hash_table_remove(endpoint->id_actions,GINT_TO_POINTER(id));
+		endpoint->stats.cancelled++;
 		
 		return 0;
 	}
+	
 	return 1;
 }
 
-int lspjump_rpc_definition(const char *const file_path, const char *const file_contents, long doc_line, long doc_offset,
-                           IdActionFunction action, void *user_data)
+static gboolean sweep_rpc_actions(gpointer data)
 {
-	JsonRpcEndpoint *endpoint=GLOBAL_ENDPOINT;
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
+	gint64 now=g_get_monotonic_time();
 	
-	if(endpoint)
+	GHashTableIter iter;
+	gpointer key, value;
+	g_autoptr(GArray) expired=g_array_new(FALSE,FALSE,sizeof(int));
+	
+	// The actions may drop the last other reference
+	lspjump_rpc_endpoint_ref(endpoint);
+	
+	g_hash_table_iter_init(&iter,endpoint->id_actions);
+	
+	while(g_hash_table_iter_next(&iter,&key,&value))
 	{
-		g_autofree char *uri_path=NULL;
-		asprintf(&uri_path,"file://%s",file_path);
-		
-		lspjump_rpc_did_open(uri_path,file_contents);
+		RpcIdAction *id_action=value;
 		
-		g_autoptr(json_t) params2 = json_pack("{s:{s:s},s:{s:i,s:i}}",
-			"textDocument",
-			"uri", uri_path,
-			"position",
-			"line",doc_line,
-			"character",doc_offset
-		);
+		if(id_action->deadline<=now)
+		{
+			g_array_append_val(expired,id_action->id);
+		}
+	}
+	
+	// Sending the cancel can drop queued requests, which takes them out of id_actions
+	for(guint i=0;i<expired->len;i++)
+	{
+		int id=g_array_index(expired,int,i);
+		RpcIdAction *id_action=g_hash_table_lookup(endpoint->id_actions,GINT_TO_POINTER(id));
+		
+		if(!id_action)
+		{
+			continue;
+		}
+		
+		g_printerr("Request %d (%s) timed out\n",id_action->id,id_action->method);
+		
+		if(!lspjump_out_queue_remove(&endpoint->outgoing,id))
+		{
+			send_cancel_request(endpoint,id);
+		}
+		
+		take_method(endpoint,id);
+		g_hash_table_steal(endpoint->id_actions,GINT_TO_POINTER(id));
+		endpoint->stats.timed_out++;
+		
+		// Like a dropped request, whoever waits for it stops waiting
+		run_action(endpoint,id_action,NULL,NULL);
+		rpc_id_action_free(id_action);
+	}
+	
+	gboolean keep=g_hash_table_size(endpoint->id_actions)>0;
+	
+	if(!keep)
+	{
+		endpoint->sweep_source=0;
+	}
+	
+	lspjump_rpc_endpoint_unref(endpoint);
+	
+	return keep?G_SOURCE_CONTINUE:G_SOURCE_REMOVE;
+}
+
+/**
+	Counters for the requests of a server
+	
+	@return
+		0 on success, 1 if there is no server
+*/
+int lspjump_rpc_get_stats(JsonRpcEndpoint *endpoint, RpcStats *stats)
+{
+	if(endpoint)
+	{
+		*stats=endpoint->stats;
+		stats->in_flight=g_hash_table_size(endpoint->id_actions);
+		stats->dropped=endpoint->outgoing.dropped;
+		stats->merged=endpoint->outgoing.merged;
+		stats->queued_bytes=endpoint->outgoing.bytes;
+		stats->queued_messages=g_queue_get_length(&endpoint->outgoing.messages);
+		stats->bytes_out=endpoint->outgoing.bytes_written;
+		stats->bytes_in=(gsize)g_atomic_pointer_get(&endpoint->bytes_in);
+		
+		return 0;
+	}
+	
+	memset(stats,0,sizeof(RpcStats));
+	
+	return 1;
+}
+
+static gboolean deliver_incoming(gpointer data)
+{
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
+	RpcMessage *message;
+	
+	// Cleared first, anything pushed from here on schedules another round
+	g_atomic_int_set(&endpoint->wake_pending,0);
+	
+	while((message=(RpcMessage *)lspjump_mpsc_queue_pop(&endpoint->incoming)))
+	{
+		if(message->json || message->locations)
+		{
+			gint64 start=g_get_monotonic_time();
+			
+			if(message->locations)
+			{
+				dispatch_locations(endpoint,message);
+			}
+			else
+			{
+				dispatch_message(endpoint,message);
+			}
+			
+			gint64 spent=g_get_monotonic_time()-start;
+			
+			LSPJUMP_TRACE_RECORD(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_DISPATCH,endpoint->generation,
+			                     message->locations?message->id:json_integer_value(json_object_get(message->json,"id")),
+			                     message->json?json_string_value(json_object_get(message->json,"method")):NULL,0,start,start+spent);
+			
+			endpoint->stats.received++;
+			endpoint->stats.dispatch_total_us+=spent;
+			endpoint->stats.dispatch_max_us=MAX(endpoint->stats.dispatch_max_us,spent);
+			
+			json_decref(message->json);
+			lspjump_locations_unref(message->locations);
+		}
+		else
+		{
+			g_print("Child process closed stdout.\n");
+			endpoint->closed=1;
+		}
+		
+		free(message);
+	}
+	
+	return G_SOURCE_REMOVE;
+}
+
+/**
+	Called on the I/O thread
+*/
+static void post_message(JsonRpcEndpoint *endpoint, json_t *json, int id, LspJumpLocations *locations)
+{
+	RpcMessage *message=calloc(1,sizeof(RpcMessage));
+	message->json=json;
+	message->id=id;
+	message->locations=locations;
+	message->first_byte_us=endpoint->first_byte_us;
+	message->parsed_us=g_get_monotonic_time();
+	
+	lspjump_mpsc_queue_push(&endpoint->incoming,&message->node);
+	
+	if(g_atomic_int_compare_and_exchange(&endpoint->wake_pending,0,1))
+	{
+		g_idle_add_full(G_PRIORITY_DEFAULT,deliver_incoming,lspjump_rpc_endpoint_ref(endpoint),(GDestroyNotify)lspjump_rpc_endpoint_unref);
+	}
+}
+
+static void parse_message(JsonRpcEndpoint *endpoint, const char *body, size_t body_len)
+{
+	LspJumpReplyInfo info;
+	gint64 start=LSPJUMP_TRACE_ON(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_INFO)?g_get_monotonic_time():0;
+	gint64 timeline_start=LSPJUMP_TIMELINE_START();
+	
+	LSPJUMP_TRACE_BODY(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_IN,body,body_len);
+	
+	// Location replies are pulled straight into a compact list, the rest goes through jansson
+	const char *method_name=NULL;
+	
+	if(lspjump_jsonpull_scan_reply(body,body_len,&info) && info.has_id && !info.has_method &&
+	   (method_name=take_method(endpoint,info.id)) && !info.has_error && info.result)
+	{
+		LspJumpLocations *locations=lspjump_locations_parse(info.result,info.result_len);
+		
+		if(locations)
+		{
+			LSPJUMP_TRACE_RECORD(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_IN,endpoint->generation,info.id,method_name,body_len,start,g_get_monotonic_time());
+			LSPJUMP_TRACE_LOG(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_DEBUG,"pulled %u locations for request %ld",locations->len,info.id);
+			LSPJUMP_TIMELINE_SPAN("io",method_name,timeline_start,info.id,LSPJUMP_FLOW_STEP);
+			post_message(endpoint,NULL,info.id,locations);
+			return;
+		}
+	}
+	
+	json_error_t jerr;
+	json_t *json = json_loadb(body, body_len, 0, &jerr);
+
+	if (!json)
+	{
+		g_printerr("JSON parse error: %s at line %d\n", jerr.text, jerr.line);
+		return;
+	}
+
+	LSPJUMP_TRACE_RECORD(LSPJUMP_TRACE_RPC,LSPJUMP_TRACE_IN,endpoint->generation,json_integer_value(json_object_get(json,"id")),
+	                     method_name?method_name:json_string_value(json_object_get(json,"method")),body_len,start,g_get_monotonic_time());
+	
+	if(LSPJUMP_TIMELINE_ON)
+	{
+		const char *name=method_name?method_name:json_string_value(json_object_get(json,"method"));
+		
+		// A reply to a request the main thread still waits for carries its id
+		lspjump_timeline_span("io",name?name:"reply",timeline_start,g_get_monotonic_time(),
+		                      json_integer_value(json_object_get(json,"id")),name && !method_name?LSPJUMP_FLOW_NONE:LSPJUMP_FLOW_STEP);
+	}
+	
+	post_message(endpoint,json,0,NULL);
+}
+
+/**
+	Runs on the I/O thread, the main thread only gets parsed messages
+*/
+static gboolean read_stdout(GIOChannel *source, GIOCondition condition, gpointer data)
+{
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
+	int fd=g_io_channel_unix_get_fd(source);
+	gboolean eof=FALSE;
+
+	// Read straight into the frame buffer, the bodies are parsed where they land
+	while(1)
+	{
+		// Nothing left over of the last message, this read starts the next one
+		gboolean starts_message=endpoint->frame_parser->start==endpoint->frame_parser->end;
+		size_t avail=0;
+		char *buffer=lspjump_frame_parser_reserve(endpoint->frame_parser,4096,&avail);
+
+		if(buffer==NULL)
+		{
+			g_printerr("Out of memory reading from %s\n",endpoint->root_uri);
+			eof=TRUE;
+			break;
+		}
+
+		ssize_t bytes_read=read(fd,buffer,avail);
+
+		if(bytes_read>0)
+		{
+			gint64 now=g_get_monotonic_time();
+			
+			if(starts_message)
+			{
+				endpoint->first_byte_us=now;
+			}
+			
+			lspjump_frame_parser_commit(endpoint->frame_parser,bytes_read);
+			g_atomic_pointer_add(&endpoint->bytes_in,bytes_read);
+
+			const char *body;
+			size_t body_len;
+
+			while(lspjump_frame_parser_next(endpoint->frame_parser,&body,&body_len))
+			{
+				if(endpoint->recorder)
+				{
+					lspjump_recorder_write(endpoint->recorder,LSPJUMP_RECORD_FROM_SERVER,body,body_len);
+				}
+				
+				parse_message(endpoint,body,body_len);
+				
+				// Whatever follows in the buffer arrived with this read
+				endpoint->first_byte_us=now;
+			}
+		}
+		else if(bytes_read==0)
+		{
+			eof=TRUE;
+			break;
+		}
+		else if(errno==EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			if(errno!=EAGAIN && errno!=EWOULDBLOCK)
+			{
+				g_printerr("Error reading from child: %s\n", g_strerror(errno));
+				eof=TRUE;
+			}
+			break;
+		}
+	}
+
+	if (eof || ((condition & G_IO_HUP) && !(condition & G_IO_IN))) {
+		post_message(endpoint,NULL,0,NULL);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/**
+	Runs on the I/O thread
+*/
+static gboolean read_stderr(GIOChannel *source, GIOCondition condition, gpointer data) {
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
+	gchar *message = NULL;
+	gsize len;
+	g_autoptr(GError) error = NULL;
+
+	if (condition & G_IO_HUP) {
+		g_print("Child process closed stderr.\n");
+		return FALSE;
+	}
+
+	if (g_io_channel_read_line(endpoint->stderr_channel, &message, &len, NULL, &error) == G_IO_STATUS_NORMAL) {
+		g_print("ERR:: %s", message);
+		g_free(message);
+	}
+
+	return TRUE;
+}
+
+static gpointer io_thread_main(gpointer data)
+{
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
+	
+	lspjump_timeline_name_thread("lspjump-io");
+	g_main_context_push_thread_default(endpoint->io_context);
+	g_main_loop_run(endpoint->io_loop);
+	g_main_context_pop_thread_default(endpoint->io_context);
+	
+	return NULL;
+}
+
+static GSource *add_io_watch(JsonRpcEndpoint *endpoint, GIOChannel *channel, GIOFunc func)
+{
+	GSource *source=g_io_create_watch(channel, G_IO_IN | G_IO_HUP);
+	
+	g_source_set_callback(source, (GSourceFunc)func, endpoint, NULL);
+	g_source_attach(source, endpoint->io_context);
+	
+	return source;
+}
+
+static gboolean spawn_child(JsonRpcEndpoint *endpoint, const gchar *program, gchar **args) {
+	g_autoptr(GError) error = NULL;
+	gint stdin_fd, stdout_fd, stderr_fd;
 
-		int send_id=store_rpc_action(endpoint,action,user_data);
+	if (!g_spawn_async_with_pipes(NULL, args, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &endpoint->child_pid, &stdin_fd, &stdout_fd, &stderr_fd, &error)) {
+		g_printerr("Failed to spawn process: %s\n", error->message);
+		return FALSE;
+	}
+	
+	endpoint->stdin_channel = g_io_channel_unix_new(stdin_fd);
+	g_io_channel_set_flags(endpoint->stdin_channel, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_channel_set_close_on_unref(endpoint->stdin_channel, TRUE);
+	endpoint->stdout_channel = g_io_channel_unix_new(stdout_fd);
+	g_io_channel_set_encoding(endpoint->stdout_channel, NULL, NULL);
+	g_io_channel_set_buffered(endpoint->stdout_channel, FALSE);
+	g_io_channel_set_flags(endpoint->stdout_channel, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_channel_set_close_on_unref(endpoint->stdout_channel, TRUE);
+	endpoint->stderr_channel = g_io_channel_unix_new(stderr_fd);
+	g_io_channel_set_flags(endpoint->stderr_channel, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_channel_set_close_on_unref(endpoint->stderr_channel, TRUE);
+
+	endpoint->io_context = g_main_context_new();
+	endpoint->io_loop = g_main_loop_new(endpoint->io_context, FALSE);
+	endpoint->stdout_watch = add_io_watch(endpoint, endpoint->stdout_channel, read_stdout);
+	endpoint->stderr_watch = add_io_watch(endpoint, endpoint->stderr_channel, read_stderr);
+	endpoint->io_thread = g_thread_new("lspjump-io", io_thread_main, endpoint);
+	
+	// Crashes are noticed here, and the child never stays a zombie
+	endpoint->child_source = g_child_watch_add(endpoint->child_pid, on_child_exit, lspjump_rpc_endpoint_ref(endpoint));
+	
+	return TRUE;
+}
+
+static gboolean quit_io_loop(gpointer data)
+{
+	g_main_loop_quit(data);
+	
+	return G_SOURCE_REMOVE;
+}
+
+/**
+	Stop the I/O thread and close the pipes. Messages it already parsed are still delivered.
+*/
+static void close_channels(JsonRpcEndpoint *endpoint)
+{
+	if(endpoint->io_thread)
+	{
+		// Quit from inside the loop, a quit before the thread got to run it would be lost
+		g_autoptr(GSource) quit_source=g_idle_source_new();
+		g_source_set_callback(quit_source,quit_io_loop,g_main_loop_ref(endpoint->io_loop),(GDestroyNotify)g_main_loop_unref);
+		g_source_attach(quit_source,endpoint->io_context);
+		
+		g_thread_join(endpoint->io_thread);
+		endpoint->io_thread=NULL;
+	}
+	
+	if(endpoint->stdout_watch)
+	{
+		g_source_destroy(endpoint->stdout_watch);
+		g_clear_pointer(&endpoint->stdout_watch,g_source_unref);
+	}
+	
+	if(endpoint->stderr_watch)
+	{
+		g_source_destroy(endpoint->stderr_watch);
+		g_clear_pointer(&endpoint->stderr_watch,g_source_unref);
+	}
+	
+	g_clear_pointer(&endpoint->io_loop,g_main_loop_unref);
+	g_clear_pointer(&endpoint->io_context,g_main_context_unref);
+	
+	g_clear_handle_id(&endpoint->stdin_source,g_source_remove);
+	g_clear_pointer(&endpoint->stdin_channel,g_io_channel_unref);
+	g_clear_pointer(&endpoint->stdout_channel,g_io_channel_unref);
+	g_clear_pointer(&endpoint->stderr_channel,g_io_channel_unref);
+}
+
+const char *LOGIN_STR="{"
+"	\"textDocument\": {\"codeAction\": {\"dynamicRegistration\": true},"
+"	\"codeLens\": {\"dynamicRegistration\": true},"
+"	\"colorProvider\": {\"dynamicRegistration\": true},"
+"	\"completion\": {\"completionItem\": {\"commitCharactersSupport\": true,\"documentationFormat\": [\"markdown\", \"plaintext\"],\"snippetSupport\": true},"
+"	\"completionItemKind\": {\"valueSet\": [1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25]},"
+"	\"contextSupport\": true,"
+"	\"dynamicRegistration\": true},"
+"	\"definition\": {\"dynamicRegistration\": true},"
+"	\"documentHighlight\": {\"dynamicRegistration\": true},"
+"	\"documentLink\": {\"dynamicRegistration\": true},"
+"	\"documentSymbol\": {\"dynamicRegistration\": true,"
+"	\"symbolKind\": {\"valueSet\": [1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26]}},"
+"	\"formatting\": {\"dynamicRegistration\": true},"
+"	\"hover\": {\"contentFormat\": [\"markdown\", \"plaintext\"],"
+"	\"dynamicRegistration\": true},"
+"	\"implementation\": {\"dynamicRegistration\": true},"
+"	\"onTypeFormatting\": {\"dynamicRegistration\": true},"
+"	\"publishDiagnostics\": {\"relatedInformation\": true},"
+"	\"rangeFormatting\": {\"dynamicRegistration\": true},"
+"	\"references\": {\"dynamicRegistration\": true},"
+"	\"rename\": {\"dynamicRegistration\": true},"
+"	\"signatureHelp\": {\"dynamicRegistration\": true,"
+"	\"signatureInformation\": {\"documentationFormat\": [\"markdown\", \"plaintext\"]}},"
+"	\"synchronization\": {\"didSave\": true,"
+"	\"dynamicRegistration\": true,"
+"	\"willSave\": true,"
+"	\"willSaveWaitUntil\": true},"
+"	\"typeDefinition\": {\"dynamicRegistration\": true}},"
+"	\"workspace\": {\"applyEdit\": true,"
+"	\"configuration\": true,"
+"	\"didChangeConfiguration\": {\"dynamicRegistration\": true},"
+"	\"didChangeWatchedFiles\": {\"dynamicRegistration\": true},"
+"	\"executeCommand\": {\"dynamicRegistration\": true},"
+"	\"symbol\": {\"dynamicRegistration\": true,"
+"	\"symbolKind\": {\"valueSet\": [1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26]}},\"workspaceEdit\": {\"documentChanges\": true},"
+"	\"workspaceFolders\": true}"
+"}";
+
+
+/**
+	The server announces textDocumentSync either as a TextDocumentSyncKind or as
+	TextDocumentSyncOptions. When it is left out nothing should be synced.
+*/
+static void read_sync_capability(JsonRpcEndpoint *endpoint, json_t *capabilities)
+{
+	json_t *sync=json_object_get(capabilities,"textDocumentSync");
+	
+	endpoint->sync_kind=LSPJUMP_SYNC_NONE;
+	endpoint->sync_open_close=0;
+	
+	if(json_is_integer(sync))
+	{
+		endpoint->sync_kind=json_integer_value(sync);
+		endpoint->sync_open_close=endpoint->sync_kind!=LSPJUMP_SYNC_NONE;
+	}
+	else if(json_is_object(sync))
+	{
+		json_t *change=json_object_get(sync,"change");
+		
+		if(json_is_integer(change))
+		{
+			endpoint->sync_kind=json_integer_value(change);
+		}
+		
+		endpoint->sync_open_close=json_is_true(json_object_get(sync,"openClose"));
+	}
+}
+
+/**
+	positionEncoding is from LSP 3.17, clangd said offsetEncoding before that.
+	Without either the server counts UTF-16 code units.
+*/
+static void read_position_encoding(JsonRpcEndpoint *endpoint, json_t *result)
+{
+	const char *encoding=json_string_value(json_object_get(json_object_get(result,"capabilities"),"positionEncoding"));
+	
+	if(encoding==NULL)
+	{
+		encoding=json_string_value(json_object_get(result,"offsetEncoding"));
+	}
+	
+	if(g_strcmp0(encoding,"utf-8")==0)
+	{
+		endpoint->position_encoding=LSPJUMP_POSITION_UTF8;
+	}
+	else if(g_strcmp0(encoding,"utf-32")==0)
+	{
+		endpoint->position_encoding=LSPJUMP_POSITION_UTF32;
+	}
+	else
+	{
+		endpoint->position_encoding=LSPJUMP_POSITION_UTF16;
+	}
+}
+
+static void init_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+{
+	// Timed out, the server is stuck and everything waits for it as before
+	if(root==NULL)
+	{
+		g_printerr("The server did not answer initialize\n");
+		return;
+	}
+	
+	g_print("Initialize response received\n");
+	
+	json_t *result=json_object_get(root,"result");
+	json_t *capabilities=json_object_get(result,"capabilities");
+	
+	if(capabilities)
+	{
+		endpoint->server_capabilities=json_incref(capabilities);
+	}
+	
+	read_sync_capability(endpoint,capabilities);
+	read_position_encoding(endpoint,result);
+	
+	// Send "initialized", it goes ahead of what was asked for while waiting
+	send_rpc_message(endpoint, "initialized", NULL, -2);
+	
+	endpoint->initialized=1;
+	
+	// Then everything that was asked for while waiting, in order
+	flush_outgoing(endpoint);
+}
+
+int initialize(JsonRpcEndpoint *endpoint,const char *const root_path, const char *const root_uri, json_t *initialization_options,
+               json_t *capabilities, const char *const trace, json_t *workspace_folders)
+{
+//	pid_t process_id = getpid();
+	pid_t process_id = endpoint->child_pid;
+	
+	// UTF-8 is what the mirrors of the documents convert to the cheapest, the
+	// capabilities may be shared so the offer goes into a copy
+	g_autoptr(json_t) offered = json_deep_copy(capabilities);
+	json_t *general = json_object_get(offered, "general");
+	
+	if(!json_is_object(general))
+	{
+		general = json_object();
+		json_object_set_new(offered, "general", general);
+	}
+	
+	if(!json_object_get(general, "positionEncodings"))
+	{
+		json_object_set_new(general, "positionEncodings", json_pack("[s,s,s]", "utf-8", "utf-16", "utf-32"));
+	}
+	
+	if(!json_object_get(offered, "offsetEncoding"))
+	{
+		json_object_set_new(offered, "offsetEncoding", json_pack("[s,s,s]", "utf-8", "utf-16", "utf-32"));
+	}
+	
+	g_autoptr(json_t) params = json_pack("{s:i, s:s, s:O, s:s, s:O}",
+		"processId",process_id,
+		"rootUri",root_uri,
+		"capabilities",offered,
+		"trace",trace,
+		"workspaceFolders",workspace_folders
+	);
+	
+	if(root_path)
+	{
+		json_object_set_new(params, "rootPath", json_string(root_path));
+	}
+	
+	if(initialization_options)
+	{
+		json_object_set_new(params, "initializationOptions", initialization_options);
+	}
+	
+	int send_id=store_rpc_action(endpoint,"initialize",init_cb,NULL,60000);
+	
+	send_rpc_message(endpoint,"initialize",params,send_id);
+	
+	return send_id;
+}
+
+/**
+	Until the server has answered initialize the sync kind is not known, the
+	document is opened but changes are held back.
+*/
+LspJumpSyncKind lspjump_rpc_get_sync_kind(JsonRpcEndpoint *endpoint, gboolean *open_close)
+{
+	if(endpoint && endpoint->initialized)
+	{
+		if(open_close)
+		{
+			*open_close=endpoint->sync_open_close;
+		}
+		
+		return endpoint->sync_kind;
+	}
+	
+	if(open_close)
+	{
+		*open_close=endpoint!=NULL;
+	}
+	
+	return LSPJUMP_SYNC_NONE;
+}
+
+/**
+	Until the server has answered initialize it is not known which encoding it
+	picked, positions are sent in UTF-16 like the protocol says without one.
+*/
+LspJumpPositionEncoding lspjump_rpc_get_position_encoding(JsonRpcEndpoint *endpoint)
+{
+	return (endpoint && endpoint->initialized)?endpoint->position_encoding:LSPJUMP_POSITION_UTF16;
+}
 
-		send_rpc_message(endpoint,"textDocument/definition",params2,-1);
+/**
+	Start a notification that is written by hand instead of through jansson, the
+	params follow
+*/
+static GString *begin_notification(const char *const method_name, size_t size_hint)
+{
+	GString *message=g_string_sized_new(size_hint+size_hint/16+256);
+	
+	g_string_append(message,"{\"jsonrpc\":\"2.0\",\"method\":");
+	lspjump_json_write_string(message,method_name);
+	g_string_append(message,",\"params\":");
+	
+	return message;
+}
 
-		return 0;
+/**
+	Queue a notification started with begin_notification, the length of the
+	message is already known so nothing is copied or measured again
+*/
+static void send_notification(JsonRpcEndpoint *endpoint, const char *const method_name, const char *const uri, GString *message)
+{
+	g_string_append_c(message,'}');
+	
+	endpoint->last_used=g_get_monotonic_time();
+	
+	if(endpoint->closed || endpoint->stdin_channel==NULL || endpoint->close_stdin)
+	{
+		g_string_free(message,TRUE);
+		return;
 	}
 	
-	return 1;
+	size_t len=message->len;
+	
+	lspjump_out_queue_push_body(&endpoint->outgoing,g_string_free(message,FALSE),len,method_name,uri);
+	flush_outgoing(endpoint);
 }
 
-int lspjump_rpc_reference(const char *const file_path, const char *const file_contents, long doc_line, long doc_offset,
-                           IdActionFunction action, void *user_data)
-{
-	JsonRpcEndpoint *endpoint=GLOBAL_ENDPOINT;
+/**
+	The text is escaped straight into the message, it is never held as a string
+	of its own or as a JSON tree.
 	
-	if(endpoint)
+	@param write_text
+		writes the escaped text of the document
+	@param size_hint
+		about how many bytes the text is
+*/
+int lspjump_rpc_did_open(JsonRpcEndpoint *endpoint, const char *const uri, const char *const language_id, int version,
+                         LspJumpTextWriter write_text, void *user_data, size_t size_hint)
+{
+	if(endpoint && !endpoint->shutting_down)
 	{
-		g_autofree char *uri_path=NULL;
-		asprintf(&uri_path,"file://%s",file_path);
+		GString *message=begin_notification("textDocument/didOpen",size_hint);
 		
-		lspjump_rpc_did_open(uri_path,file_contents);
+		g_string_append(message,"{\"textDocument\":{\"uri\":");
+		lspjump_json_write_string(message,uri);
+		g_string_append(message,",\"languageId\":");
+		lspjump_json_write_string(message,language_id);
+		g_string_append_printf(message,",\"version\":%d,\"text\":\"",version);
+		write_text(message,user_data);
+		g_string_append(message,"\"}}");
 		
-		g_autoptr(json_t) params2 = json_pack("{s:{s:s},s:{s:i,s:i}}",
+		send_notification(endpoint,"textDocument/didOpen",uri,message);
+		
+		return 0;
+	}
+	return 1;
+}
+
+/**
+	@param content_changes
+		array of TextDocumentContentChangeEvent, applied by the server in order
+*/
+int lspjump_rpc_did_change(JsonRpcEndpoint *endpoint, const char *const uri, int version, json_t *content_changes)
+{
+	if(endpoint && !endpoint->shutting_down)
+	{
+		g_autoptr(json_t) params = json_pack("{s:{s:s, s:i}, s:O}",
 			"textDocument",
-			"uri", uri_path,
-			"position",
-			"line",doc_line,
-			"character",doc_offset
+			"uri", uri,
+			"version", version,
+			"contentChanges", content_changes
 		);
+		
+		send_rpc_message(endpoint,"textDocument/didChange",params,-2);
+		
+		return 0;
+	}
+	return 1;
+}
 
-		int send_id=store_rpc_action(endpoint,action,user_data);
-
-		send_rpc_message(endpoint,"textDocument/references",params2,-1);
+/**
+	didChange with the whole text, for servers that sync fully. Written like
+	lspjump_rpc_did_open.
+*/
+int lspjump_rpc_did_change_full(JsonRpcEndpoint *endpoint, const char *const uri, int version, LspJumpTextWriter write_text, void *user_data, size_t size_hint)
+{
+	if(endpoint && !endpoint->shutting_down)
+	{
+		GString *message=begin_notification("textDocument/didChange",size_hint);
+		
+		g_string_append(message,"{\"textDocument\":{\"uri\":");
+		lspjump_json_write_string(message,uri);
+		g_string_append_printf(message,",\"version\":%d},\"contentChanges\":[{\"text\":\"",version);
+		write_text(message,user_data);
+		g_string_append(message,"\"}]}");
+		
+		send_notification(endpoint,"textDocument/didChange",uri,message);
+		
+		return 0;
+	}
+	return 1;
+}
 
+int lspjump_rpc_did_close(JsonRpcEndpoint *endpoint, const char *const uri)
+{
+	if(endpoint && !endpoint->shutting_down)
+	{
+		g_autoptr(json_t) params = json_pack("{s:{s:s}}",
+			"textDocument",
+			"uri", uri
+		);
+		
+		send_rpc_message(endpoint,"textDocument/didClose",params,-2);
+		
 		return 0;
 	}
-	
 	return 1;
 }
 
-int lspjump_rpc_hover(const char *const file_path, const char *const file_contents, long doc_line, long doc_offset,
-                      IdActionFunction action, void *user_data)
+static gboolean deliver_cached_replies(gpointer data)
 {
-	JsonRpcEndpoint *endpoint=GLOBAL_ENDPOINT;
+	JsonRpcEndpoint *endpoint = (JsonRpcEndpoint *)data;
 	
-	if(endpoint)
+	endpoint->cached_source=0;
+	lspjump_rpc_endpoint_ref(endpoint);
+	
+	while(!g_queue_is_empty(&endpoint->cached_ids))
 	{
-		g_autofree char *uri_path=NULL;
-		asprintf(&uri_path,"file://%s",file_path);
+		gpointer key=g_queue_pop_head(&endpoint->cached_ids);
+		RpcIdAction *id_action=g_hash_table_lookup(endpoint->id_actions,key);
 		
-		lspjump_rpc_did_open(uri_path,file_contents);
+		// Cancelled before it got here
+		if(!id_action)
+		{
+			continue;
+		}
+		
+		g_hash_table_steal(endpoint->id_actions,key);
+		
+		LSPJUMP_TRACE_RECORD(LSPJUMP_TRACE_CACHE,LSPJUMP_TRACE_CACHED,endpoint->generation,id_action->id,id_action->method,0,g_get_monotonic_time(),0);
+		
+		gint64 timeline_start=LSPJUMP_TIMELINE_START();
+		
+		if(id_action->locations_action)
+		{
+			id_action->locations_action(endpoint,id_action->cached_locations,id_action->user_data);
+		}
+		else if(id_action->action)
+		{
+			id_action->action(endpoint,id_action->cached_reply,id_action->user_data);
+		}
+		
+		LSPJUMP_TIMELINE_SPAN("cache",id_action->method,timeline_start,id_action->id,LSPJUMP_FLOW_NONE);
+		
+		rpc_id_action_free(id_action);
+	}
+	
+	lspjump_rpc_endpoint_unref(endpoint);
+	
+	return G_SOURCE_REMOVE;
+}
+
+/**
+	Send a request about a position in a document. When the identifier range is
+	given the reply is cached, and a cached reply for the same document version is
+	delivered without asking the server.
+	
+	Either action or locations_action is given, the second one gets the reply as a
+	list of locations.
+*/
+static int send_position_request(JsonRpcEndpoint *endpoint, const char *const method_name, LspJumpOutPriority priority, const char *const uri, int version,
+                                 const LspJumpRange *word, long doc_line, long doc_offset, IdActionFunction action, LocationsActionFunction locations_action,
+                                 void *user_data)
+{
+	if(endpoint && !endpoint->shutting_down && !endpoint->closed)
+	{
+		int send_id=store_rpc_action(endpoint,method_name,action,user_data,0);
+		RpcIdAction *id_action=g_hash_table_lookup(endpoint->id_actions,GINT_TO_POINTER(send_id));
+		
+		id_action->locations_action=locations_action;
+		
+		if(word)
+		{
+			json_t *cached=NULL;
+			LspJumpLocations *cached_locations=NULL;
+			
+			if(locations_action)
+			{
+				cached_locations=lspjump_cache_lookup_locations(uri,version,method_name,word);
+			}
+			else
+			{
+				cached=lspjump_cache_lookup(uri,version,method_name,word);
+			}
+			
+			if(cached || cached_locations)
+			{
+				// Delivered later like a real reply, callers do not expect the action to run right away
+				id_action->cached_reply=cached?json_incref(cached):NULL;
+				id_action->cached_locations=cached_locations?lspjump_locations_ref(cached_locations):NULL;
+				g_queue_push_tail(&endpoint->cached_ids,GINT_TO_POINTER(send_id));
+				
+				if(endpoint->cached_source==0)
+				{
+					endpoint->cached_source=g_idle_add(deliver_cached_replies,endpoint);
+				}
+				
+				return send_id;
+			}
+			
+			id_action->cache_uri=g_strdup(uri);
+			id_action->cache_version=version;
+			id_action->cache_range=*word;
+		}
+		
+		const char *locations_method=locations_action?get_locations_method(method_name):NULL;
+		
+		if(locations_method)
+		{
+			remember_method(endpoint,send_id,locations_method);
+		}
 		
-		g_autoptr(json_t) params2 = json_pack("{s:{s:s},s:{s:i,s:i}}",
+		g_autoptr(json_t) params = json_pack("{s:{s:s},s:{s:i,s:i}}",
 			"textDocument",
-			"uri", uri_path,
+			"uri", uri,
 			"position",
 			"line",doc_line,
 			"character",doc_offset
 		);
 
-		int send_id=store_rpc_action(endpoint,action,user_data);
+		if(send_rpc_message_with_priority(endpoint,method_name,params,send_id,priority)<0)
+		{
+			take_method(endpoint,send_id);
+			g_hash_table_remove(endpoint->id_actions,GINT_TO_POINTER(send_id));
+			return -1;
+		}
 
-		send_rpc_message(endpoint,"textDocument/hover",params2,-1);
+		return send_id;
+	}
+	
+	return -1;
+}
 
-		return 0;
+/**
+	The document has to be synced with lspjump_document_sync_flush before asking,
+	which also gives the endpoint to ask.
+	
+	@param version
+		version of the document the position is in
+	@param word
+		the identifier the position is in, NULL if the reply should not be cached
+	@return
+		the id of the request, -1 if there is no server to ask
+*/
+int lspjump_rpc_definition(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
+                           LocationsActionFunction action, void *user_data)
+{
+	return send_position_request(endpoint,"textDocument/definition",get_priority("textDocument/definition"),uri,version,word,doc_line,doc_offset,NULL,action,user_data);
+}
+
+/**
+	A definition nobody asked for yet. It goes out with low priority, so it is
+	dropped while the server is behind or when the next prefetch supersedes it,
+	and then the action gets NULL.
+*/
+int lspjump_rpc_definition_prefetch(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
+                                    LocationsActionFunction action, void *user_data)
+{
+	return send_position_request(endpoint,"textDocument/definition",LSPJUMP_OUT_PRIORITY_LOW,uri,version,word,doc_line,doc_offset,NULL,action,user_data);
+}
+
+int lspjump_rpc_reference(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
+                          LocationsActionFunction action, void *user_data)
+{
+	return send_position_request(endpoint,"textDocument/references",get_priority("textDocument/references"),uri,version,word,doc_line,doc_offset,NULL,action,user_data);
+}
+
+int lspjump_rpc_hover(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
+                      IdActionFunction action, void *user_data)
+{
+	return send_position_request(endpoint,"textDocument/hover",get_priority("textDocument/hover"),uri,version,word,doc_line,doc_offset,action,NULL,user_data);
+}
+
+static void endpoint_free(JsonRpcEndpoint *endpoint)
+{
+	if(GLOBAL_ENDPOINTS && g_hash_table_lookup(GLOBAL_ENDPOINTS,GUINT_TO_POINTER(endpoint->generation))==endpoint)
+	{
+		g_hash_table_remove(GLOBAL_ENDPOINTS,GUINT_TO_POINTER(endpoint->generation));
 	}
 	
-	return 1;
+	g_clear_handle_id(&endpoint->sweep_source,g_source_remove);
+	g_clear_handle_id(&endpoint->cached_source,g_source_remove);
+	g_clear_handle_id(&endpoint->child_source,g_source_remove);
+	g_clear_handle_id(&endpoint->kill_source,g_source_remove);
+	
+	close_channels(endpoint);
+	
+	g_queue_clear(&endpoint->cached_ids);
+	lspjump_out_queue_clear(&endpoint->outgoing);
+	
+	RpcMessage *message;
+	
+	while((message=(RpcMessage *)lspjump_mpsc_queue_pop(&endpoint->incoming)))
+	{
+		json_decref(message->json);
+		lspjump_locations_unref(message->locations);
+		free(message);
+	}
+	
+	g_hash_table_destroy(endpoint->id_actions);
+	g_hash_table_destroy(endpoint->pending_methods);
+	g_mutex_clear(&endpoint->methods_lock);
+	lspjump_frame_parser_free(endpoint->frame_parser);
+	lspjump_recorder_close(endpoint->recorder);
+	json_decref(endpoint->server_capabilities);
+	g_free(endpoint->root_uri);
+	free(endpoint);
+}
+
+JsonRpcEndpoint *lspjump_rpc_endpoint_ref(JsonRpcEndpoint *endpoint)
+{
+	g_atomic_int_inc(&endpoint->ref_count);
+	
+	return endpoint;
 }
 
-int lspjump_rpc_init(const char *const root_uri,const char *const lsp_bin,const char *const lsp_bin_args,const char *const lsp_settings)
+void lspjump_rpc_endpoint_unref(JsonRpcEndpoint *endpoint)
 {
-	GLOBAL_ENDPOINT=calloc(1,sizeof(JsonRpcEndpoint));
+	if(endpoint && g_atomic_int_dec_and_test(&endpoint->ref_count))
+	{
+		endpoint_free(endpoint);
+	}
+}
+
+/**
+	Requests to a server that went away will never be answered, the actions get
+	NULL right away instead of waiting for the timeout
+*/
+static void fail_requests(JsonRpcEndpoint *endpoint)
+{
+	GList *ids=g_hash_table_get_keys(endpoint->id_actions);
+	
+	for(GList *item=ids;item;item=item->next)
+	{
+		drop_request(GPOINTER_TO_INT(item->data),endpoint);
+	}
+	
+	g_list_free(ids);
+}
+
+static void on_child_exit(GPid pid, gint status, gpointer user_data)
+{
+	JsonRpcEndpoint *endpoint=user_data;
 	
-	g_auto(GStrv) bin_args = g_strsplit(lsp_bin_args, " ", -1);
+	g_print("Language server %d exited with status %d\n",pid,status);
 	
-	guint arg_len=bin_args?g_strv_length(bin_args):0;
+	g_spawn_close_pid(pid);
+	endpoint->child_source=0;
+	endpoint->exited=1;
+	endpoint->closed=1;
 	
-	gchar *args[arg_len+2];
-	args[0]=lsp_bin?(char*)lsp_bin:"/usr/bin/clangd";
-	int i=0;
-	while(i<arg_len)
+	g_clear_handle_id(&endpoint->kill_source,g_source_remove);
+	close_channels(endpoint);
+	lspjump_out_queue_clear(&endpoint->outgoing);
+	
+	if(!endpoint->shutting_down)
+	{
+		fail_requests(endpoint);
+		
+		if(endpoint->exit_action)
+		{
+			endpoint->exit_action(endpoint,status,endpoint->exit_data);
+		}
+	}
+	
+	// Taken when the child was spawned
+	lspjump_rpc_endpoint_unref(endpoint);
+}
+
+static gboolean kill_child(gpointer data)
+{
+	JsonRpcEndpoint *endpoint=data;
+	
+	g_printerr("Language server %d did not exit, terminating it\n",endpoint->child_pid);
+	
+	endpoint->kill_source=0;
+	kill(endpoint->child_pid,SIGTERM);
+	
+	return G_SOURCE_REMOVE;
+}
+
+static void shutdown_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+{
+	send_rpc_message(endpoint,"exit",NULL,-2);
+	
+	endpoint->close_stdin=1;
+	flush_outgoing(endpoint);
+}
+
+/**
+	Ask the server to shut down and exit. The child is reaped once it has exited,
+	and terminated if it takes longer than GEDIT_RPC_SHUTDOWN_TIMEOUT_MS. Pending
+	requests are dropped without calling their actions, and exit_action is not
+	called.
+*/
+void lspjump_rpc_endpoint_shutdown(JsonRpcEndpoint *endpoint)
+{
+	if(endpoint->shutting_down)
+	{
+		return;
+	}
+	
+	endpoint->shutting_down=1;
+	
+	// Documents opened on this server have to be opened again elsewhere
+	g_hash_table_remove(GLOBAL_ENDPOINTS,GUINT_TO_POINTER(endpoint->generation));
+	
+	g_hash_table_remove_all(endpoint->id_actions);
+	g_queue_clear(&endpoint->cached_ids);
+	
+	g_mutex_lock(&endpoint->methods_lock);
+	g_hash_table_remove_all(endpoint->pending_methods);
+	g_mutex_unlock(&endpoint->methods_lock);
+	
+	if(endpoint->exited)
+	{
+		return;
+	}
+	
+	if(endpoint->initialized && !endpoint->closed)
+	{
+		int send_id=store_rpc_action(endpoint,"shutdown",shutdown_cb,NULL,GEDIT_RPC_SHUTDOWN_TIMEOUT_MS);
+		send_rpc_message(endpoint,"shutdown",NULL,send_id);
+		
+		endpoint->kill_source=g_timeout_add(GEDIT_RPC_SHUTDOWN_TIMEOUT_MS,kill_child,endpoint);
+	}
+	else
+	{
+		// Nothing was ever answered, there is no state on the server worth a clean exit
+		lspjump_out_queue_clear(&endpoint->outgoing);
+		kill(endpoint->child_pid,SIGTERM);
+	}
+}
+
+/**
+	Look up a server that has not been shut down. Documents remember the
+	generation they were opened on, not the endpoint.
+
+	@return
+		the endpoint, not referenced, or NULL
+*/
+JsonRpcEndpoint *lspjump_rpc_endpoint_from_generation(guint generation)
+{
+	if(GLOBAL_ENDPOINTS==NULL || generation==0)
+	{
+		return NULL;
+	}
+	
+	return g_hash_table_lookup(GLOBAL_ENDPOINTS,GUINT_TO_POINTER(generation));
+}
+
+/**
+	@return
+		TRUE if nothing has been sent to the server for idle_us and no request waits for a reply
+*/
+gboolean lspjump_rpc_endpoint_is_idle(JsonRpcEndpoint *endpoint, gint64 idle_us)
+{
+	return g_hash_table_size(endpoint->id_actions)==0 && g_get_monotonic_time()-endpoint->last_used>=idle_us;
+}
+
+/**
+	LSPJUMP_RECORD=path saves the traffic of every server to path.GENERATION, to be
+	replayed with bench/lsp-replay
+*/
+static void start_recording(JsonRpcEndpoint *endpoint)
+{
+	const char *record=g_getenv("LSPJUMP_RECORD");
+	
+	if(record && *record)
+	{
+		g_autofree char *path=g_strdup_printf("%s.%u",record,endpoint->generation);
+		g_autoptr(GError) error=NULL;
+		
+		endpoint->recorder=lspjump_recorder_open(path,&error);
+		
+		if(endpoint->recorder)
+		{
+			g_print("Recording %s to %s\n",endpoint->root_uri,path);
+			endpoint->outgoing.recorder=endpoint->recorder;
+		}
+		else
+		{
+			g_printerr("Could not record: %s\n",error->message);
+		}
+	}
+}
+
+/**
+	Writing to a server that has died raises SIGPIPE, which would end gedit. The
+	write fails with EPIPE instead, unless someone else handles the signal.
+*/
+static void ignore_sigpipe(void)
+{
+	struct sigaction current;
+	
+	if(sigaction(SIGPIPE,NULL,&current)==0 && current.sa_handler==SIG_DFL)
 	{
-		args[i+1]=bin_args[i];
-		i++;
+		signal(SIGPIPE,SIG_IGN);
 	}
-	args[i+1]=NULL;
-	spawn_child(GLOBAL_ENDPOINT, args[0], args);
+}
+
+/**
+	Spawn a language server and initialize it. Messages can be sent right away,
+	they are written once the server has answered initialize.
+
+	@param root_uri
+		file uri of the project root
+	@param lsp_capabilities
+		the client capabilities to announce, not stolen, NULL for the defaults
+	@return
+		a new endpoint, or NULL if the server could not be started
+*/
+JsonRpcEndpoint *lspjump_rpc_endpoint_new(const char *const root_uri,const char *const lsp_bin,const char *const lsp_bin_args,json_t *lsp_capabilities)
+{
+	lspjump_trace_init();
+	ignore_sigpipe();
 	
 	json_error_t error;
-	g_autoptr(json_t) capabilities = json_loads(lsp_settings?lsp_settings:LOGIN_STR, 0, &error);
+	g_autoptr(json_t) capabilities = lsp_capabilities?json_incref(lsp_capabilities):json_loads(LOGIN_STR, 0, &error);
 	
 	if (!capabilities)
 	{
 		fprintf(stderr, "JSON parse error on line %d: %s\n", error.line, error.text);
-		return 1;
+		return NULL;
+	}
+	
+	g_autoptr(JsonRpcEndpoint) endpoint=calloc(1,sizeof(JsonRpcEndpoint));
+	endpoint->ref_count=1;
+	endpoint->root_uri=g_strdup(root_uri);
+	endpoint->frame_parser = lspjump_frame_parser_new();
+	lspjump_mpsc_queue_init(&endpoint->incoming);
+	endpoint->id_actions = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, rpc_id_action_free);
+	lspjump_out_queue_init(&endpoint->outgoing,LSPJUMP_OUT_QUEUE_HIGH_WATER,drop_request,endpoint);
+	endpoint->outgoing.written=request_written;
+	g_mutex_init(&endpoint->methods_lock);
+	endpoint->pending_methods = g_hash_table_new(g_direct_hash, g_direct_equal);
+	endpoint->last_used=g_get_monotonic_time();
+	
+	g_auto(GStrv) bin_args = g_strsplit(lsp_bin_args?lsp_bin_args:"", " ", -1);
+	
+	guint arg_len=g_strv_length(bin_args);
+	
+	gchar *args[arg_len+2];
+	args[0]=(lsp_bin && *lsp_bin)?(char*)lsp_bin:"/usr/bin/clangd";
+	int used=1;
+	for(guint i=0;i<arg_len;i++)
+	{
+		// Repeated spaces give empty strings
+		if(*bin_args[i])
+		{
+			args[used++]=bin_args[i];
+		}
 	}
+	args[used]=NULL;
+	
+	endpoint->generation=++GLOBAL_ENDPOINT_GENERATION;
+	endpoint->outgoing.generation=endpoint->generation;
+	start_recording(endpoint);
+	
+	if(!spawn_child(endpoint, args[0], args))
+	{
+		return NULL;
+	}
+	
+	if(GLOBAL_ENDPOINTS==NULL)
+	{
+		GLOBAL_ENDPOINTS=g_hash_table_new(g_direct_hash,g_direct_equal);
+	}
+	
+	g_hash_table_insert(GLOBAL_ENDPOINTS,GUINT_TO_POINTER(endpoint->generation),endpoint);
 	
 	g_autoptr(json_t) workspace_folders = json_pack("[{s:s, s:s}]",
 		"name", "gedit-lspjump-plugin",
 		"uri", root_uri
 	);
 	
-	initialize(GLOBAL_ENDPOINT,NULL,root_uri,NULL,capabilities,"off",workspace_folders);
+	initialize(endpoint,NULL,root_uri,NULL,capabilities,"off",workspace_folders);
 
-	return 0;
+	return g_steal_pointer(&endpoint);
 }
@@ -23,44 +23,157 @@ freely, subject to the following restrictions:
 #include <jansson.h>
 #include <stdint.h>
 
+#include "gedit-lspjump-frame.h"
+#include "gedit-lspjump-mpsc.h"
+#include "gedit-lspjump-outqueue.h"
+#include "gedit-lspjump-jsonwrite.h"
+#include "gedit-lspjump-cache.h"
+#include "gedit-lspjump-mirror.h"
+
 G_BEGIN_DECLS
 
 typedef struct JsonRpcEndpoint JsonRpcEndpoint;
 typedef void (*IdActionFunction)(JsonRpcEndpoint *endpoint, json_t *root, void *user_data);
+/**
+	locations is NULL if the server answered with an error or something that is
+	not a list of locations
+*/
+typedef void (*LocationsActionFunction)(JsonRpcEndpoint *endpoint, LspJumpLocations *locations, void *user_data);
+/**
+	The server exited without being asked to, status as from waitpid
+*/
+typedef void (*EndpointExitFunction)(JsonRpcEndpoint *endpoint, int status, void *user_data);
 
 typedef struct RpcIdAction
 {
 	int id;
+	char *method;
 	IdActionFunction action;
+	LocationsActionFunction locations_action; // called instead of action if set
 	void *user_data;
 	
-	uint8_t active;
+	gint64 deadline; // monotonic time after which the request is cancelled
+	gint64 enqueued_us;
+	gint64 written_us; // 0 until the whole request is in the pipe
+	
+	json_t *cached_reply; // answered from the cache, delivered from an idle callback
+	LspJumpLocations *cached_locations;
+	char *cache_uri; // set if the reply should be cached
+	int cache_version;
+	LspJumpRange cache_range;
 }RpcIdAction;
 
-#define GEDIT_RPC_ID_ACTIONS_LEN 64
+typedef struct RpcStats
+{
+	guint in_flight;
+	guint64 timed_out;
+	guint64 cancelled;
+	guint64 dropped; // low priority requests never written because the server was behind
+	guint64 merged; // didChange notifications folded into the one before
+	size_t queued_bytes; // waiting for the server to read them
+	guint queued_messages;
+	guint64 bytes_out;
+	guint64 bytes_in;
+	
+	guint64 received; // messages handed to the main thread
+	gint64 dispatch_max_us; // longest the main thread spent on one message
+	gint64 dispatch_total_us;
+}RpcStats;
+
+typedef enum LspJumpSyncKind
+{
+	LSPJUMP_SYNC_NONE=0,
+	LSPJUMP_SYNC_FULL=1,
+	LSPJUMP_SYNC_INCREMENTAL=2
+}LspJumpSyncKind;
+
+#define GEDIT_RPC_REQUEST_TIMEOUT_MS 10000
+#define GEDIT_RPC_SWEEP_INTERVAL_MS 1000
+#define GEDIT_RPC_SHUTDOWN_TIMEOUT_MS 3000
 
 struct JsonRpcEndpoint
 {
+	gint ref_count; // atomic, the I/O thread holds references while it wakes the main thread
+	char *root_uri;
+	
 	GIOChannel *stdin_channel;
+	guint stdin_source; // waits for the pipe to take the rest of outgoing
+	LspJumpOutQueue outgoing;
+	LspJumpRecorder *recorder; // saves the session if LSPJUMP_RECORD is set
 	GIOChannel *stdout_channel;
 	GIOChannel *stderr_channel;
 	GPid child_pid;
-	GString *read_buffer;
+	guint child_source; // reaps the child, holds a reference until it has exited
+	guint kill_source;
+	
+	// Reading, framing and parsing happen on the I/O thread, in its own context
+	GThread *io_thread;
+	GMainContext *io_context;
+	GMainLoop *io_loop;
+	GSource *stdout_watch;
+	GSource *stderr_watch;
+	LspJumpFrameParser *frame_parser; // only used on the I/O thread
+	gint64 first_byte_us; // I/O thread, when the first byte of the message being read came
+	gsize bytes_in; // atomic, added to by the I/O thread
+	LspJumpMpscQueue incoming; // parsed messages for the main thread
+	gint wake_pending; // the main thread has been asked to drain incoming
+	GMutex methods_lock;
+	GHashTable *pending_methods; // id -> method, for replies the I/O thread extracts locations from
+	
+	gint64 last_used; // monotonic time of the last message to the server
 	
-	RpcIdAction id_actions[GEDIT_RPC_ID_ACTIONS_LEN];
+	EndpointExitFunction exit_action;
+	void *exit_data;
+	
+	GHashTable *id_actions; // id -> RpcIdAction
+	guint sweep_source;
+	GQueue cached_ids; // requests answered from the cache, not delivered yet
+	guint cached_source;
+	RpcStats stats;
+	
+	json_t *server_capabilities;
+	LspJumpSyncKind sync_kind;
+	LspJumpPositionEncoding position_encoding;
+	guint generation;
 	
 	uint8_t initialized: 1;
+	uint8_t sync_open_close: 1;
+	uint8_t closed: 1; // the server closed its stdout, it will not answer any more
+	uint8_t shutting_down: 1;
+	uint8_t close_stdin: 1; // close stdin once outgoing is empty
+	uint8_t exited: 1; // the child has been reaped, its pid may belong to another process
 };
 
-int lspjump_rpc_init(const char *const root_uri,const char *const lsp_bin,const char *const lsp_bin_args,const char *const lsp_settings);
+JsonRpcEndpoint *lspjump_rpc_endpoint_new(const char *const root_uri,const char *const lsp_bin,const char *const lsp_bin_args,json_t *lsp_capabilities);
+JsonRpcEndpoint *lspjump_rpc_endpoint_ref(JsonRpcEndpoint *endpoint);
+void lspjump_rpc_endpoint_unref(JsonRpcEndpoint *endpoint);
+void lspjump_rpc_endpoint_shutdown(JsonRpcEndpoint *endpoint);
+JsonRpcEndpoint *lspjump_rpc_endpoint_from_generation(guint generation);
+gboolean lspjump_rpc_endpoint_is_idle(JsonRpcEndpoint *endpoint, gint64 idle_us);
 
-int lspjump_rpc_definition(const char *const file_path, const char *const file_contents, long doc_line, long doc_offset,
-                           IdActionFunction action, void *user_data);
+LspJumpSyncKind lspjump_rpc_get_sync_kind(JsonRpcEndpoint *endpoint, gboolean *open_close);
+LspJumpPositionEncoding lspjump_rpc_get_position_encoding(JsonRpcEndpoint *endpoint);
 
-int lspjump_rpc_reference(const char *const file_path, const char *const file_contents, long doc_line, long doc_offset,
-                           IdActionFunction action, void *user_data);
+int lspjump_rpc_did_open(JsonRpcEndpoint *endpoint, const char *const uri, const char *const language_id, int version,
+                         LspJumpTextWriter write_text, void *user_data, size_t size_hint);
+int lspjump_rpc_did_change(JsonRpcEndpoint *endpoint, const char *const uri, int version, json_t *content_changes);
+int lspjump_rpc_did_change_full(JsonRpcEndpoint *endpoint, const char *const uri, int version, LspJumpTextWriter write_text, void *user_data, size_t size_hint);
+int lspjump_rpc_did_close(JsonRpcEndpoint *endpoint, const char *const uri);
 
-int lspjump_rpc_hover(const char *const file_path, const char *const file_contents, long doc_line, long doc_offset,
+int lspjump_rpc_definition(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
+                           LocationsActionFunction action, void *user_data);
+int lspjump_rpc_definition_prefetch(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
+                                    LocationsActionFunction action, void *user_data);
+int lspjump_rpc_reference(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
+                          LocationsActionFunction action, void *user_data);
+int lspjump_rpc_hover(JsonRpcEndpoint *endpoint, const char *const uri, int version, const LspJumpRange *word, long doc_line, long doc_offset,
                       IdActionFunction action, void *user_data);
 
+int lspjump_rpc_cancel(JsonRpcEndpoint *endpoint, int id);
+gboolean lspjump_rpc_is_pending(JsonRpcEndpoint *endpoint, int id);
+int lspjump_rpc_get_stats(JsonRpcEndpoint *endpoint, RpcStats *stats);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(JsonRpcEndpoint,lspjump_rpc_endpoint_unref)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(json_t,json_decref)
+
 G_END_DECLS
@@ -0,0 +1,217 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-lspjump-stats.h"
+
+const char *const LSPJUMP_STAGE_NAMES[LSPJUMP_STAGE_COUNT]=
+{
+	"queued",
+	"server",
+	"parse",
+	"dispatch",
+	"total",
+};
+
+static GHashTable *GLOBAL_METHOD_STATS=NULL; // interned method -> LspJumpMethodStats
+
+static guint bucket_index(gint64 value)
+{
+	if(value<LSPJUMP_HISTOGRAM_SUB_BUCKETS)
+	{
+		return value<0?0:value;
+	}
+
+	guint shift=g_bit_storage(value)-1-LSPJUMP_HISTOGRAM_SUB_BITS;
+	guint index=(shift+1)*LSPJUMP_HISTOGRAM_SUB_BUCKETS+(guint)((value>>shift)-LSPJUMP_HISTOGRAM_SUB_BUCKETS);
+
+	return MIN(index,LSPJUMP_HISTOGRAM_BUCKETS-1);
+}
+
+/**
+	@return
+		the largest value that lands in the bucket
+*/
+static gint64 bucket_value(guint index)
+{
+	guint magnitude=index/LSPJUMP_HISTOGRAM_SUB_BUCKETS;
+	gint64 offset=index%LSPJUMP_HISTOGRAM_SUB_BUCKETS;
+
+	if(magnitude==0)
+	{
+		return offset;
+	}
+
+	guint shift=magnitude-1;
+
+	return ((offset+LSPJUMP_HISTOGRAM_SUB_BUCKETS)<<shift)+(((gint64)1<<shift)-1);
+}
+
+void lspjump_histogram_record(LspJumpHistogram *self, gint64 value)
+{
+	self->counts[bucket_index(value)]++;
+	self->total++;
+	self->sum+=value;
+	self->max=MAX(self->max,value);
+}
+
+/**
+	@param percentile
+		0 to 100
+	@return
+		a value at least as large as that share of the recorded values, 0 if
+		nothing was recorded
+*/
+gint64 lspjump_histogram_percentile(const LspJumpHistogram *self, double percentile)
+{
+	if(self->total==0)
+	{
+		return 0;
+	}
+
+	guint64 wanted=MAX((guint64)(percentile/100.0*self->total+0.5),1);
+	guint64 seen=0;
+
+	for(guint i=0;i<LSPJUMP_HISTOGRAM_BUCKETS;i++)
+	{
+		seen+=self->counts[i];
+
+		if(seen>=wanted)
+		{
+			return MIN(bucket_value(i),self->max);
+		}
+	}
+
+	return self->max;
+}
+
+static void record_stage(LspJumpMethodStats *stats, LspJumpStage stage, gint64 from, gint64 to)
+{
+	if(from>0 && to>=from)
+	{
+		lspjump_histogram_record(&stats->stages[stage],to-from);
+	}
+}
+
+/**
+	Add a request that got its reply to the histograms of its method. Stages
+	that were not timed are left out. Main thread only.
+*/
+void lspjump_stats_record_request(const char *const method, const LspJumpRequestTimes *times)
+{
+	if(GLOBAL_METHOD_STATS==NULL)
+	{
+		GLOBAL_METHOD_STATS=g_hash_table_new_full(g_direct_hash,g_direct_equal,NULL,free);
+	}
+
+	const char *interned=g_intern_string(method);
+	LspJumpMethodStats *stats=g_hash_table_lookup(GLOBAL_METHOD_STATS,interned);
+
+	if(stats==NULL)
+	{
+		stats=calloc(1,sizeof(LspJumpMethodStats));
+		stats->method=interned;
+		g_hash_table_insert(GLOBAL_METHOD_STATS,(gpointer)interned,stats);
+	}
+
+	record_stage(stats,LSPJUMP_STAGE_QUEUED,times->enqueued_us,times->written_us);
+	record_stage(stats,LSPJUMP_STAGE_SERVER,times->written_us,times->first_byte_us);
+	record_stage(stats,LSPJUMP_STAGE_PARSE,times->first_byte_us,times->parsed_us);
+	record_stage(stats,LSPJUMP_STAGE_DISPATCH,times->parsed_us,times->done_us);
+	record_stage(stats,LSPJUMP_STAGE_TOTAL,times->enqueued_us,times->done_us);
+}
+
+static gint compare_method(gconstpointer a, gconstpointer b)
+{
+	const LspJumpMethodStats *first=*(LspJumpMethodStats *const *)a;
+	const LspJumpMethodStats *second=*(LspJumpMethodStats *const *)b;
+
+	return strcmp(first->method,second->method);
+}
+
+/**
+	@return
+		the LspJumpMethodStats of every method that has been timed, by name. The
+		array is the caller's, the stats are not and change with every reply.
+*/
+GPtrArray *lspjump_stats_get_methods(void)
+{
+	GPtrArray *methods=g_ptr_array_new();
+
+	if(GLOBAL_METHOD_STATS)
+	{
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init(&iter,GLOBAL_METHOD_STATS);
+
+		while(g_hash_table_iter_next(&iter,NULL,&value))
+		{
+			g_ptr_array_add(methods,value);
+		}
+	}
+
+	g_ptr_array_sort(methods,compare_method);
+
+	return methods;
+}
+
+void lspjump_stats_reset(void)
+{
+	if(GLOBAL_METHOD_STATS)
+	{
+		g_hash_table_remove_all(GLOBAL_METHOD_STATS);
+	}
+}
+
+/**
+	@return
+		resident memory of a process in KiB, -1 if it cannot be read
+*/
+long lspjump_stats_get_rss_kb(GPid pid)
+{
+	char path[64];
+	g_snprintf(path,sizeof(path),"/proc/%d/status",(int)pid);
+
+	FILE *file=fopen(path,"r");
+
+	if(file==NULL)
+	{
+		return -1;
+	}
+
+	char line[256];
+	long rss=-1;
+
+	while(fgets(line,sizeof(line),file))
+	{
+		if(sscanf(line,"VmRSS: %ld",&rss)==1)
+		{
+			break;
+		}
+	}
+
+	fclose(file);
+
+	return rss;
+}
@@ -0,0 +1,89 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+// Buckets per power of two, values are kept to within 1/16 of their size
+#define LSPJUMP_HISTOGRAM_SUB_BITS 4
+#define LSPJUMP_HISTOGRAM_SUB_BUCKETS (1<<LSPJUMP_HISTOGRAM_SUB_BITS)
+// Microseconds up to 2^36, almost a day, larger values go in the last bucket
+#define LSPJUMP_HISTOGRAM_MAGNITUDES (36-LSPJUMP_HISTOGRAM_SUB_BITS+1)
+#define LSPJUMP_HISTOGRAM_BUCKETS (LSPJUMP_HISTOGRAM_MAGNITUDES*LSPJUMP_HISTOGRAM_SUB_BUCKETS)
+
+/**
+	Log-linear histogram of durations in the style of HdrHistogram: exact below
+	LSPJUMP_HISTOGRAM_SUB_BUCKETS, then LSPJUMP_HISTOGRAM_SUB_BUCKETS linear buckets
+	for every power of two. Recording is a few shifts and an increment.
+*/
+typedef struct LspJumpHistogram
+{
+	guint64 counts[LSPJUMP_HISTOGRAM_BUCKETS];
+	guint64 total;
+	gint64 max;
+	gint64 sum;
+}LspJumpHistogram;
+
+/**
+	Where the time of a request went, from the call to the end of its action
+*/
+typedef enum LspJumpStage
+{
+	LSPJUMP_STAGE_QUEUED, // in the outgoing queue until the whole request is written
+	LSPJUMP_STAGE_SERVER, // written until the first byte of the reply is read
+	LSPJUMP_STAGE_PARSE, // first byte until the I/O thread has parsed the reply
+	LSPJUMP_STAGE_DISPATCH, // parsed until the action returns, on the main thread
+	LSPJUMP_STAGE_TOTAL,
+	LSPJUMP_STAGE_COUNT
+}LspJumpStage;
+
+extern const char *const LSPJUMP_STAGE_NAMES[LSPJUMP_STAGE_COUNT];
+
+/**
+	Monotonic times of one request, 0 if the stage was never reached
+*/
+typedef struct LspJumpRequestTimes
+{
+	gint64 enqueued_us;
+	gint64 written_us;
+	gint64 first_byte_us;
+	gint64 parsed_us;
+	gint64 done_us;
+}LspJumpRequestTimes;
+
+typedef struct LspJumpMethodStats
+{
+	const char *method; // interned
+	LspJumpHistogram stages[LSPJUMP_STAGE_COUNT];
+}LspJumpMethodStats;
+
+void lspjump_histogram_record(LspJumpHistogram *self, gint64 value);
+gint64 lspjump_histogram_percentile(const LspJumpHistogram *self, double percentile);
+
+void lspjump_stats_record_request(const char *const method, const LspJumpRequestTimes *times);
+GPtrArray *lspjump_stats_get_methods(void);
+void lspjump_stats_reset(void);
+
+long lspjump_stats_get_rss_kb(GPid pid);
+
+G_END_DECLS
@@ -0,0 +1,187 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+/**
+	Chrome trace-event JSON for chrome://tracing and Perfetto, written as the
+	events happen. The array is never closed, which the viewers accept, so a
+	file cut short by a crash still opens.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "gedit-lspjump-timeline.h"
+#include "gedit-lspjump-jsonwrite.h"
+
+gboolean GLOBAL_TIMELINE_ON=FALSE;
+
+typedef struct LspJumpTimeline
+{
+	GMutex lock;
+	FILE *file;
+	int pid;
+	gint next_tid; // atomic
+}LspJumpTimeline;
+
+static LspJumpTimeline GLOBAL_TIMELINE;
+
+static __thread int THREAD_ID=0;
+
+static int get_thread_id(void)
+{
+	if(THREAD_ID==0)
+	{
+		THREAD_ID=g_atomic_int_add(&GLOBAL_TIMELINE.next_tid,1)+1;
+	}
+
+	return THREAD_ID;
+}
+
+/**
+	Write one event, the caller has formatted everything after "ph"
+*/
+static void write_event(char phase, const char *const category, const char *const name, gint64 ts, const char *const rest)
+{
+	g_autoptr(GString) event=g_string_new("{\"name\":\"");
+
+	lspjump_json_write_escaped(event,name,strlen(name));
+	g_string_append_printf(event,"\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d%s},\n",
+	                       category,phase,ts,GLOBAL_TIMELINE.pid,get_thread_id(),rest);
+
+	g_mutex_lock(&GLOBAL_TIMELINE.lock);
+
+	if(GLOBAL_TIMELINE.file)
+	{
+		fwrite(event->str,1,event->len,GLOBAL_TIMELINE.file);
+	}
+
+	g_mutex_unlock(&GLOBAL_TIMELINE.lock);
+}
+
+/**
+	Open LSPJUMP_CHROME_TRACE if it is set, called once from lspjump_trace_init
+*/
+void lspjump_timeline_init(void)
+{
+	const char *path=g_getenv("LSPJUMP_CHROME_TRACE");
+
+	if(path==NULL || *path=='\0')
+	{
+		return;
+	}
+
+	FILE *file=fopen(path,"w");
+
+	if(file==NULL)
+	{
+		g_printerr("lspjump: could not open %s: %s\n",path,g_strerror(errno));
+		return;
+	}
+
+	g_mutex_init(&GLOBAL_TIMELINE.lock);
+	GLOBAL_TIMELINE.file=file;
+	GLOBAL_TIMELINE.pid=getpid();
+
+	fputs("[\n",file);
+	GLOBAL_TIMELINE_ON=TRUE;
+
+	lspjump_timeline_name_thread("main");
+
+	// gedit does not always get to deactivate the plugin
+	atexit(lspjump_timeline_close);
+}
+
+void lspjump_timeline_close(void)
+{
+	if(!GLOBAL_TIMELINE_ON)
+	{
+		return;
+	}
+
+	g_mutex_lock(&GLOBAL_TIMELINE.lock);
+
+	GLOBAL_TIMELINE_ON=FALSE;
+	g_clear_pointer(&GLOBAL_TIMELINE.file,fclose);
+
+	g_mutex_unlock(&GLOBAL_TIMELINE.lock);
+}
+
+/**
+	Name the calling thread in the viewer
+*/
+void lspjump_timeline_name_thread(const char *const name)
+{
+	if(!LSPJUMP_TIMELINE_ON)
+	{
+		return;
+	}
+
+	g_autoptr(GString) args=g_string_new(",\"args\":{\"name\":\"");
+
+	lspjump_json_write_escaped(args,name,strlen(name));
+	g_string_append(args,"\"}");
+
+	write_event('M',"__metadata","thread_name",0,args->str);
+}
+
+/**
+	Something that took from start_us to end_us on the calling thread
+
+	@param id
+		request id shown with the span, 0 for none
+	@param flow
+		where the span is on the way of request id, bound to the span
+*/
+void lspjump_timeline_span(const char *const category, const char *const name, gint64 start_us, gint64 end_us, int id, LspJumpFlowPhase flow)
+{
+	char rest[96];
+
+	if(id>0)
+	{
+		g_snprintf(rest,sizeof(rest),",\"dur\":%" G_GINT64_FORMAT ",\"args\":{\"id\":%d}",end_us-start_us,id);
+	}
+	else
+	{
+		g_snprintf(rest,sizeof(rest),",\"dur\":%" G_GINT64_FORMAT,end_us-start_us);
+	}
+
+	write_event('X',category,name,start_us,rest);
+
+	if(flow!=LSPJUMP_FLOW_NONE && id>0)
+	{
+		// The end binds to the span it is in rather than the next one
+		g_snprintf(rest,sizeof(rest),",\"id\":%d%s",id,flow==LSPJUMP_FLOW_END?",\"bp\":\"e\"":"");
+		write_event(flow,category,"request",start_us,rest);
+	}
+}
+
+/**
+	Start or end something that is waited for on the main loop, like a tab
+	loading. Begin and end are matched by category, name and id.
+*/
+void lspjump_timeline_async(const char *const category, const char *const name, guint id, gboolean begin)
+{
+	char rest[32];
+
+	g_snprintf(rest,sizeof(rest),",\"id\":%u",id);
+	write_event(begin?'b':'e',category,name,g_get_monotonic_time(),rest);
+}
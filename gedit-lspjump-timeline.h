@@ -0,0 +1,55 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+	Flow events tie the spans of one request together across threads, by its id
+*/
+typedef enum LspJumpFlowPhase
+{
+	LSPJUMP_FLOW_NONE=0,
+	LSPJUMP_FLOW_START='s',
+	LSPJUMP_FLOW_STEP='t',
+	LSPJUMP_FLOW_END='f'
+}LspJumpFlowPhase;
+
+extern gboolean GLOBAL_TIMELINE_ON;
+
+#define LSPJUMP_TIMELINE_ON G_UNLIKELY(GLOBAL_TIMELINE_ON)
+
+// Start of a span, 0 without a timeline so nothing is timed
+#define LSPJUMP_TIMELINE_START() (LSPJUMP_TIMELINE_ON?g_get_monotonic_time():0)
+
+#define LSPJUMP_TIMELINE_SPAN(category,name,start_us,id,flow) G_STMT_START{ \
+	if(LSPJUMP_TIMELINE_ON) \
+		lspjump_timeline_span(category,name,start_us,g_get_monotonic_time(),id,flow); \
+}G_STMT_END
+
+void lspjump_timeline_init(void);
+void lspjump_timeline_close(void);
+void lspjump_timeline_name_thread(const char *const name);
+void lspjump_timeline_span(const char *const category, const char *const name, gint64 start_us, gint64 end_us, int id, LspJumpFlowPhase flow);
+void lspjump_timeline_async(const char *const category, const char *const name, guint id, gboolean begin);
+
+G_END_DECLS
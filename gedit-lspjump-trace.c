@@ -0,0 +1,330 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <glib-unix.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "gedit-lspjump-trace.h"
+#include "gedit-lspjump-timeline.h"
+
+guint8 GLOBAL_TRACE_LEVELS[LSPJUMP_TRACE_CATEGORY_COUNT];
+
+static const char *const CATEGORY_NAMES[LSPJUMP_TRACE_CATEGORY_COUNT]={"rpc","sync","cache","server"};
+static const char *const LEVEL_NAMES[]={"off","error","warn","info","debug"};
+static const char *const DIRECTION_NAMES[]={"out","in","dispatch","cached"};
+
+typedef struct LspJumpTraceRing
+{
+	LspJumpTraceRecord *records; // NULL while nothing is recorded
+	guint capacity; // a power of two
+	gint next; // atomic, records written so far
+
+	GMutex methods_lock;
+	GPtrArray *methods; // index -> interned method name, 0 is ""
+	GHashTable *method_index; // interned method name -> index
+}LspJumpTraceRing;
+
+static LspJumpTraceRing GLOBAL_TRACE_RING;
+
+static int parse_level(const char *const name)
+{
+	for(size_t i=0;i<G_N_ELEMENTS(LEVEL_NAMES);i++)
+	{
+		if(g_ascii_strcasecmp(name,LEVEL_NAMES[i])==0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+	LSPJUMP_TRACE is a comma separated list of category[:level], "all" for every
+	category. The level is info if left out, info records messages in the ring,
+	debug also prints them.
+
+		LSPJUMP_TRACE=rpc:debug,cache
+*/
+static void parse_categories(const char *const spec)
+{
+	g_auto(GStrv) items=g_strsplit(spec,",",-1);
+
+	for(int i=0;items[i];i++)
+	{
+		char *item=g_strstrip(items[i]);
+		char *level_name=strchr(item,':');
+		int level=LSPJUMP_TRACE_INFO;
+
+		if(level_name)
+		{
+			*level_name++='\0';
+			level=parse_level(level_name);
+
+			if(level<0)
+			{
+				g_printerr("lspjump: unknown trace level %s\n",level_name);
+				continue;
+			}
+		}
+
+		gboolean all=g_ascii_strcasecmp(item,"all")==0 || strcmp(item,"1")==0;
+		gboolean found=all;
+
+		for(int category=0;category<LSPJUMP_TRACE_CATEGORY_COUNT;category++)
+		{
+			if(all || g_ascii_strcasecmp(item,CATEGORY_NAMES[category])==0)
+			{
+				GLOBAL_TRACE_LEVELS[category]=level;
+				found=TRUE;
+			}
+		}
+
+		if(!found)
+		{
+			g_printerr("lspjump: unknown trace category %s\n",item);
+		}
+	}
+}
+
+static char *get_dump_path(void)
+{
+	const char *path=g_getenv("LSPJUMP_TRACE_FILE");
+
+	if(path && *path)
+	{
+		return g_strdup(path);
+	}
+
+	g_autofree char *name=g_strdup_printf("lspjump-trace-%d.bin",(int)getpid());
+
+	return g_build_filename(g_get_user_cache_dir(),name,NULL);
+}
+
+static gboolean dump_on_signal(gpointer data)
+{
+	g_autofree char *path=get_dump_path();
+	g_autoptr(GError) error=NULL;
+
+	if(lspjump_trace_dump(path,&error))
+	{
+		g_printerr("lspjump: trace written to %s\n",path);
+	}
+	else
+	{
+		g_printerr("lspjump: could not write the trace: %s\n",error->message);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+	Read LSPJUMP_TRACE once. Nothing is allocated unless some category records,
+	then SIGUSR1 dumps the ring to LSPJUMP_TRACE_FILE, or to the user cache dir.
+*/
+void lspjump_trace_init(void)
+{
+	static gsize initialized=0;
+
+	if(!g_once_init_enter(&initialized))
+	{
+		return;
+	}
+
+	const char *spec=g_getenv("LSPJUMP_TRACE");
+
+	if(spec && *spec)
+	{
+		parse_categories(spec);
+	}
+
+	lspjump_timeline_init();
+
+	gboolean records=FALSE;
+
+	for(int category=0;category<LSPJUMP_TRACE_CATEGORY_COUNT;category++)
+	{
+		records|=GLOBAL_TRACE_LEVELS[category]>=LSPJUMP_TRACE_INFO;
+	}
+
+	if(records)
+	{
+		const char *ring=g_getenv("LSPJUMP_TRACE_RING");
+		guint64 wanted=ring?g_ascii_strtoull(ring,NULL,10):0;
+		guint capacity=64;
+
+		while(capacity<wanted && capacity<(1u<<24))
+		{
+			capacity<<=1;
+		}
+
+		GLOBAL_TRACE_RING.capacity=wanted?capacity:LSPJUMP_TRACE_DEFAULT_RING;
+		GLOBAL_TRACE_RING.records=calloc(GLOBAL_TRACE_RING.capacity,sizeof(LspJumpTraceRecord));
+
+		g_mutex_init(&GLOBAL_TRACE_RING.methods_lock);
+		GLOBAL_TRACE_RING.methods=g_ptr_array_new();
+		g_ptr_array_add(GLOBAL_TRACE_RING.methods,(gpointer)"");
+		GLOBAL_TRACE_RING.method_index=g_hash_table_new(g_direct_hash,g_direct_equal);
+
+		g_unix_signal_add(SIGUSR1,dump_on_signal,NULL);
+	}
+
+	g_once_init_leave(&initialized,1);
+}
+
+static guint16 get_method_index(const char *const method)
+{
+	if(method==NULL)
+	{
+		return 0;
+	}
+
+	const char *interned=g_intern_string(method);
+
+	g_mutex_lock(&GLOBAL_TRACE_RING.methods_lock);
+
+	guint index=GPOINTER_TO_UINT(g_hash_table_lookup(GLOBAL_TRACE_RING.method_index,interned));
+
+	if(index==0 && GLOBAL_TRACE_RING.methods->len<G_MAXUINT16)
+	{
+		index=GLOBAL_TRACE_RING.methods->len;
+		g_ptr_array_add(GLOBAL_TRACE_RING.methods,(gpointer)interned);
+		g_hash_table_insert(GLOBAL_TRACE_RING.method_index,(gpointer)interned,GUINT_TO_POINTER(index));
+	}
+
+	g_mutex_unlock(&GLOBAL_TRACE_RING.methods_lock);
+
+	return index;
+}
+
+/**
+	Store one record, the oldest one is overwritten when the ring is full. Safe to
+	call from any thread.
+*/
+void lspjump_trace_record(LspJumpTraceCategory category, LspJumpTraceDirection direction, guint generation, int id, const char *const method,
+                          size_t size, gint64 start_us, gint64 end_us)
+{
+	if(GLOBAL_TRACE_RING.records==NULL)
+	{
+		return;
+	}
+
+	guint slot=(guint)g_atomic_int_add(&GLOBAL_TRACE_RING.next,1)&(GLOBAL_TRACE_RING.capacity-1);
+	LspJumpTraceRecord *record=&GLOBAL_TRACE_RING.records[slot];
+
+	record->start_us=start_us;
+	record->end_us=end_us?end_us:start_us;
+	record->size=MIN(size,G_MAXUINT32);
+	record->id=id;
+	record->method=get_method_index(method);
+	record->direction=direction;
+	record->category=category;
+	record->generation=generation;
+}
+
+void lspjump_trace_body(LspJumpTraceCategory category, LspJumpTraceDirection direction, const char *body, size_t len)
+{
+	g_printerr("lspjump %s %s %zu bytes: %.*s\n",CATEGORY_NAMES[category],DIRECTION_NAMES[direction],len,(int)MIN(len,G_MAXINT),body);
+}
+
+void lspjump_trace_log(LspJumpTraceCategory category, LspJumpTraceLevel level, const char *format, ...)
+{
+	va_list args;
+	va_start(args,format);
+	g_autofree char *message=g_strdup_vprintf(format,args);
+	va_end(args);
+
+	g_printerr("lspjump %s %s: %s\n",CATEGORY_NAMES[category],LEVEL_NAMES[level],message);
+}
+
+/**
+	Write the ring to path, oldest record first:
+
+		"LSPJTRC1"
+		guint32 method count, then per method guint16 length and the name
+		guint32 record count, then the LspJumpTraceRecords
+
+	Integers are in host byte order. Records written while dumping may be torn.
+
+	@return
+		FALSE with error set if the file could not be written
+*/
+gboolean lspjump_trace_dump(const char *const path, GError **error)
+{
+	if(GLOBAL_TRACE_RING.records==NULL)
+	{
+		g_set_error(error,G_FILE_ERROR,G_FILE_ERROR_INVAL,"Tracing is off, set LSPJUMP_TRACE");
+		return FALSE;
+	}
+
+	FILE *file=fopen(path,"wb");
+
+	if(file==NULL)
+	{
+		int saved_errno=errno;
+		g_set_error(error,G_FILE_ERROR,g_file_error_from_errno(saved_errno),"%s: %s",path,g_strerror(saved_errno));
+		return FALSE;
+	}
+
+	guint next=(guint)g_atomic_int_get(&GLOBAL_TRACE_RING.next);
+	guint32 count=MIN(next,GLOBAL_TRACE_RING.capacity);
+
+	fwrite("LSPJTRC1",1,8,file);
+
+	g_mutex_lock(&GLOBAL_TRACE_RING.methods_lock);
+
+	guint32 method_count=GLOBAL_TRACE_RING.methods->len;
+	fwrite(&method_count,sizeof(method_count),1,file);
+
+	for(guint i=0;i<method_count;i++)
+	{
+		const char *method=g_ptr_array_index(GLOBAL_TRACE_RING.methods,i);
+		guint16 len=strlen(method);
+
+		fwrite(&len,sizeof(len),1,file);
+		fwrite(method,1,len,file);
+	}
+
+	g_mutex_unlock(&GLOBAL_TRACE_RING.methods_lock);
+
+	fwrite(&count,sizeof(count),1,file);
+
+	for(guint i=next-count;i!=next;i++)
+	{
+		fwrite(&GLOBAL_TRACE_RING.records[i&(GLOBAL_TRACE_RING.capacity-1)],sizeof(LspJumpTraceRecord),1,file);
+	}
+
+	gboolean failed=ferror(file)!=0;
+	failed|=fclose(file)!=0;
+
+	if(failed)
+	{
+		g_set_error(error,G_FILE_ERROR,G_FILE_ERROR_IO,"%s: write failed",path);
+		return FALSE;
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,101 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+typedef enum LspJumpTraceCategory
+{
+	LSPJUMP_TRACE_RPC, // messages to and from the servers
+	LSPJUMP_TRACE_SYNC, // document synchronization
+	LSPJUMP_TRACE_CACHE,
+	LSPJUMP_TRACE_SERVER, // starting and stopping servers
+	LSPJUMP_TRACE_CATEGORY_COUNT
+}LspJumpTraceCategory;
+
+typedef enum LspJumpTraceLevel
+{
+	LSPJUMP_TRACE_OFF=0,
+	LSPJUMP_TRACE_ERROR,
+	LSPJUMP_TRACE_WARN,
+	LSPJUMP_TRACE_INFO, // records go to the ring from this level
+	LSPJUMP_TRACE_DEBUG // and message bodies are printed
+}LspJumpTraceLevel;
+
+typedef enum LspJumpTraceDirection
+{
+	LSPJUMP_TRACE_OUT, // queued for the server
+	LSPJUMP_TRACE_IN, // parsed on the I/O thread
+	LSPJUMP_TRACE_DISPATCH, // handled on the main thread
+	LSPJUMP_TRACE_CACHED // answered from the cache
+}LspJumpTraceDirection;
+
+/**
+	One message, 32 bytes. Dumped as it is after a "LSPJTRC1" header, the method
+	names and the record count, see lspjump_trace_dump.
+*/
+typedef struct LspJumpTraceRecord
+{
+	gint64 start_us; // monotonic
+	gint64 end_us;
+	guint32 size; // bytes of the message
+	gint32 id; // 0 for notifications
+	guint16 method; // index into the method names, 0 if unknown
+	guint8 direction;
+	guint8 category;
+	guint32 generation; // of the endpoint
+}LspJumpTraceRecord;
+
+#define LSPJUMP_TRACE_DEFAULT_RING 4096
+
+extern guint8 GLOBAL_TRACE_LEVELS[LSPJUMP_TRACE_CATEGORY_COUNT];
+
+/**
+	The only cost of a disabled trace point is this test
+*/
+#define LSPJUMP_TRACE_ON(category,level) G_UNLIKELY(GLOBAL_TRACE_LEVELS[(category)]>=(level))
+
+#define LSPJUMP_TRACE_RECORD(category,direction,generation,id,method,size,start_us,end_us) G_STMT_START{ \
+	if(LSPJUMP_TRACE_ON(category,LSPJUMP_TRACE_INFO)) \
+		lspjump_trace_record(category,direction,generation,id,method,size,start_us,end_us); \
+}G_STMT_END
+
+#define LSPJUMP_TRACE_BODY(category,direction,body,len) G_STMT_START{ \
+	if(LSPJUMP_TRACE_ON(category,LSPJUMP_TRACE_DEBUG)) \
+		lspjump_trace_body(category,direction,body,len); \
+}G_STMT_END
+
+#define LSPJUMP_TRACE_LOG(category,level,...) G_STMT_START{ \
+	if(LSPJUMP_TRACE_ON(category,level)) \
+		lspjump_trace_log(category,level,__VA_ARGS__); \
+}G_STMT_END
+
+void lspjump_trace_init(void);
+void lspjump_trace_record(LspJumpTraceCategory category, LspJumpTraceDirection direction, guint generation, int id, const char *const method,
+                          size_t size, gint64 start_us, gint64 end_us);
+void lspjump_trace_body(LspJumpTraceCategory category, LspJumpTraceDirection direction, const char *body, size_t len);
+void lspjump_trace_log(LspJumpTraceCategory category, LspJumpTraceLevel level, const char *format, ...) G_GNUC_PRINTF(3,4);
+gboolean lspjump_trace_dump(const char *const path, GError **error);
+
+G_END_DECLS
@@ -32,9 +32,17 @@ freely, subject to the following restrictions:
 #include "gedit-lspjump-configuration.h"
 #include "gedit-lspjump-common.h"
 #include "gedit-lspjump-rpc.h"
-
-GQueue *GLOBAL_BACK_STACK=NULL;
-GQueue *GLOBAL_FORWARD_STACK=NULL;
+#include "gedit-lspjump-docsync.h"
+#include "gedit-lspjump-hover.h"
+#include "gedit-lspjump-prefetch.h"
+#include "gedit-lspjump-history.h"
+#include "gedit-lspjump-endpoints.h"
+#include "gedit-lspjump-trace.h"
+#include "gedit-lspjump-timeline.h"
+#include "gedit-lspjump-results.h"
+#include "gedit-lspjump-preview.h"
+
+static guint GLOBAL_DEFERRED_INIT_SOURCE=0;
 
 static void gedit_app_activatable_iface_init(GeditAppActivatableInterface *iface);
 static void gedit_window_activatable_iface_init(GeditWindowActivatableInterface *iface);
@@ -119,143 +127,35 @@ static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *event, gpoint
 	return FALSE;
 }
 
-/**
-{
-	"id":2367,"jsonrpc":"2.0","result":
-	{
-		"contents":
-		{
-			"kind":"markdown",
-			"value":"### macro `g_return_if_fail`  \nprovided by `\"glib.h\"`  \n\n---\n```cpp\n#define g_return_if_fail(expr)                                                 \\\n  G_STMT_START {                                                               \\\n    if (G_LIKELY(expr)) {                                                      \\\n    } else {                                                                   \\\n      g_return_if_fail_warning(G_LOG_DOMAIN, G_STRFUNC, #expr);                \\\n      return;                                                                  \\\n    }                                                                          \\\n  }                                                                            \\\n  G_STMT_END\n\n// Expands to\ndo {\n  if ((doc != ((void *)0))) {\n  } else {\n    g_return_if_fail_warning(((gchar *)0), ((const char *)(__func__)),\n                             \"doc != NULL\");\n    return;\n  }\n} while (0)\n```"
-		},
-		"range":
-		{
-			"end":
-			{
-				"character":20,
-				"line":54
-			},
-			"start":
-			{
-				"character":4,
-				"line":54
-			}
-		}
-	}
-}
-
-*/
-static void lspjump_rpc_hover_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+static gboolean get_word_range(const GtkTextIter *iter, LspJumpRange *word)
 {
-//	GeditLspJumpPlugin *plugin=user_data;
-	GtkWidget *widget=user_data;
+	GtkTextIter start, end;
 	
-	g_autofree char *json_str = json_dumps(root, JSON_COMPACT);
-	
-	fprintf(stdout,"%s:%d HOVER: [%s]\n",__FILE__,__LINE__,json_str);
-	
-	json_t *result = json_object_get(root, "result");
-	if (!json_is_object(result) || json_object_size(result) == 0)
+	if(lspjump_get_identifier_bounds(iter,&start,&end))
 	{
-		fprintf(stderr, "Invalid or empty result object\n");
-		return;
-	}
-
-	json_t *contents = json_object_get(result, "contents");
-	json_t *value_obj = json_object_get(contents, "value");
-	const char *tooltip_value = json_string_value(value_obj);
-	
-	json_t *kind_obj = json_object_get(contents, "kind");
-	const char *kind_value = json_string_value(kind_obj);
-	
-	g_object_set_data(G_OBJECT(widget), "do-ttip",(void*)10);
-	g_object_set_data_full(G_OBJECT(widget), "do-ttip-txt",g_strdup(tooltip_value),g_free);
-	g_object_set_data_full(G_OBJECT(widget), "do-ttip-kind",g_strdup(kind_value),g_free);
-	gtk_widget_trigger_tooltip_query(widget);
-}
-
-gboolean on_tooltip(GtkWidget *widget,int x,int y,gboolean keyboard_mode,GtkTooltip *tooltip,gpointer user_data)
-{
-	if(keyboard_mode==FALSE)
-	{
-		intptr_t do_ttip_count=(intptr_t)g_object_get_data(G_OBJECT(widget), "do-ttip");
-		if(do_ttip_count>0)
-		{
-			const char *const do_ttip_txt=g_object_get_data(G_OBJECT(widget), "do-ttip-txt");
-			const char *const do_ttip_kind=g_object_get_data(G_OBJECT(widget), "do-ttip-txt");
-			
-			if(g_strcmp0(do_ttip_kind,"markdown")==0 || g_strcmp0(do_ttip_kind,"markup")==0)
-			{
-				gtk_tooltip_set_markup(tooltip,do_ttip_txt);
-			}
-			else
-			{
-				gtk_tooltip_set_text(tooltip,do_ttip_txt);
-			}
-			
-			g_object_set_data(G_OBJECT(widget), "do-ttip",(void*)(do_ttip_count-1));
-//			fprintf(stdout,"%s:%d ======================= [%s]\n",__FILE__,__LINE__,do_ttip_txt);
-			return TRUE;
-		}
-	
-		GeditLspJumpPlugin *plugin=user_data;
+		word->line=gtk_text_iter_get_line(&start);
+		word->start=gtk_text_iter_get_line_offset(&start);
+		word->end=gtk_text_iter_get_line_offset(&end);
 		
-		GeditWindow *const window=plugin->priv->window;
-
-		GFile *gfile=lspjump_get_active_file_from_window(window);
-		
-		g_autofree gchar *file_path = g_file_get_path(gfile);
-		
-		g_autofree gchar *text=get_full_text_from_active_document(window);
-		
-		GeditTab *tab = gedit_window_get_active_tab(window);
-		if (!tab)
-		{
-			g_print("No active tab.\n");
-			return FALSE;
-		}
-
-		GeditDocument *doc = gedit_tab_get_document(tab);
-
-		gint buf_x,buf_y;
-		gtk_text_view_window_to_buffer_coords(GTK_TEXT_VIEW(widget),GTK_TEXT_WINDOW_WIDGET,x,y,&buf_x,&buf_y);
-
-		GtkTextIter iter;
-		
-		gtk_text_view_get_iter_at_location(GTK_TEXT_VIEW(widget),&iter,buf_x,buf_y);
-		
-		gint line = gtk_text_iter_get_line(&iter); // Zero-based line number
-		gint offset = gtk_text_iter_get_offset(&iter); // Offset from start of buffer
-		gint line_offset = gtk_text_iter_get_line_offset(&iter); // Offset within the line
-		
-		lspjump_rpc_hover(file_path,text,line,line_offset,lspjump_rpc_hover_cb,widget);
-		
-		return FALSE;
+		return TRUE;
 	}
 	
 	return FALSE;
 }
 
-static void lspjump_rpc_definition_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+static void lspjump_rpc_definition_cb(JsonRpcEndpoint *endpoint, LspJumpLocations *locations, void *user_data)
 {
 	GeditLspJumpPlugin *plugin=user_data;
 	
-	json_t *result = json_object_get(root, "result");
-	if (!json_is_array(result) || json_array_size(result) == 0)
+	if (!locations || locations->len == 0)
 	{
 		fprintf(stderr, "Invalid or empty result array\n");
 		return;
 	}
 
-	json_t *item = json_array_get(result, 0);
-	json_t *uri_obj = json_object_get(item, "uri");
-	const char *uri = json_string_value(uri_obj);
-
-	json_t *range = json_object_get(item, "range");
-	json_t *start = json_object_get(range, "start");
-
-	int line = json_integer_value(json_object_get(start, "line"));
-	int character = json_integer_value(json_object_get(start, "character"));
+	const char *uri = locations->items[0].uri;
+	int line = locations->items[0].line;
+	int character = locations->items[0].character;
 
 //	printf("URI: %s\n", uri);
 //	printf("Line: %d\n", line);
@@ -265,111 +165,74 @@ static void lspjump_rpc_definition_cb(JsonRpcEndpoint *endpoint, json_t *root, v
 	
 	GeditWindow *const window=plugin->priv->window;
 	
-	gedit_lspjump_goto_file_line_column_and_track(window,gfile,line,character);
+	LspJumpPositionEncoding encoding=lspjump_rpc_get_position_encoding(endpoint);
+
+	gedit_lspjump_goto_lsp_position_and_track(window,gfile,line,character,encoding);
+
+	// Declaration and definition, or one per build configuration, list them to choose from
+	if(locations->len>1)
+	{
+		lspjump_results_show(window,locations,encoding);
+	}
 }
 
 static void lspjump_definition_cb(GAction *action, GVariant *parameter, GeditLspJumpPlugin *plugin)
 {
 	GFile *gfile=lspjump_get_active_file_from_window(plugin->priv->window);
 	
-	g_autofree gchar *file_path = g_file_get_path(gfile);
-	
-	g_autofree gchar *text=get_full_text_from_active_document(plugin->priv->window);
-	
 	GeditTab *tab = gedit_window_get_active_tab(plugin->priv->window);
-	if (!tab)
+	if (!tab || !gfile)
 	{
 		g_print("No active tab.\n");
 		return;
 	}
 
 	GeditDocument *doc = gedit_tab_get_document(tab);
+	
+	g_autofree gchar *uri = g_file_get_uri(gfile);
+	
+	JsonRpcEndpoint *endpoint=lspjump_document_sync_flush(doc);
+	
+	if(endpoint==NULL)
+	{
+		g_print("No language server for this document.\n");
+		return;
+	}
 
 	GtkTextIter iter;
 	GtkTextMark *mark = gtk_text_buffer_get_insert(GTK_TEXT_BUFFER(doc));
 	gtk_text_buffer_get_iter_at_mark(GTK_TEXT_BUFFER(doc), &iter, mark);
 
 	gint line = gtk_text_iter_get_line(&iter); // Zero-based line number
-	gint offset = gtk_text_iter_get_offset(&iter); // Offset from start of buffer
 	gint line_offset = gtk_text_iter_get_line_offset(&iter); // Offset within the line
+	gint column = lspjump_document_sync_to_lsp_column(doc, endpoint, line, line_offset);
 	
-	lspjump_rpc_definition(file_path,text,line,line_offset,lspjump_rpc_definition_cb,plugin);
-}
-
-static void on_item_clicked(GtkButton *button, gpointer user_data)
-{
-	GtkWidget *window = user_data;
-	GeditLspJumpPlugin *plugin=g_object_get_data(G_OBJECT(window), "plugin");
+	LspJumpRange word;
+	gboolean on_word=get_word_range(&iter,&word);
+	int version=lspjump_document_sync_get(doc)->version;
 	
-	const char *uri=g_object_get_data(G_OBJECT(button), "uri");
-	intptr_t line=(intptr_t)g_object_get_data(G_OBJECT(button), "line");
-	intptr_t character=(intptr_t)g_object_get_data(G_OBJECT(button), "character");
-
-	g_autoptr(GFile) gfile = g_file_new_for_uri(uri);
-
-	const gchar *label = gtk_button_get_label(button);
-	g_print("Clicked on: %s\n", label);
+	// Already asked for while the cursor rested here, a finished one is in the cache
+	if(on_word && lspjump_prefetch_claim(gedit_tab_get_view(tab),version,&word,lspjump_rpc_definition_cb,plugin))
+	{
+		return;
+	}
 	
-	gedit_lspjump_goto_file_line_column_and_track(plugin->priv->window,gfile,line,character);
-	// You would jump to the file/line here
-	gtk_widget_destroy(window);
+	lspjump_rpc_definition(endpoint,uri,version,on_word?&word:NULL,line,column,lspjump_rpc_definition_cb,plugin);
 }
 
-static void lspjump_rpc_reference_cb(JsonRpcEndpoint *endpoint, json_t *root, void *user_data)
+static void lspjump_rpc_reference_cb(JsonRpcEndpoint *endpoint, LspJumpLocations *locations, void *user_data)
 {
 	GeditLspJumpPlugin *plugin=user_data;
 	
-	json_t *results = json_object_get(root, "result");
-	if (!json_is_array(results))
+	if (!locations)
 	{
 		return;
 	}
 	
-	if(json_array_size(results)>0)
+	if(locations->len>0)
 	{
-		// Create a popup window
-		GtkWidget *window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-		gtk_window_set_title(GTK_WINDOW(window), "Locations");
-		gtk_window_set_transient_for(GTK_WINDOW(window), GTK_WINDOW(gtk_widget_get_toplevel(GTK_WIDGET(plugin->priv->window))));
-		gtk_window_set_modal(GTK_WINDOW(window), TRUE);
-		gtk_window_set_default_size(GTK_WINDOW(window), 400, 300);
-		g_object_set_data(G_OBJECT(window), "plugin", plugin);
-
-		GtkWidget *scrolled = gtk_scrolled_window_new(NULL, NULL);
-		gtk_container_add(GTK_CONTAINER(window), scrolled);
-
-		GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
-		gtk_container_add(GTK_CONTAINER(scrolled), vbox);
-		gtk_container_set_border_width(GTK_CONTAINER(vbox), 8);
-
-		// Iterate over results
-		size_t index;
-		json_t *item;
-		json_array_foreach(results, index, item)
-		{
-			json_t *uri = json_object_get(item, "uri");
-			json_t *range = json_object_get(item, "range");
-			json_t *start = json_object_get(range, "start");
-			json_t *line = json_object_get(start, "line");
-			json_t *character = json_object_get(start, "character");
-
-			const char *uri_str = json_string_value(uri);
-			json_int_t line_num = json_integer_value(line);
-			json_int_t character_num = json_integer_value(character);
-
-			// Shorten file path to basename
-			g_autofree gchar *file_basename = g_path_get_basename(uri_str);
-			g_autofree gchar *label_text = g_strdup_printf("%s:%d", file_basename, line_num + 1);
-
-			GtkWidget *button = gtk_button_new_with_label(label_text);
-			g_signal_connect(button, "clicked", G_CALLBACK(on_item_clicked), window);
-			g_object_set_data_full(G_OBJECT(button), "uri", g_strdup(uri_str),g_free);
-			g_object_set_data(G_OBJECT(button), "line", (void*)(intptr_t)line_num);
-			g_object_set_data(G_OBJECT(button), "character", (void*)(intptr_t)character_num);
-			gtk_box_pack_start(GTK_BOX(vbox), button, FALSE, FALSE, 0);
-		}
-
-		gtk_widget_show_all(window);
+		// The server may be gone by the time of a jump, so the encoding goes along
+		lspjump_results_show(plugin->priv->window,locations,lspjump_rpc_get_position_encoding(endpoint));
 	}
 }
 
@@ -377,38 +240,48 @@ static void lspjump_reference_cb(GAction *action, GVariant *parameter, GeditLspJ
 {
 	GFile *gfile=lspjump_get_active_file_from_window(plugin->priv->window);
 	
-	g_autofree gchar *file_path = g_file_get_path(gfile);
-	
-	g_autofree gchar *text=get_full_text_from_active_document(plugin->priv->window);
-	
 	GeditTab *tab = gedit_window_get_active_tab(plugin->priv->window);
-	if (!tab)
+	if (!tab || !gfile)
 	{
 		g_print("No active tab.\n");
 		return;
 	}
 
 	GeditDocument *doc = gedit_tab_get_document(tab);
+	
+	g_autofree gchar *uri = g_file_get_uri(gfile);
+	
+	JsonRpcEndpoint *endpoint=lspjump_document_sync_flush(doc);
+	
+	if(endpoint==NULL)
+	{
+		g_print("No language server for this document.\n");
+		return;
+	}
 
 	GtkTextIter iter;
 	GtkTextMark *mark = gtk_text_buffer_get_insert(GTK_TEXT_BUFFER(doc));
 	gtk_text_buffer_get_iter_at_mark(GTK_TEXT_BUFFER(doc), &iter, mark);
 
 	gint line = gtk_text_iter_get_line(&iter); // Zero-based line number
-	gint offset = gtk_text_iter_get_offset(&iter); // Offset from start of buffer
 	gint line_offset = gtk_text_iter_get_line_offset(&iter); // Offset within the line
+	gint column = lspjump_document_sync_to_lsp_column(doc, endpoint, line, line_offset);
 	
-	lspjump_rpc_reference(file_path,text,line,line_offset,lspjump_rpc_reference_cb,plugin);
+	LspJumpRange word;
+	gboolean on_word=get_word_range(&iter,&word);
+	int version=lspjump_document_sync_get(doc)->version;
+	
+	lspjump_rpc_reference(endpoint,uri,version,on_word?&word:NULL,line,column,lspjump_rpc_reference_cb,plugin);
 }
 
 static void lspjump_undo_cb(GAction *action, GVariant *parameter, GeditLspJumpPlugin *plugin)
 {
-	gedit_lspjump_do_undo(plugin->priv->window);
+	lspjump_history_back(plugin->priv->window);
 }
 
 static void lspjump_redo_cb(GAction *action, GVariant *parameter, GeditLspJumpPlugin *plugin)
 {
-	gedit_lspjump_do_redo(plugin->priv->window);
+	lspjump_history_forward(plugin->priv->window);
 }
 
 static void lspjump_settings_cb(GAction *action, GVariant *parameter, GeditLspJumpPlugin *plugin)
@@ -436,6 +309,9 @@ static void gedit_lspjump_plugin_app_activate(GeditAppActivatable *activatable)
 
 	priv = GEDIT_LSPJUMP_PLUGIN(activatable)->priv;
 	
+	// Early, so the timeline also has what happens before the first server starts
+	lspjump_trace_init();
+	
 	gtk_application_set_accels_for_action(GTK_APPLICATION(priv->app), "win.definition", (const gchar *[]){"F3", NULL});
 	gtk_application_set_accels_for_action(GTK_APPLICATION(priv->app), "win.reference", (const gchar *[]){"F4", NULL});
 	gtk_application_set_accels_for_action(GTK_APPLICATION(priv->app), "win.lspjump_undo", (const gchar *[]){"<Alt>B", NULL});
@@ -469,6 +345,27 @@ static void gedit_lspjump_plugin_app_deactivate(GeditAppActivatable *activatable
 	priv = GEDIT_LSPJUMP_PLUGIN(activatable)->priv;
 
 	g_clear_object(&priv->menu_ext);
+	
+	lspjump_timeline_close();
+}
+
+/**
+	Start the server for the document of a tab in the background. A tab that is
+	still loading is warmed up once it has loaded, the server would only get an
+	empty document and then the whole text as changes.
+*/
+static void warm_up_tab(GeditTab *tab)
+{
+	GeditDocument *doc=gedit_tab_get_document(tab);
+	
+	if(gedit_tab_get_state(tab)==GEDIT_TAB_STATE_NORMAL)
+	{
+		lspjump_document_sync_warm_up(doc);
+	}
+	else
+	{
+		lspjump_document_sync_get(doc);
+	}
 }
 
 static void on_tab_changed(GeditWindow *window, gpointer user_data)
@@ -482,11 +379,19 @@ static void on_tab_changed(GeditWindow *window, gpointer user_data)
 			g_object_set_data(G_OBJECT(view), "ll", "y");
 			// Ensure each new tab gets the key-press-event handler
 			g_signal_connect(view, "key-press-event", G_CALLBACK(on_key_press_event), user_data);
-			g_signal_connect(view, "query-tooltip", G_CALLBACK(on_tooltip), user_data);
+			lspjump_hover_attach(view);
+			lspjump_prefetch_attach(view);
+			
+			warm_up_tab(gedit_window_get_active_tab(window));
 		}
 	}
 }
 
+static void on_tab_added(GeditWindow *window, GeditTab *tab, gpointer user_data)
+{
+	warm_up_tab(tab);
+}
+
 static void gedit_lspjump_plugin_window_activate(GeditWindowActivatable *activatable)
 {
 	GeditLspJumpPlugin *plugin = GEDIT_LSPJUMP_PLUGIN(activatable);
@@ -518,6 +423,19 @@ static void gedit_lspjump_plugin_window_activate(GeditWindowActivatable *activat
 	update_ui(GEDIT_LSPJUMP_PLUGIN(activatable));
 	
 	g_signal_connect(priv->window, "active-tab-changed", G_CALLBACK(on_tab_changed), plugin);
+	g_signal_connect(priv->window, "tab-added", G_CALLBACK(on_tab_added), plugin);
+	
+	lspjump_history_attach(priv->window);
+	
+	// Servers for what is already open start in the background, before the first jump
+	GList *documents=gedit_window_get_documents(priv->window);
+	
+	for(GList *item=documents;item;item=item->next)
+	{
+		warm_up_tab(gedit_tab_get_from_document(item->data));
+	}
+	
+	g_list_free(documents);
 }
 
 static void gedit_lspjump_plugin_window_deactivate(GeditWindowActivatable *activatable)
@@ -526,6 +444,7 @@ static void gedit_lspjump_plugin_window_deactivate(GeditWindowActivatable *activ
 
 	priv = GEDIT_LSPJUMP_PLUGIN(activatable)->priv;
 	g_action_map_remove_action(G_ACTION_MAP(priv->window), "lspjump");
+	lspjump_history_detach(priv->window);
 }
 
 static void gedit_lspjump_plugin_window_update_state(GeditWindowActivatable *activatable)
@@ -596,6 +515,21 @@ static void gedit_lspjump_plugin_get_property(GObject *object, guint prop_id, GV
 	}
 }
 
+/**
+	What the plugin needs but gedit does not need to show its first window. Runs
+	once the main loop has nothing else to do; whatever needs the configuration
+	earlier reads it on first use.
+*/
+static gboolean deferred_init(gpointer data)
+{
+	GLOBAL_DEFERRED_INIT_SOURCE=0;
+	
+	load_configuration();
+	lspjump_cache_set_budget((size_t)lspjump_configuration_get_int("cache_budget_kb",LSPJUMP_CACHE_DEFAULT_BUDGET/1024)*1024);
+	
+	return G_SOURCE_REMOVE;
+}
+
 static void gedit_lspjump_plugin_class_init(GeditLspJumpPluginClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS(klass);
@@ -605,10 +539,8 @@ static void gedit_lspjump_plugin_class_init(GeditLspJumpPluginClass *klass)
 	object_class->set_property = gedit_lspjump_plugin_set_property;
 	object_class->get_property = gedit_lspjump_plugin_get_property;
 	
-	GLOBAL_BACK_STACK=g_queue_new();
-	GLOBAL_FORWARD_STACK=g_queue_new();
-	
-	load_configuration();
+	// After the first frame, redraws have a higher priority
+	GLOBAL_DEFERRED_INIT_SOURCE=g_idle_add_full(G_PRIORITY_LOW,deferred_init,NULL,NULL);
 
 	g_object_class_override_property(object_class, PROP_WINDOW, "window");
 	g_object_class_override_property(object_class, PROP_APP, "app");
@@ -616,8 +548,10 @@ static void gedit_lspjump_plugin_class_init(GeditLspJumpPluginClass *klass)
 
 static void gedit_lspjump_plugin_class_finalize(GeditLspJumpPluginClass *klass)
 {
-	g_queue_free_full(GLOBAL_BACK_STACK,track_pos_free);
-	g_queue_free_full(GLOBAL_FORWARD_STACK,track_pos_free);
+	g_clear_handle_id(&GLOBAL_DEFERRED_INIT_SOURCE,g_source_remove);
+	lspjump_endpoints_shutdown_all();
+	lspjump_configuration_unload();
+	lspjump_preview_shutdown();
 }
 
 static void gedit_app_activatable_iface_init(GeditAppActivatableInterface *iface)
@@ -636,6 +570,7 @@ static void gedit_window_activatable_iface_init(GeditWindowActivatableInterface
 G_MODULE_EXPORT void peas_register_types(PeasObjectModule *module)
 {
 	gedit_lspjump_plugin_register_type(G_TYPE_MODULE(module));
+	lspjump_results_register_types(G_TYPE_MODULE(module));
 
 	peas_object_module_register_extension_type(module, GEDIT_TYPE_APP_ACTIVATABLE, GEDIT_TYPE_LSPJUMP_PLUGIN);
 	peas_object_module_register_extension_type(module, GEDIT_TYPE_WINDOW_ACTIVATABLE, GEDIT_TYPE_LSPJUMP_PLUGIN);